@@ -0,0 +1,225 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <glob.h>
+#include <sys/stat.h>
+
+#include <fmt/core.h>
+#include <strutil.h>
+
+// Batch of traces: each trace is a whole run, and the runs share a pool of threads.
+
+namespace batch
+{
+
+// Expand the comma-separated spec into trace paths, the largest first.
+// Each item is a glob pattern, a file, or "@<file>" of paths (or patterns), one per line.
+static std::vector<std::string> ExpandTraces(const std::string &spec)
+{
+  std::vector<std::string> patterns;
+  for (std::string &item : strutil::split(spec, ","))
+  {
+    if (!strutil::starts_with(item, "@"))
+    {
+      patterns.push_back(item);
+      continue;
+    }
+    std::ifstream file(item.substr(1));
+    if (!file.is_open())
+    {
+      printf("Invalid File! \"%s\" is not valid path.\n", item.substr(1).c_str());
+      exit(1);
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+      line = strutil::trim_copy(line);
+      if (!line.empty() && line[0] != '#')
+        patterns.push_back(line);
+    }
+  }
+
+  std::vector<std::pair<uint64_t, std::string>> traces;
+  for (std::string &pattern : patterns)
+  {
+    glob_t globbed;
+    if (glob(pattern.c_str(), 0, nullptr, &globbed) != 0)
+    {
+      printf("Invalid batch! \"%s\" matches no trace.\n", pattern.c_str());
+      exit(1);
+    }
+    for (size_t i = 0; i < globbed.gl_pathc; i++)
+    {
+      struct stat info;
+      stat(globbed.gl_pathv[i], &info);
+      traces.push_back({ (uint64_t)info.st_size, globbed.gl_pathv[i] });
+    }
+    globfree(&globbed);
+  }
+
+  // largest first, the order is stable for traces of the same size
+  std::stable_sort(traces.begin(), traces.end(),
+      [](const std::pair<uint64_t, std::string> &lhs, const std::pair<uint64_t, std::string> &rhs) {
+        return lhs.first > rhs.first;
+      });
+  std::vector<std::string> paths;
+  for (auto &trace : traces)
+    paths.push_back(trace.second);
+  return paths;
+}
+
+// Single writer of the results of all the runs.
+// A run submits its printing, and the writer thread prints the submissions one at a time in order,
+// so that the result files are appended by one thread only.
+class ResultWriter
+{
+public:
+  /*** constructors ***/
+  ResultWriter()
+    : m_IsClosed(false)
+  {
+    m_Thread = std::thread(&ResultWriter::writeLoop, this);
+  }
+  ~ResultWriter() { Close(); }
+
+  /*** methods ***/
+  void Submit(std::function<void()> print)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Queue.push_back(std::move(print));
+    m_CondVar.notify_one();
+  }
+
+  // print all the submissions, and stop the writer
+  void Close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (m_IsClosed)
+        return;
+      m_IsClosed = true;
+      m_CondVar.notify_one();
+    }
+    m_Thread.join();
+  }
+
+private:
+  void writeLoop()
+  {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+      m_CondVar.wait(lock, [&]() { return !m_Queue.empty() || m_IsClosed; });
+      if (m_Queue.empty())
+        break;
+      std::function<void()> print = std::move(m_Queue.front());
+      m_Queue.pop_front();
+      lock.unlock();
+      print();
+      lock.lock();
+    }
+  }
+
+private:
+  std::thread m_Thread;
+  std::mutex m_Mutex;
+  std::condition_variable m_CondVar;
+  std::deque<std::function<void()>> m_Queue;
+  bool m_IsClosed;
+};
+
+// Work-stealing pool of the runs.
+// Jobs are dealt round-robin in the given order (the largest first) to a deque per worker.
+// A worker takes the front of its own deque, the largest job it has,
+// and an idle worker steals the largest job left in the other deques,
+// so that a large trace never waits behind small ones at the end of the batch.
+class BatchRunner
+{
+  struct Worker
+  {
+    std::mutex Mutex;
+    std::deque<unsigned> Jobs;
+  };
+
+public:
+  /*** constructors ***/
+  BatchRunner(unsigned numThreads)
+    : m_Workers(std::max(1u, numThreads)) {}
+
+  /*** methods ***/
+  // run job(i) for each i < numJobs
+  void Run(unsigned numJobs, std::function<void(unsigned)> job)
+  {
+    for (unsigned i = 0; i < numJobs; i++)
+      m_Workers[i % m_Workers.size()].Jobs.push_back(i);
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < m_Workers.size(); w++)
+      threads.emplace_back(&BatchRunner::work, this, w, std::ref(job));
+    for (std::thread &thread : threads)
+      thread.join();
+  }
+
+private:
+  void work(unsigned self, std::function<void(unsigned)> &job)
+  {
+    unsigned i;
+    while (pop(self, i) || steal(i))
+      job(i);
+  }
+
+  bool pop(unsigned w, unsigned &i)
+  {
+    Worker &worker = m_Workers[w];
+    std::lock_guard<std::mutex> lock(worker.Mutex);
+    if (worker.Jobs.empty())
+      return false;
+    i = worker.Jobs.front();
+    worker.Jobs.pop_front();
+    return true;
+  }
+
+  // jobs are never added once running, so a pass finding all deques empty ends the worker
+  bool steal(unsigned &i)
+  {
+    while (true)
+    {
+      // jobs are numbered the largest first, so the smallest front is the largest job
+      int victim = -1;
+      unsigned minJob = 0;
+      for (unsigned w = 0; w < m_Workers.size(); w++)
+      {
+        std::lock_guard<std::mutex> lock(m_Workers[w].Mutex);
+        if (!m_Workers[w].Jobs.empty() && (victim == -1 || m_Workers[w].Jobs.front() < minJob))
+        {
+          victim = w;
+          minJob = m_Workers[w].Jobs.front();
+        }
+      }
+      if (victim == -1)
+        return false;
+
+      // the victim may have been emptied in the meantime
+      if (pop(victim, i))
+        return true;
+    }
+  }
+
+private:
+  std::vector<Worker> m_Workers;
+};
+
+}
+
+#endif  // __BATCH_H__
@@ -0,0 +1,405 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+#include <fmt/core.h>
+#include <cxxopts.hpp>
+
+#include "../compressor/VPC.h"
+#include "../compressor/FPC.h"
+#include "../compressor/BDI.h"
+#include "../compressor/CPACK.h"
+#include "../compressor/SC2.h"
+#include "../compressor/Pattern.h"
+#include "../compressor/BPC.h"
+#include "../compressor/RecordWriter.h"
+
+#include "../compressor/VPCmodules/CompStruct.h"
+#include "../compressor/VPCmodules/PredictorModule.h"
+#include "../compressor/VPCmodules/ResidueModule.h"
+#include "../compressor/VPCmodules/BitplaneModule.h"
+#include "../compressor/VPCmodules/XORModule.h"
+#include "../compressor/VPCmodules/ScanModule.h"
+#include "../compressor/VPCmodules/FPCModule.h"
+
+#include "../loader/LoaderSynthetic.h"
+
+#include "../utils.h"
+
+// number of lines compressed at once, same as the main driver
+#define BATCH_LINES 4096
+
+// decode latency histogram,
+// bin i counts lines decoded in [2^(i+3), 2^(i+4)) ns, the first and the last bins are open-ended
+#define NUM_LATENCY_BINS 12
+
+/*** synthetic line distributions ***/
+enum Distribution
+{
+  ALLZERO = 0,
+  REPEATED,
+  SMALLDELTA,
+  RANDOM,
+  FLOATLIKE,
+  POINTER,
+  MIXED,
+  NUM_DISTRIBUTIONS,
+};
+
+static const char *DISTRIBUTION_NAMES[NUM_DISTRIBUTIONS] = {
+  "allzero", "repeated", "smalldelta", "random", "floatlike", "pointer", "mixed",
+};
+
+void generateLines(Distribution dist, uint8_t *lines, unsigned numLines, unsigned lineSize, uint64_t seed)
+{
+  trace::SyntheticSpec_t spec;
+  spec.seed = seed;
+  spec.numLines = numLines;
+  spec.lineSize = lineSize;
+
+  // a single class of the mixture, or all of them
+  const trace::SynClass distClasses[NUM_DISTRIBUTIONS] = {
+    trace::SYN_ZERO, trace::SYN_REPEATED, trace::SYN_BASEDELTA,
+    trace::SYN_RANDOM, trace::SYN_FP32, trace::SYN_POINTER, trace::NUM_SYN_CLASSES,
+  };
+  for (int c = 0; c < trace::NUM_SYN_CLASSES; c++)
+    spec.weights[c] = (dist == MIXED || distClasses[dist] == c) ? 1 : 0;
+
+  trace::LoaderSynthetic loader(spec);
+  for (unsigned n = 0; n < numLines; n++)
+    loader.GenerateLine(n, lines + (size_t)n * lineSize);
+}
+
+/*** result ***/
+struct BenchResult
+{
+  std::string Target;
+  std::string Distribution;
+  uint64_t NumLines;
+  double Seconds;
+  double CompRatio;
+
+  void Print(std::string filePath = "")
+  {
+    comp::RecordWriter writer(filePath);
+    writer.Header("target,distribution,lines,seconds,lines_per_sec,ns_per_line,comp_ratio,");
+
+    writer.Field("target", Target);
+    writer.Field("distribution", Distribution);
+    writer.Field("lines", NumLines);
+    writer.Field("seconds", Seconds);
+    writer.Field("lines_per_sec", (double)NumLines / Seconds);
+    writer.Field("ns_per_line", Seconds * 1e9 / (double)NumLines);
+    writer.Field("comp_ratio", CompRatio);
+    writer.EndRow();
+  }
+};
+
+struct DecodeResult
+{
+  std::string Target;
+  std::string Distribution;
+  uint64_t NumLines;
+  uint64_t EncodedBits;
+  uint64_t NumRoundTripErrors;
+  double Seconds;
+  uint64_t Histogram[NUM_LATENCY_BINS];
+
+  void Print(std::string filePath = "")
+  {
+    comp::RecordWriter writer(filePath);
+    if (writer.IsNew())
+    {
+      std::string header = "target,distribution,lines,encoded_bits,roundtrip_errors,seconds,ns_per_line,";
+      for (int i = 0; i < NUM_LATENCY_BINS - 1; i++)
+        header += fmt::format("lt_{}ns,", 1 << (i + 4));
+      header += fmt::format("ge_{}ns,", 1 << (NUM_LATENCY_BINS + 2));
+      writer.Header(header);
+    }
+
+    writer.Field("target", Target);
+    writer.Field("distribution", Distribution);
+    writer.Field("lines", NumLines);
+    writer.Field("encoded_bits", EncodedBits);
+    writer.Field("roundtrip_errors", NumRoundTripErrors);
+    writer.Field("seconds", Seconds);
+    writer.Field("ns_per_line", Seconds * 1e9 / (double)NumLines);
+    for (int i = 0; i < NUM_LATENCY_BINS - 1; i++)
+      writer.Field(fmt::format("lt_{}ns", 1 << (i + 4)), Histogram[i]);
+    writer.Field(fmt::format("ge_{}ns", 1 << (NUM_LATENCY_BINS + 2)), Histogram[NUM_LATENCY_BINS - 1]);
+    writer.EndRow();
+  }
+};
+
+// wall time of a single run of func, in seconds
+double timeIt(std::function<void()> func)
+{
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+/*** compressors ***/
+BenchResult benchCompressor(std::string name, comp::Compressor *compressor,
+    Distribution dist, uint8_t *lines, unsigned numLines, unsigned lineSize)
+{
+  std::vector<unsigned> compSizes(BATCH_LINES);
+
+  double seconds = timeIt([&]() {
+    for (unsigned n = 0; n < numLines; n += BATCH_LINES)
+    {
+      unsigned numBatchedLines = std::min<unsigned>(BATCH_LINES, numLines - n);
+      compressor->CompressLines(lines + (size_t)n * lineSize, numBatchedLines, lineSize, compSizes.data());
+    }
+  });
+
+  BenchResult result = { name, DISTRIBUTION_NAMES[dist], numLines, seconds, compressor->GetResult()->CompRatio };
+  return result;
+}
+
+/*** decompression ***/
+// Lines are encoded into a single stream, then decoded twice by fresh instances of the compressor:
+// once back to back for the throughput, and once line by line for the latency histogram.
+// Returns false if the compressor can not be decoded as configured.
+bool benchDecoder(std::string name, std::function<comp::Compressor*()> makeCompressor,
+    Distribution dist, uint8_t *lines, unsigned numLines, unsigned lineSize, DecodeResult &result)
+{
+  comp::Compressor *encoder = makeCompressor();
+  if (!encoder->IsDecodable())
+  {
+    delete encoder;
+    return false;
+  }
+
+  std::vector<std::vector<uint8_t>> dataLines(numLines);
+  comp::BitWriter writer;
+  for (unsigned n = 0; n < numLines; n++)
+  {
+    dataLines[n].assign(lines + (size_t)n * lineSize, lines + (size_t)(n + 1) * lineSize);
+    encoder->EncodeLine(dataLines[n], writer);
+  }
+  delete encoder;
+
+  result = { name, DISTRIBUTION_NAMES[dist], numLines, writer.GetNumBits(), 0, 0, { 0 } };
+
+  // throughput
+  {
+    comp::Compressor *decoder = makeCompressor();
+    comp::BitReader reader(writer.GetBuffer().data(), writer.GetNumBits());
+    std::vector<uint8_t> decodedLine(lineSize);
+    volatile int sink = 0;
+    result.Seconds = timeIt([&]() {
+      for (unsigned n = 0; n < numLines; n++)
+      {
+        decoder->DecodeLine(reader, decodedLine);
+        sink += decodedLine[lineSize - 1];
+      }
+    });
+    delete decoder;
+  }
+
+  // latency and correctness
+  {
+    comp::Compressor *decoder = makeCompressor();
+    comp::BitReader reader(writer.GetBuffer().data(), writer.GetNumBits());
+    std::vector<uint8_t> decodedLine(lineSize);
+    for (unsigned n = 0; n < numLines; n++)
+    {
+      auto start = std::chrono::steady_clock::now();
+      bool isValid = decoder->DecodeLine(reader, decodedLine);
+      auto end = std::chrono::steady_clock::now();
+
+      uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+      int bin = (ns < 16) ? 0 : std::min(63 - __builtin_clzll(ns) - 3, NUM_LATENCY_BINS - 1);
+      result.Histogram[bin]++;
+      result.NumRoundTripErrors += (!isValid || decodedLine != dataLines[n]);
+    }
+    delete decoder;
+  }
+
+  return true;
+}
+
+/*** VPC modules ***/
+// modules are instantiated with default tables:
+//  4-byte stride predictor, identity scan, common FPC encoder
+std::vector<BenchResult> benchModules(Distribution dist, uint8_t *lines, unsigned numLines, unsigned lineSize)
+{
+  std::vector<BenchResult> results;
+
+  std::vector<int> baseIndexTable(lineSize);
+  std::vector<float> weightTable(lineSize, 1.0f);
+  for (unsigned i = 0; i < lineSize; i++)
+    baseIndexTable[i] = (i < 4) ? 0 : i - 4;
+  comp::WeightBasePredictor predictor(0, lineSize, baseIndexTable, weightTable);
+  comp::ResidueModule residueModule(&predictor);
+
+  comp::BitplaneModule bitplaneModule;
+  comp::XORModule xorModule(true);
+
+  const int tableSize = lineSize * BYTE;
+  std::vector<int> rows(tableSize);
+  std::vector<int> cols(tableSize);
+  for (int i = 0; i < tableSize; i++)
+  {
+    rows[i] = i / lineSize;
+    cols[i] = i % lineSize;
+  }
+  comp::ScanModule scanModule(tableSize, rows, cols);
+  comp::FPCModule fpcModule;
+
+  // inputs of each stage
+  std::vector<std::vector<uint8_t>> dataLines(numLines);
+  for (unsigned n = 0; n < numLines; n++)
+    dataLines[n].assign(lines + (size_t)n * lineSize, lines + (size_t)(n + 1) * lineSize);
+  std::vector<comp::Symbol> residues(numLines);
+  std::vector<comp::Binary> bitplanes(numLines);
+  std::vector<comp::Binary> xored(numLines);
+  std::vector<comp::Binary> scanned(numLines);
+  for (unsigned n = 0; n < numLines; n++)
+  {
+    residues[n] = residueModule.ProcessLine(dataLines[n]);
+    bitplanes[n] = bitplaneModule.ProcessLine(residues[n]);
+    xored[n] = bitplanes[n];
+    xorModule.ProcessLine(xored[n]);
+    scanned[n] = scanModule.ProcessLine(xored[n]);
+  }
+
+  // a sink to keep the results alive
+  volatile int sink = 0;
+  double seconds;
+
+  seconds = timeIt([&]() {
+    for (unsigned n = 0; n < numLines; n++)
+      sink += predictor.PredictLine(dataLines[n])[lineSize - 1];
+  });
+  results.push_back({ "WeightBasePredictor", DISTRIBUTION_NAMES[dist], numLines, seconds, 0 });
+
+  seconds = timeIt([&]() {
+    for (unsigned n = 0; n < numLines; n++)
+      sink += bitplaneModule.ProcessLine(residues[n]).GetRowSize();
+  });
+  results.push_back({ "BitplaneModule", DISTRIBUTION_NAMES[dist], numLines, seconds, 0 });
+
+  // in place, the bitplanes are not used after
+  seconds = timeIt([&]() {
+    for (unsigned n = 0; n < numLines; n++)
+    {
+      xorModule.ProcessLine(bitplanes[n]);
+      sink += bitplanes[n][1][1];
+    }
+  });
+  results.push_back({ "XORModule", DISTRIBUTION_NAMES[dist], numLines, seconds, 0 });
+
+  seconds = timeIt([&]() {
+    for (unsigned n = 0; n < numLines; n++)
+      sink += scanModule.ProcessLine(xored[n]).GetRowSize();
+  });
+  results.push_back({ "ScanModule", DISTRIBUTION_NAMES[dist], numLines, seconds, 0 });
+
+  uint64_t compressedBits = 0;
+  seconds = timeIt([&]() {
+    for (unsigned n = 0; n < numLines; n++)
+      compressedBits += fpcModule.ProcessLine(scanned[n]);
+  });
+  results.push_back({ "FPCModule", DISTRIBUTION_NAMES[dist], numLines, seconds,
+      (double)((uint64_t)numLines * lineSize * BYTE) / (double)compressedBits });
+
+  return results;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned numLines;
+  unsigned lineSize;
+  uint64_t seed;
+  std::string configPath;
+  std::string outputPath;
+  std::string decodeOutputPath;
+
+  // parse arguments
+  {
+  cxxopts::Options options("Bench");
+
+  options.add_options()
+    ("n,lines",  "Number of lines per distribution. Default=65536", cxxopts::value<unsigned>())
+    ("l,lineSize", "Line size in bytes. Must match the VPC config. Default=32", cxxopts::value<unsigned>())
+    ("s,seed",   "Random seed. Default=0", cxxopts::value<uint64_t>())
+    ("c,config", "VPC config file path (.json). VPC is skipped if not given.", cxxopts::value<std::string>())
+    ("o,output", "Output file path (.csv, .jsonl or .mpcr). Default=stdout", cxxopts::value<std::string>())
+    ("d,decodeOutput", "Decompression output file path (.csv, .jsonl or .mpcr). Default=stdout", cxxopts::value<std::string>())
+    ("h,help",   "Print usage");
+  auto args = options.parse(argc, argv);
+
+  numLines = args.count("lines") ? args["lines"].as<unsigned>() : 65536;
+  lineSize = args.count("lineSize") ? args["lineSize"].as<unsigned>() : 32;
+  seed = args.count("seed") ? args["seed"].as<uint64_t>() : 0;
+  configPath = args.count("config") ? args["config"].as<std::string>() : "";
+  outputPath = args.count("output") ? args["output"].as<std::string>() : "";
+  decodeOutputPath = args.count("decodeOutput") ? args["decodeOutput"].as<std::string>() : "";
+
+  // help message
+  if (args.count("help"))
+  {
+    std::cout << options.help() << std::endl;
+    exit(0);
+  }
+  }
+
+  if (lineSize % 8 != 0 || lineSize > MAX_LINESIZE)
+  {
+    printf("Invalid line size! %u is not a multiple of 8 up to %d.\n", lineSize, MAX_LINESIZE);
+    exit(1);
+  }
+
+  std::vector<uint8_t> lines((size_t)numLines * lineSize);
+  for (int d = 0; d < NUM_DISTRIBUTIONS; d++)
+  {
+    Distribution dist = (Distribution)d;
+    generateLines(dist, lines.data(), numLines, lineSize, seed + d);
+
+    std::vector<BenchResult> results;
+    std::vector<std::pair<std::string, comp::Compressor*>> compressors;
+    if (configPath != "")
+      compressors.push_back({ "VPC", new comp::VPC(configPath) });
+    compressors.push_back({ "FPC", new comp::FPC(lineSize) });
+    compressors.push_back({ "BDI", new comp::BDI(lineSize) });
+    compressors.push_back({ "BPC", new comp::BPC(lineSize) });
+    compressors.push_back({ "CPACK", new comp::CPACK(lineSize) });
+    compressors.push_back({ "SC2", new comp::SC2(lineSize, std::max<unsigned>(1, numLines / 10)) });
+    compressors.push_back({ "PATTERN", new comp::Pattern(lineSize) });
+
+    for (auto &compressor : compressors)
+    {
+      results.push_back(benchCompressor(compressor.first, compressor.second,
+            dist, lines.data(), numLines, lineSize));
+      delete compressor.second;
+    }
+
+    std::vector<BenchResult> moduleResults = benchModules(dist, lines.data(), numLines, lineSize);
+    results.insert(results.end(), moduleResults.begin(), moduleResults.end());
+
+    for (BenchResult &result : results)
+      result.Print(outputPath);
+
+    std::vector<std::pair<std::string, std::function<comp::Compressor*()>>> decoders;
+    if (configPath != "")
+      decoders.push_back({ "VPC", [&]() { return new comp::VPC(configPath); } });
+    decoders.push_back({ "FPC", [&]() { return new comp::FPC(lineSize); } });
+    decoders.push_back({ "BDI", [&]() { return new comp::BDI(lineSize); } });
+    decoders.push_back({ "BPC", [&]() { return new comp::BPC(lineSize); } });
+    decoders.push_back({ "CPACK", [&]() { return new comp::CPACK(lineSize); } });
+
+    for (auto &decoder : decoders)
+    {
+      DecodeResult decodeResult;
+      if (benchDecoder(decoder.first, decoder.second, dist, lines.data(), numLines, lineSize, decodeResult))
+        decodeResult.Print(decodeOutputPath);
+    }
+  }
+
+  return 0;
+}
@@ -1,66 +1,105 @@
+#include <cstring>
+#include <algorithm>
+#include <cassert>
 #include "BDI.h"
 
 namespace comp
 {
 
+// encoding tag of each BDIState, and of the base-delta ones with raw bases
+#define BDI_TAG_SIZE 4
+#define BDI_RAWBASE_TAG_OFFSET 7
+
+// base and delta sizes of each BDIState
+static const unsigned BDI_BASE_SIZE[9]  = { 0, 0, 8, 8, 8, 4, 4, 2, 0 };
+static const unsigned BDI_DELTA_SIZE[9] = { 0, 0, 1, 2, 4, 1, 2, 1, 0 };
+// names of each BDIState in the config
+static const char *BDI_STATE_NAMES[9] = { "zeros", "repeated", "b8d1", "b8d2", "b8d4", "b4d1", "b4d2", "b2d1", "uncompressed" };
+
 unsigned BDI::CompressLine(std::vector<uint8_t> &dataLine)
 {
   const unsigned lineSize = dataLine.size();
   const unsigned uncompressedSize = BYTE * lineSize;
 
-  BDIState select = BDIState::Uncompressed;
+  BDIState select;
+  unsigned compressedSize = compressLine(dataLine.data(), lineSize, select);
+  static_cast<BDIResult*>(m_Stat)->Update(uncompressedSize, compressedSize, (int)select);
+  return compressedSize;
+}
+
+void BDI::CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+    int *selected)
+{
+  uint64_t counts[9] = { 0 };
+  uint64_t compressedSize = 0;
+
+  BDIState select;
+  for (unsigned i = 0; i < numLines; i++)
+  {
+    compSizes[i] = compressLine(dataLines + i * lineSize, lineSize, select);
+    compressedSize += compSizes[i];
+    counts[(int)select]++;
+    if (selected != nullptr)
+      selected[i] = (int)select;
+  }
+
+  const uint64_t uncompressedSize = (uint64_t)BYTE * lineSize * numLines;
+  static_cast<BDIResult*>(m_Stat)->UpdateBatch(uncompressedSize, compressedSize, counts);
+  m_Stat->UpdateSizes(compSizes, numLines);
+}
+
+void BDI::RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record)
+{
+  BDIState select;
+  record.CompSize = compressLine(dataLine, lineSize, select);
+  record.Selected = (int)select;
+  ReplayLine(lineSize, record);
+}
+
+void BDI::ReplayLine(unsigned lineSize, const LineRecord &record)
+{
+  static_cast<BDIResult*>(m_Stat)->Update(BYTE * lineSize, record.CompSize, record.Selected);
+}
+
+unsigned BDI::compressLine(const uint8_t *dataLine, const unsigned lineSize, BDIState &select)
+{
+  const unsigned uncompressedSize = BYTE * lineSize;
+
+  select = BDIState::Uncompressed;
 
   unsigned bestCSize, currCSize;
   currCSize = uncompressedSize;
   bestCSize = currCSize;
 
-  if(isZeros(dataLine))
+  if(m_Enabled[(int)BDIState::Zeros] && isZeros(dataLine, lineSize))
   {
     bestCSize = BYTE;
     select = BDIState::Zeros;
   }
-  else if(isRepeated(dataLine, 8))
+  else if(m_Enabled[(int)BDIState::Repeat] && isRepeated(dataLine, lineSize, 8))
   {
     bestCSize = BYTE * 8;
     select = BDIState::Repeat;
   }
   else
   {
-    // base8-delta1
-    // bestcase[32B / 64B] : (8+3)Bytes+4bits / (8+7)Bytes+8bits
-    currCSize = checkBDI(dataLine, 8, 1);
-    select = bestCSize > currCSize ? BDIState::Base8Delta1 : select;
-    bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
-
-    // base8-delta2
-    // bestcase[32B / 64B] : (8+6)Bytes+4bits / (8+14)Bytes+8bits
-    currCSize = checkBDI(dataLine, 8, 2);
-    select = bestCSize > currCSize ? BDIState::Base8Delta2 : select;
-    bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
-
-    // base8-delta4
-    // bestcase[32B / 64B] : (8+12)Bytes+4bits / (8+28)Bytes+8bits
-    currCSize = checkBDI(dataLine, 8, 4);
-    select = bestCSize > currCSize ? BDIState::Base8Delta4 : select;
-    bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
-
-    // base4-delta1
-    // bestcase[32B / 64B] : (4+7)Bytes+8bits / (4+15)Bytes+16bits
-    currCSize = checkBDI(dataLine, 4, 1);
-    select = bestCSize > currCSize ? BDIState::Base4Delta1 : select;
-    bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
-
-    // base4-delta2
-    // bestcase[32B / 64B] : (4+14)Bytes+8bits / (4+30)Bytes+16bits
-    currCSize = checkBDI(dataLine, 4, 2);
-    select = bestCSize > currCSize ? BDIState::Base4Delta2 : select;
-    bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
-
-    // base2-delta1
-    // bestcase[32B / 64B] : (2+15)Bytes+16bits / (2+31)Bytes+32bits
-    currCSize = checkBDI(dataLine, 2, 1);
-    select = bestCSize > currCSize ? BDIState::Base2Delta1 : select;
-    bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
+    // base-delta encodings in the order of BDIState, the first smallest one is selected
+    //  e.g. base8-delta1, bestcase[32B / 64B] : (8+3)Bytes+4bits / (8+7)Bytes+8bits
+    //  the sizes are constants in each case, so that checkBDI is specialized for each of them
+    for (const BDIState state : m_BaseDeltas)
+    {
+      switch (state)
+      {
+        case BDIState::Base8Delta1: currCSize = checkBDI(dataLine, lineSize, 8, 1); break;
+        case BDIState::Base8Delta2: currCSize = checkBDI(dataLine, lineSize, 8, 2); break;
+        case BDIState::Base8Delta4: currCSize = checkBDI(dataLine, lineSize, 8, 4); break;
+        case BDIState::Base4Delta1: currCSize = checkBDI(dataLine, lineSize, 4, 1); break;
+        case BDIState::Base4Delta2: currCSize = checkBDI(dataLine, lineSize, 4, 2); break;
+        default:                    currCSize = checkBDI(dataLine, lineSize, 2, 1); break;
+      }
+      select = bestCSize > currCSize ? state : select;
+      bestCSize = bestCSize > currCSize ? currCSize : bestCSize;
+    }
 
     // incompressible
     select = (bestCSize == uncompressedSize) ? BDIState::Uncompressed : select;
@@ -68,100 +107,82 @@ unsigned BDI::CompressLine(std::vector<uint8_t> &dataLine)
   }
 
   // compressedSize + encodingBits
-  int compressedSize = (bestCSize + 4);
-  static_cast<BDIResult*>(m_Stat)->Update(uncompressedSize, compressedSize, (int)select);
-  return compressedSize;
+  return bestCSize + BDI_TAG_SIZE;
+}
+
+void BDI::parseConfig(const Json::Value &root)
+{
+  // encodings, all of them if not given
+  const Json::Value &encodings = root["encodings"];
+  if (!encodings.isNull())
+  {
+    std::fill(m_Enabled, m_Enabled + BDI_NUM_STATES, false);
+    m_Enabled[(int)BDIState::Uncompressed] = true;
+    for (const Json::Value &encoding : encodings)
+    {
+      const char **name = std::find(BDI_STATE_NAMES, BDI_STATE_NAMES + (int)BDIState::Uncompressed, encoding.asString());
+      if (name == BDI_STATE_NAMES + (int)BDIState::Uncompressed)
+      {
+        printf("Invalid config! \"%s\" is not a BDI encoding.\n", encoding.asString().c_str());
+        exit(1);
+      }
+      m_Enabled[name - BDI_STATE_NAMES] = true;
+    }
+  }
+
+  m_BaseDeltas.clear();
+  for (int state = (int)BDIState::Base8Delta1; state <= (int)BDIState::Base2Delta1; state++)
+    if (m_Enabled[state])
+      m_BaseDeltas.push_back((BDIState)state);
 }
 
-bool BDI::isZeros(std::vector<uint8_t> &dataLine)
+bool BDI::isZeros(const uint8_t *dataLine, const unsigned lineSize)
 {
-  for(int i = 0; i < dataLine.size(); i++)
+  for(unsigned i = 0; i < lineSize; i++)
     if(dataLine[i] != 0)
       return false;
   return true;
 }
 
-bool BDI::isRepeated(std::vector<uint8_t> &dataLine, const unsigned granularity)
+bool BDI::isRepeated(const uint8_t *dataLine, const unsigned lineSize, const unsigned granularity)
 {
-  // data concatenation
-  std::vector<uint64_t> dataConcat;
-  uint64_t temp;
-
-  unsigned dataConcatSize = dataLine.size() / granularity;
-  for(int i = 0; i < dataConcatSize; i++)
-  {
-    temp = 0;
-    for(int j = 0; j < granularity; j++)
-      temp = (temp << BYTE) | dataLine[i*granularity + j];
-
-    dataConcat.push_back(temp);
-  }
-
   // repeated block check
-  uint64_t firstVal = dataConcat[0];
-  for(int i = 1; i < dataConcatSize; i++)
-    if(dataConcat[i] != firstVal)
+  // comparing the raw bytes of each block is the same as comparing the concatenated values
+  for(int i = granularity; i + granularity <= lineSize; i += granularity)
+    if(std::memcmp(dataLine, dataLine + i, granularity) != 0)
       return false;
   return true;
 }
 
-unsigned BDI::checkBDI(std::vector<uint8_t> &dataLine,
-    const unsigned baseSize, const unsigned deltaSize)
+unsigned BDI::checkBDI(const uint8_t *dataLine, const unsigned lineSize,
+    const unsigned baseSize, const unsigned deltaSize, BitWriter *writer, const unsigned tag)
 {
-  const unsigned lineSize = dataLine.size();
-  uint64_t deltaLimit = 0;
-
-  // maximum size delta can have
-  switch(deltaSize)
+  // define appropriate size for the immediate-mask
+  const unsigned maskSize = lineSize / baseSize;
+  if (m_Concat.size() < maskSize)
   {
-  case 1:
-    deltaLimit = BYTEMAX;
-    break;
-  case 2:
-    deltaLimit = BYTE2MAX;
-    break;
-  case 4:
-    deltaLimit = BYTE4MAX;
-    break;
+    m_Concat.resize(maskSize);
+    m_Mask.resize(maskSize);
   }
+  uint8_t *mask = m_Mask.data();
 
-  // little endian
-  std::vector<uint8_t> littleEndian;
-  for(int i = 0; i < lineSize; i += baseSize)
-    for(int j = baseSize-1; j >= 0; j--)
-      littleEndian.push_back(dataLine[i + j]);
-
-  // define appropriate size for the immediate-mask
-  unsigned maskSize = lineSize / baseSize;
-  bool* mask = new bool[maskSize];
-  for(int i = 0; i < maskSize; i++)
-    mask[i] = false;
-
-  // concatenate little endian'ed data in a new vector
-  std::vector<uint64_t> dataConcat;
-  uint64_t temp;
+  // concatenate bytes of each block in little endian
+  uint64_t *dataConcat = m_Concat.data();
   for(int i = 0; i < maskSize; i++)
   {
-    temp = 0;
-    for(int j = 0; j < baseSize; j++)
-      temp = (temp << BYTE) | littleEndian[i*baseSize + j];
-
-    // sign extension
-    if((temp & (1 << (BYTE*baseSize-1))) != 0)
-      temp &= BYTE8MAX;
+    uint64_t temp = 0;
+    for(int j = baseSize-1; j >= 0; j--)
+      temp = (temp << BYTE) | dataLine[i*baseSize + j];
 
-    dataConcat.push_back(temp);
+    dataConcat[i] = temp;
   }
 
   // find immediate block
   unsigned immediateCount = 0;
   for(int i = 0; i < maskSize; i++)
   {
-    if(reduceSign(dataConcat[i]) <= deltaLimit)
-    {
-      mask[i] = true;
-      immediateCount++;
-    }
+    mask[i] = isDelta(dataConcat[i], baseSize, deltaSize);
+    immediateCount += mask[i];
   }
 
   // find non-zero base
@@ -183,7 +204,7 @@ unsigned BDI::checkBDI(std::vector<uint8_t> &dataLine,
   {
     if(!mask[i])
     {
-      if(reduceSign(base - dataConcat[i]) > deltaLimit)
+      if(!isDelta(dataConcat[i] - base, baseSize, deltaSize))
       {
         notAllDelta = true;
         break;
@@ -191,7 +212,29 @@ unsigned BDI::checkBDI(std::vector<uint8_t> &dataLine,
     }
   }
 
-  delete[] mask;
+  // write the stream of the selected encoding
+  //  tag, immediate-mask, then each block in order:
+  //  an immediate as a delta from zero, the base, and deltas from the base.
+  //  Non-immediate blocks are stored as-is under the raw-base tag when they are not all deltas,
+  //  and the last block takes the base slot when every block is immediate.
+  if(writer != nullptr)
+  {
+    const bool allImmediate = (immediateCount == maskSize);
+    writer->Write(notAllDelta ? tag + BDI_RAWBASE_TAG_OFFSET : tag, BDI_TAG_SIZE);
+    for(unsigned i = 0; i < maskSize; i++)
+      writer->Write(mask[i], 1);
+    for(unsigned i = 0; i < maskSize; i++)
+    {
+      if(allImmediate && i == maskSize - 1)
+        writer->Write(dataConcat[i], BYTE*baseSize);
+      else if(mask[i])
+        writer->Write(dataConcat[i], BYTE*deltaSize);
+      else if(notAllDelta || (int)i == baseIdx)
+        writer->Write(dataConcat[i], BYTE*baseSize);
+      else
+        writer->Write(dataConcat[i] - base, BYTE*deltaSize);
+    }
+  }
 
   // immediateMask + immediateDeltas + base + deltas
   if(notAllDelta)
@@ -200,21 +243,116 @@ unsigned BDI::checkBDI(std::vector<uint8_t> &dataLine,
     return maskSize + BYTE*((immediateCount*deltaSize) + (baseSize + (maskSize - immediateCount - 1)*deltaSize));
 }
 
-uint64_t BDI::reduceSign(uint64_t x)
+bool BDI::isDelta(uint64_t x, const unsigned baseSize, const unsigned deltaSize)
+{
+  // sign-extend the block, and check if it fits in deltaSize bytes
+  const unsigned shift = 64 - BYTE*baseSize;
+  const int64_t value = (int64_t)(x << shift) >> shift;
+  const int64_t limit = 1LL << (BYTE*deltaSize - 1);
+  return (value >= -limit) && (value < limit);
+}
+
+unsigned BDI::EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer)
+{
+  const unsigned lineSize = dataLine.size();
+  const unsigned uncompressedSize = BYTE * lineSize;
+
+  BDIState select;
+  unsigned compressedSize = compressLine(dataLine.data(), lineSize, select);
+  static_cast<BDIResult*>(m_Stat)->Update(uncompressedSize, compressedSize, (int)select);
+
+  switch(select)
+  {
+  case BDIState::Zeros:
+    writer.Write((unsigned)select, BDI_TAG_SIZE);
+    writer.Write(0, BYTE);
+    break;
+  case BDIState::Repeat:
+    writer.Write((unsigned)select, BDI_TAG_SIZE);
+    writer.WriteBytes(dataLine.data(), 8);
+    break;
+  case BDIState::Uncompressed:
+    writer.Write((unsigned)select, BDI_TAG_SIZE);
+    writer.WriteBytes(dataLine.data(), lineSize);
+    break;
+  default:
+    checkBDI(dataLine.data(), lineSize, BDI_BASE_SIZE[(int)select], BDI_DELTA_SIZE[(int)select],
+        &writer, (unsigned)select);
+    break;
+  }
+
+  return compressedSize;
+}
+
+bool BDI::DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine)
 {
-  uint64_t t = x >> 63;
-  if(t)
+  const unsigned lineSize = m_Stat->LineSize;
+  dataLine.resize(lineSize);
+
+  const unsigned tag = reader.Read(BDI_TAG_SIZE);
+  if(tag == (unsigned)BDIState::Zeros)
+  {
+    std::fill(dataLine.begin(), dataLine.end(), 0);
+    return (reader.Read(BYTE) == 0) && !reader.IsOverrun();
+  }
+  if(tag == (unsigned)BDIState::Repeat)
   {
-    for(int i = 62; i >= 0; i--)
+    reader.ReadBytes(dataLine.data(), 8);
+    for(unsigned i = 8; i < lineSize; i++)
+      dataLine[i] = dataLine[i % 8];
+    return !reader.IsOverrun();
+  }
+  if(tag == (unsigned)BDIState::Uncompressed)
+  {
+    reader.ReadBytes(dataLine.data(), lineSize);
+    return !reader.IsOverrun();
+  }
+  if(tag > (unsigned)BDIState::Uncompressed + BDI_RAWBASE_TAG_OFFSET - 1)
+    return false;
+
+  // base-delta
+  const bool notAllDelta = (tag > (unsigned)BDIState::Uncompressed);
+  const int state = notAllDelta ? tag - BDI_RAWBASE_TAG_OFFSET : tag;
+  const unsigned baseSize = BDI_BASE_SIZE[state];
+  const unsigned deltaSize = BDI_DELTA_SIZE[state];
+  const unsigned maskSize = lineSize / baseSize;
+
+  bool mask[MAX_LINESIZE / 2];
+  bool allImmediate = true;
+  for(unsigned i = 0; i < maskSize; i++)
+  {
+    mask[i] = reader.Read(1);
+    allImmediate &= mask[i];
+  }
+
+  const unsigned shift = 64 - BYTE*deltaSize;
+  uint64_t base = 0;
+  bool isBaseFound = false;
+  for(unsigned i = 0; i < maskSize; i++)
+  {
+    uint64_t value;
+    if((allImmediate && i == maskSize - 1) || (!mask[i] && (notAllDelta || !isBaseFound)))
     {
-      t = (x >> i) & 0x01;
-      if(t == 0)
+      value = reader.Read(BYTE*baseSize);
+      if(!mask[i])
       {
-        return x & (BYTE8MAX >> (63 - (i + 1)));
+        base = isBaseFound ? base : value;
+        isBaseFound = true;
       }
     }
+    else
+    {
+      // sign-extended delta, from zero or the base
+      value = (uint64_t)((int64_t)(reader.Read(BYTE*deltaSize) << shift) >> shift);
+      value += mask[i] ? 0 : base;
+    }
+
+    // little endian
+    for(unsigned j = 0; j < baseSize; j++)
+      dataLine[i*baseSize + j] = (value >> (BYTE*j)) & BYTEMAX;
   }
-  return x;
+
+  return !reader.IsOverrun();
 }
 
 }
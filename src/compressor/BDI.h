@@ -19,6 +19,7 @@ enum class BDIState
   Base2Delta1 = 7,
   Uncompressed = 8
 };
+#define BDI_NUM_STATES 9
 
 struct BDIResult : public CompResult
 {
@@ -32,55 +33,42 @@ struct BDIResult : public CompResult
     Counts[selected]++;
   }
 
+  void UpdateBatch(uint64_t uncompSize, uint64_t compSize, const uint64_t *counts)
+  {
+    CompResult::UpdateBatch(uncompSize, compSize);
+    for (int i = 0; i < 9; i++)
+      Counts[i] += counts[i];
+  }
+
+  virtual CompResult* Clone() { return new BDIResult(*this); }
+
+  virtual void Merge(CompResult *other)
+  {
+    CompResult::Merge(other);
+
+    BDIResult *result = static_cast<BDIResult*>(other);
+    for (int i = 0; i < 9; i++)
+      Counts[i] += result->Counts[i];
+  }
+
   virtual void Print(std::string workloadName = "", std::string filePath = "")
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")  // stdout
-    {
-      buff = std::cout.rdbuf();
-    }
-    else  // file
-    {
-      // write column index description
-      if (!isFileExists(filePath))
-      {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << "Workload,Original Size,Compressed Size,Compression Ratio,";
-        file << "Zeros,";
-        file << "Repeated,";
-        file << "B8D1,";
-        file << "B8D2,";
-        file << "B8D4,";
-        file << "B4D1,";
-        file << "B4D2,";
-        file << "B2D1,";
-        file << "Uncompressed,";
-        file << std::endl;
-        file.close();
-      }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
-    }
-    std::ostream stream(buff);
+    static const char *STATE_NAMES[9] = { "zeros", "repeated", "b8d1", "b8d2", "b8d4", "b4d1", "b4d2", "b2d1", "uncompressed" };
+
+    RecordWriter writer(filePath);
+    writer.Header("Workload,Original Size,Compressed Size,Compression Ratio,"
+        "Zeros,Repeated,B8D1,B8D2,B8D4,B4D1,B4D2,B2D1,Uncompressed,");
 
     // print result
     // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{0},{1},{2},{3},", workloadName, OriginalSize, CompressedSize, CompRatio);
+    writer.Field("workload", workloadName);
+    writer.Field("original_size", OriginalSize);
+    writer.Field("compressed_size", CompressedSize);
+    writer.Field("compression_ratio", CompRatio);
     // selection counts
     for (int i = 0; i < 9; i++)
-      stream << fmt::format("{},", Counts[i]);
-    stream << std::endl;
-
-    if (file.is_open())
-      file.close();
+      writer.Field(STATE_NAMES[i], Counts[i]);
+    writer.EndRow();
   }
 
   /*** member variables ***/
@@ -91,19 +79,47 @@ class BDI : public Compressor
 {
 public:
   /*** constructor ***/
-  BDI(unsigned lineSize)
+  // the config may enable a subset of the encodings, e.g. { "encodings": ["zeros", "b8d1", "b4d1"] }
+  BDI(unsigned lineSize, const Json::Value &config = Json::Value())
   {
     m_Stat = new BDIResult(lineSize);
     m_Stat->CompressorName = "Base-Delta Immediate";
+
+    std::fill(m_Enabled, m_Enabled + BDI_NUM_STATES, true);
+    for (int state = (int)BDIState::Base8Delta1; state <= (int)BDIState::Base2Delta1; state++)
+      m_BaseDeltas.push_back((BDIState)state);
+    if (!config.isNull())
+      parseConfig(config);
   }
 
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine);
+  virtual void CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+      int *selected = nullptr);
+
+  virtual unsigned EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer);
+  virtual bool DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine);
+  // every base size must divide the line, and the immediate-mask is bounded
+  virtual bool IsDecodable() { return (m_Stat->LineSize % 8 == 0) && (m_Stat->LineSize <= MAX_LINESIZE); }
+
+  virtual bool IsMemoizable() { return true; }
+  virtual void RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record);
+  virtual void ReplayLine(unsigned lineSize, const LineRecord &record);
+
+private:
+  void parseConfig(const Json::Value &root);
+  unsigned compressLine(const uint8_t *dataLine, const unsigned lineSize, BDIState &select);
+  bool isZeros(const uint8_t *dataLine, const unsigned lineSize);
+  bool isRepeated(const uint8_t *dataLine, const unsigned lineSize, const unsigned granularity);
+  unsigned checkBDI(const uint8_t *dataLine, const unsigned lineSize, const unsigned baseSize, const unsigned deltaSize,
+      BitWriter *writer = nullptr, const unsigned tag = 0);
+  bool isDelta(uint64_t x, const unsigned baseSize, const unsigned deltaSize);
 
 private:
-  bool isZeros(std::vector<uint8_t>& dataLine);
-  bool isRepeated(std::vector<uint8_t>& dataLine, const unsigned granularity);
-  unsigned checkBDI(std::vector<uint8_t>& dataLine, const unsigned baseSize, const unsigned deltaSize);
-  uint64_t reduceSign(uint64_t x);
+  bool m_Enabled[BDI_NUM_STATES];
+  std::vector<BDIState> m_BaseDeltas;   // enabled base-delta encodings, in order
+  // blocks of the line and their immediate-mask, grown to the widest line
+  std::vector<uint64_t> m_Concat;
+  std::vector<uint8_t> m_Mask;
 };
 
 }
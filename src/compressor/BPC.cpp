@@ -1,23 +1,214 @@
 #include <cstring>
+#include <cassert>
+#include <algorithm>
 #include "BPC.h"
 
 namespace comp
 {
 
-static const unsigned ZRL_CODE_SIZE[34] = {0, 3, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7};
 static const unsigned singleOneSize = 10;
 static const unsigned consecutiveDoubleOneSize = 10;
 static const unsigned allOneSize = 5;
 static const unsigned zeroDBPSize = 5;
 // 1        -> uncompressed
-// 01       -> Z-RLE: 2~33
+// 01       -> Z-RLE: 2~33 (ZRL_BITS of the length)
 // 001      -> Z-RLE: 1
 // 00000    -> single 1
 // 00001    -> consecutive two 1s
 // 00010    -> zero DBP
 // 00011    -> All 1s
 
-unsigned BPC::CompressLine(std::vector<uint8_t> &_dataLine)
+// a run longer than the length field allows is split into runs
+unsigned BPC::encodeZRL(unsigned runLength, BitWriter *writer)
+{
+  BPCResult* m_stat = static_cast<BPCResult*>(m_Stat);
+
+  unsigned length = 0;
+  while (runLength > 0)
+  {
+    const unsigned run = std::min(runLength, m_MaxZRL);
+    if (run == 1)
+    {
+      length += 3;
+      if (writer != nullptr)
+        writer->Write(0b001, 3);
+    }
+    else
+    {
+      length += 2 + m_ZRLBits;
+      if (writer != nullptr)
+        writer->Write((0b01 << m_ZRLBits) | (run - 2), 2 + m_ZRLBits);
+    }
+    m_stat->UpdatePattern(run, (int)BPCPattern::ZRLE);
+    runLength -= run;
+  }
+  return length;
+}
+
+void BPC::parseConfig(const Json::Value &root)
+{
+  // bits of the length of a zero run
+  m_ZRLBits = root.get("zrl_bits", m_ZRLBits).asUInt();
+  if (m_ZRLBits == 0 || m_ZRLBits > 5)
+  {
+    printf("Invalid config! zrl_bits %u is not in 1..5.\n", m_ZRLBits);
+    exit(1);
+  }
+  m_MaxZRL = (1 << m_ZRLBits) + 1;
+}
+
+unsigned BPC::CompressLine(std::vector<uint8_t> &dataLine)
+{
+  const unsigned lineSize = dataLine.size();
+  const unsigned uncompressedSize = BYTE * lineSize;
+
+  unsigned compressedSize = compressLine(dataLine.data(), lineSize);
+  m_Stat->Update(uncompressedSize, compressedSize);
+  return compressedSize;
+}
+
+void BPC::CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+    int *selected)
+{
+  uint64_t compressedSize = 0;
+  for (unsigned i = 0; i < numLines; i++)
+  {
+    compSizes[i] = compressLine(dataLines + i * lineSize, lineSize);
+    compressedSize += compSizes[i];
+  }
+
+  // patterns are selected per bit-plane
+  if (selected != nullptr)
+    std::fill(selected, selected + numLines, -1);
+
+  m_Stat->UpdateBatch((uint64_t)BYTE * lineSize * numLines, compressedSize);
+  m_Stat->UpdateSizes(compSizes, numLines);
+}
+
+void BPC::RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record)
+{
+  BPCResult* m_stat = static_cast<BPCResult*>(m_Stat);
+
+  // the patterns of the line are what compressing it adds to the result
+  const uint64_t totalWords = m_stat->TotalWords;
+  uint64_t counts[NUM_BPC_PATTERN];
+  std::copy(m_stat->Counts.begin(), m_stat->Counts.end(), counts);
+
+  record.CompSize = compressLine(dataLine, lineSize);
+  // patterns are selected per bit-plane
+  record.Selected = -1;
+  for (int i = 0; i < NUM_BPC_PATTERN; i++)
+    record.Counts[i] = m_stat->Counts[i] - counts[i];
+  record.Counts[NUM_BPC_PATTERN] = m_stat->TotalWords - totalWords;
+  m_Stat->Update(BYTE * lineSize, record.CompSize);
+}
+
+void BPC::ReplayLine(unsigned lineSize, const LineRecord &record)
+{
+  BPCResult* m_stat = static_cast<BPCResult*>(m_Stat);
+
+  m_stat->TotalWords += record.Counts[NUM_BPC_PATTERN];
+  for (int i = 0; i < NUM_BPC_PATTERN; i++)
+    m_stat->Counts[i] += record.Counts[i];
+  m_Stat->Update(BYTE * lineSize, record.CompSize);
+}
+
+unsigned BPC::EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer)
+{
+  const unsigned lineSize = dataLine.size();
+  const unsigned uncompressedSize = BYTE * lineSize;
+
+  unsigned compressedSize = compressLine(dataLine.data(), lineSize, &writer);
+  m_Stat->Update(uncompressedSize, compressedSize);
+  return compressedSize;
+}
+
+bool BPC::DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine)
+{
+  const unsigned lineSize = m_Stat->LineSize;
+  const unsigned numWords = lineSize / 4;
+  const int numDeltas = numWords - 1;
+  dataLine.resize(lineSize);
+
+  // first 32-bit word
+  uint32_t first;
+  if (reader.Read(1))
+  {
+    first = reader.Read(32);
+  }
+  else
+  {
+    const unsigned sizes[4] = { 0, 4, 8, 16 };
+    first = reader.Read(sizes[reader.Read(2)]);
+  }
+
+  // DBPs, from the DBX symbols
+  int32_t DBP[33];
+  int32_t prevDBP = 0;
+  int i = 32;
+  while (i >= 0)
+  {
+    int32_t DBX = 0;
+    if (reader.Read(1))           // uncompressed
+    {
+      DBX = reader.Read(31);
+    }
+    else if (reader.Read(1))      // Z-RLE: 2~33
+    {
+      unsigned runLength = reader.Read(m_ZRLBits) + 2;
+      if (runLength > (unsigned)(i + 1))
+        return false;
+      for (unsigned j = 0; j < runLength; j++)
+        DBP[i--] = prevDBP;
+      continue;
+    }
+    else if (reader.Read(1))      // Z-RLE: 1
+    {
+      DBP[i--] = prevDBP;
+      continue;
+    }
+    else
+    {
+      switch (reader.Read(2))
+      {
+      case 0b00:                  // single 1
+        DBX = 1u << reader.Read(5);
+        break;
+      case 0b01:                  // consecutive two 1s
+        DBX = 3u << reader.Read(5);
+        break;
+      case 0b10:                  // zero DBP
+        DBP[i] = 0;
+        prevDBP = 0;
+        i--;
+        continue;
+      default:                    // All 1s
+        DBX = 0x7fffffff;
+        break;
+      }
+    }
+    DBP[i] = DBX ^ prevDBP;
+    prevDBP = DBP[i];
+    i--;
+  }
+
+  // 33-bit deltas, transposed back from the DBPs
+  uint32_t data = first;
+  std::memcpy(&dataLine[0], &data, 4);
+  for (int row = 0; row < numDeltas; row++)
+  {
+    int64_t delta = 0;
+    for (int col = 32; col >= 0; col--)
+      delta = (delta << 1) | ((DBP[col] >> row) & 1);
+    delta = (int64_t)((uint64_t)delta << 31) >> 31;
+    data += (uint32_t)delta;
+    std::memcpy(&dataLine[4 * (row + 1)], &data, 4);
+  }
+
+  return !reader.IsOverrun();
+}
+
+unsigned BPC::compressLine(const uint8_t *_dataLine, const unsigned lineSize, BitWriter *writer)
 {
   /*
     The original dataline is placed in row-wise order.
@@ -32,22 +223,27 @@ unsigned BPC::CompressLine(std::vector<uint8_t> &_dataLine)
     |  data[31]  |            |   |   |   |   |   |
      ------------              -------------------
     */
-  const unsigned lineSize = _dataLine.size();
-  const unsigned uncompressedSize = BYTE * lineSize;
+  const unsigned numWords = lineSize / 4;
+  if (m_Words.size() < numWords)
+  {
+    m_Words.resize(numWords);
+    m_Deltas.resize(numWords);
+  }
 
   // converts uint8_t to uint64_t
-  std::vector<int64_t> dataLine(lineSize / 4, 0);
-  for (int i = 0; i < lineSize; i += 4)
+  int64_t *dataLine = m_Words.data();
+  for (unsigned i = 0; i < numWords; i++)
   {
-    int64_t data;
-    std::memcpy(&data, &_dataLine[i], 4);
-    dataLine[i/4] = data;
+    int64_t data = 0;
+    std::memcpy(&data, &_dataLine[4 * i], 4);
+    dataLine[i] = data;
   }
-  
+
   // delta
-  std::vector<int64_t> deltas;
-  for (int row = 1; row < dataLine.size(); row++)
-    deltas.push_back(dataLine[row] - dataLine[row - 1]);
+  const int numDeltas = numWords - 1;
+  int64_t *deltas = m_Deltas.data();
+  for (unsigned row = 1; row < numWords; row++)
+    deltas[row - 1] = dataLine[row] - dataLine[row - 1];
 
   int32_t prevDBP;
   int32_t DBP[33];
@@ -56,7 +252,7 @@ unsigned BPC::CompressLine(std::vector<uint8_t> &_dataLine)
   {
     // a buffer of bit-plane
     int32_t buf = 0;
-    for (int row = deltas.size() - 1; row >= 0; row--)
+    for (int row = numDeltas - 1; row >= 0; row--)
     {
       buf <<= 1;
       buf |= ((deltas[row] >> col) & 1);
@@ -78,29 +274,54 @@ unsigned BPC::CompressLine(std::vector<uint8_t> &_dataLine)
   }
 
   // first 32-bit word in original form (dataLine)
-  unsigned compressedSize = encodeFirst(dataLine[0]);
+  unsigned compressedSize = encodeFirst(dataLine[0], writer);
   // the rest of the data
-  compressedSize += encodeDeltas(DBP, DBX);
+  compressedSize += encodeDeltas(DBP, DBX, writer);
 
-  m_Stat->Update(uncompressedSize, compressedSize);
   return compressedSize;
 }
 
-unsigned BPC::encodeFirst(int64_t base)
+// 000      -> zero
+// 001      -> 4-bit
+// 010      -> 8-bit
+// 011      -> 16-bit
+// 1        -> uncompressed
+unsigned BPC::encodeFirst(int64_t base, BitWriter *writer)
 {
-  if (base = 0)
-    return 3;
+  unsigned code, size;
+  if (base == 0)
+  {
+    code = 0b000;
+    size = 0;
+  }
   else if (isSignExtended(base, 4))
-    return 3 + 4;
+  {
+    code = 0b001;
+    size = 4;
+  }
   else if (isSignExtended(base, 8))
-    return 3 + 8;
+  {
+    code = 0b010;
+    size = 8;
+  }
   else if (isSignExtended(base, 16))
-    return 3 + 16;
+  {
+    code = 0b011;
+    size = 16;
+  }
   else
+  {
+    if (writer != nullptr)
+      writer->Write((1ULL << 32) | (base & BYTE4MAX), 1 + 32);
     return 1 + 32;
+  }
+
+  if (writer != nullptr)
+    writer->Write(((uint64_t)code << size) | (base & ((1ULL << size) - 1)), 3 + size);
+  return 3 + size;
 }
 
-unsigned BPC::encodeDeltas(int32_t* DBP, int32_t* DBX)
+unsigned BPC::encodeDeltas(int32_t* DBP, int32_t* DBX, BitWriter *writer)
 {
   BPCResult* m_stat = static_cast<BPCResult*>(m_Stat);
 
@@ -118,10 +339,7 @@ unsigned BPC::encodeDeltas(int32_t* DBP, int32_t* DBX)
     {
       // Z-RLE
       if (runLength > 0) 
-      {
-        length += ZRL_CODE_SIZE[runLength];
-        m_stat->UpdatePattern(runLength, (int)BPCPattern::ZRLE);
-      }
+        length += encodeZRL(runLength, writer);
       runLength = 0;
 
       // zero DBP
@@ -129,12 +347,16 @@ unsigned BPC::encodeDeltas(int32_t* DBP, int32_t* DBX)
       {
         length += zeroDBPSize;
         m_stat->UpdatePattern(1, (int)BPCPattern::Zero);
+        if (writer != nullptr)
+          writer->Write(0b00010, zeroDBPSize);
       }
       // All 1s
       else if (DBX[i] == 0x7fffffff)
       {
         length += allOneSize;
         m_stat->UpdatePattern(1, (int)BPCPattern::AllOnes);
+        if (writer != nullptr)
+          writer->Write(0b00011, allOneSize);
       }
       else
       {
@@ -158,28 +380,31 @@ unsigned BPC::encodeDeltas(int32_t* DBP, int32_t* DBX)
         {
           length += singleOneSize;
           m_stat->UpdatePattern(1, (int)BPCPattern::SingleOne);
+          if (writer != nullptr)
+            writer->Write((0b00000 << 5) | firstPos, singleOneSize);
         }
         // consec double 1s
         else if ((oneCnt == 2) && (twoDistance == 1))
         {
           length += consecutiveDoubleOneSize;
           m_stat->UpdatePattern(1, (int)BPCPattern::ConsecTwoOnes);
+          if (writer != nullptr)
+            writer->Write((0b00001 << 5) | firstPos, consecutiveDoubleOneSize);
         }
         // uncompressible
         else
         {
           length += 32;
           m_stat->UpdatePattern(1, (int)BPCPattern::Uncomp);
+          if (writer != nullptr)
+            writer->Write((1ULL << 31) | (uint32_t)DBX[i], 32);
         }
       }
     }
   }
   // final Z-RLE
   if (runLength > 0)
-  {
-    length += ZRL_CODE_SIZE[runLength];
-    m_stat->UpdatePattern(runLength, (int)BPCPattern::ZRLE);
-  }
+    length += encodeZRL(runLength, writer);
 
   return length;
 }
@@ -5,6 +5,8 @@
 #include "CompResult.h"
 
 #define NUM_BPC_PATTERN 7
+// bits of the length of a zero run, a run of 2~33 DBX symbols
+#define ZRL_BITS 5
 
 namespace comp
 {
@@ -32,52 +34,40 @@ struct BPCResult : public CompResult
     Counts[selected]++;
   }
 
+  virtual CompResult* Clone() { return new BPCResult(*this); }
+
+  virtual void Merge(CompResult *other)
+  {
+    CompResult::Merge(other);
+
+    BPCResult *result = static_cast<BPCResult*>(other);
+    TotalWords += result->TotalWords;
+    for (int i = 0; i < NUM_BPC_PATTERN; i++)
+      Counts[i] += result->Counts[i];
+  }
+
   virtual void Print(std::string workloadName = "", std::string filePath = "")
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")  // stdout
-    {
-      buff = std::cout.rdbuf();
-    }
-    else  // file
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
     {
-      // write column index description
-      if (!isFileExists(filePath))
-      {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << "Workload,Original Size,Compressed Size,Compression Ratio,";
-
-        file << "Total Words,";
-        for (int i = 0; i < NUM_BPC_PATTERN; i++)
-          file << fmt::format("Pattern{},", i);
-        file << std::endl;
-        file.close();
-      }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
+      std::string header = "Workload,Original Size,Compressed Size,Compression Ratio,Total Words,";
+      for (int i = 0; i < NUM_BPC_PATTERN; i++)
+        header += fmt::format("Pattern{},", i);
+      writer.Header(header);
     }
-    std::ostream stream(buff);
 
     // print result
     // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{0},{1},{2},{3},", workloadName, OriginalSize, CompressedSize, CompRatio);
+    writer.Field("workload", workloadName);
+    writer.Field("original_size", OriginalSize);
+    writer.Field("compressed_size", CompressedSize);
+    writer.Field("compression_ratio", CompRatio);
     // word counts
-    stream << fmt::format("{0},", TotalWords);
+    writer.Field("total_words", TotalWords);
     // selection counts
-    for (int i = 0; i < NUM_BPC_PATTERN; i++)
-      stream << fmt::format("{},", Counts[i]);
-    stream << std::endl;
-
-    if (file.is_open())
-      file.close();
+    writer.Array("pattern", Counts.data(), NUM_BPC_PATTERN);
+    writer.EndRow();
   }
 
   /*** member variables ***/
@@ -89,19 +79,48 @@ class BPC : public Compressor
 {
 public:
   /*** constructor ***/
-  BPC(unsigned lineSize)
+  // the config may set the bits of a zero run, e.g. { "zrl_bits": 3 }
+  BPC(unsigned lineSize, const Json::Value &config = Json::Value())
+    : m_ZRLBits(ZRL_BITS), m_MaxZRL((1 << ZRL_BITS) + 1)
   {
     m_Stat = new BPCResult(lineSize);
     m_Stat->CompressorName = "Bit-Plane Compression";
+
+    if (!config.isNull())
+      parseConfig(config);
   }
 
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine);
+  virtual void CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+      int *selected = nullptr);
+
+  virtual unsigned EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer);
+  virtual bool DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine);
+  // a bit-plane of deltas has to fit in 31 bits
+  virtual bool IsDecodable()
+  {
+    return (m_Stat->LineSize % 4 == 0) && (m_Stat->LineSize >= 8) && (m_Stat->LineSize <= 128);
+  }
+
+  virtual bool IsMemoizable() { return true; }
+  virtual void RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record);
+  virtual void ReplayLine(unsigned lineSize, const LineRecord &record);
 
 private:
-  unsigned encodeFirst(int64_t base);
-  unsigned encodeDeltas(int32_t* DBP, int32_t* DBX);
+  void parseConfig(const Json::Value &root);
+  unsigned compressLine(const uint8_t *dataLine, const unsigned lineSize, BitWriter *writer = nullptr);
+  unsigned encodeZRL(unsigned runLength, BitWriter *writer);
+  unsigned encodeFirst(int64_t base, BitWriter *writer);
+  unsigned encodeDeltas(int32_t* DBP, int32_t* DBX, BitWriter *writer);
   bool isSignExtended(uint64_t value, uint8_t bitSize);
   bool isZeroExtended(uint64_t value, uint8_t bitSize);
+
+private:
+  unsigned m_ZRLBits;
+  unsigned m_MaxZRL;
+  // words of the line and their deltas, grown to the widest line
+  std::vector<int64_t> m_Words;
+  std::vector<int64_t> m_Deltas;
 };
 
 }
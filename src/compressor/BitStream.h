@@ -0,0 +1,163 @@
+#ifndef __BITSTREAM_H__
+#define __BITSTREAM_H__
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+namespace comp
+{
+
+// MSB-first bit writer.
+// Complete bytes can be flushed to a file while the trailing partial byte is kept.
+class BitWriter
+{
+public:
+  /*** constructors ***/
+  BitWriter()
+    : m_NumBits(0), m_NumFlushedBits(0) {}
+
+  /*** getters ***/
+  // number of bits written since the construction, including flushed ones
+  uint64_t GetNumBits() { return m_NumFlushedBits + m_NumBits; }
+  const std::vector<uint8_t> &GetBuffer() { return m_Buffer; }
+
+  /*** methods ***/
+  // write numBits (<= 64) LSBs of value
+  void Write(uint64_t value, unsigned numBits)
+  {
+    while (numBits > 0)
+    {
+      unsigned bitPos = m_NumBits % 8;
+      if (bitPos == 0)
+        m_Buffer.push_back(0);
+      unsigned space = 8 - bitPos;
+      unsigned n = (numBits < space) ? numBits : space;
+      uint8_t bits = (value >> (numBits - n)) & ((1u << n) - 1);
+      m_Buffer.back() |= bits << (space - n);
+      numBits -= n;
+      m_NumBits += n;
+    }
+  }
+
+  void WriteBytes(const uint8_t *bytes, unsigned numBytes)
+  {
+    if (m_NumBits % 8 == 0)
+    {
+      m_Buffer.insert(m_Buffer.end(), bytes, bytes + numBytes);
+      m_NumBits += numBytes * 8;
+      return;
+    }
+    for (unsigned i = 0; i < numBytes; i++)
+      Write(bytes[i], 8);
+  }
+
+  // write complete bytes into file, and the partial byte too if isFinal
+  void Flush(std::ofstream &file, bool isFinal = false)
+  {
+    uint64_t numBytes = isFinal ? m_Buffer.size() : m_NumBits / 8;
+    file.write(reinterpret_cast<const char*>(m_Buffer.data()), numBytes);
+    m_Buffer.erase(m_Buffer.begin(), m_Buffer.begin() + numBytes);
+    m_NumFlushedBits += isFinal ? m_NumBits : numBytes * 8;
+    m_NumBits = isFinal ? 0 : m_NumBits % 8;
+  }
+
+  void Clear()
+  {
+    m_Buffer.clear();
+    m_NumBits = 0;
+    m_NumFlushedBits = 0;
+  }
+
+private:
+  std::vector<uint8_t> m_Buffer;
+  uint64_t m_NumBits;         // bits in m_Buffer
+  uint64_t m_NumFlushedBits;
+};
+
+// MSB-first bit reader over a memory buffer or a file.
+// Reading past the end returns zeros and sets the overrun flag.
+class BitReader
+{
+public:
+  /*** constructors ***/
+  BitReader(const uint8_t *data, uint64_t numBits)
+    : mp_File(nullptr), m_NumBits(numBits), m_Pos(0), m_BufferBase(0), mb_Overrun(false)
+  {
+    m_Buffer.assign(data, data + (numBits + 7) / 8);
+  }
+  BitReader(std::ifstream *file, uint64_t numBits)
+    : mp_File(file), m_NumBits(numBits), m_Pos(0), m_BufferBase(0), mb_Overrun(false) {}
+
+  /*** getters ***/
+  uint64_t GetPosition() { return m_Pos; }
+  bool IsEnd()     { return m_Pos >= m_NumBits; }
+  bool IsOverrun() { return mb_Overrun; }
+
+  /*** methods ***/
+  // read numBits (<= 64) bits
+  uint64_t Read(unsigned numBits)
+  {
+    uint64_t value = 0;
+    if (m_Pos + numBits > m_NumBits)
+    {
+      mb_Overrun = true;
+      m_Pos += numBits;
+      return 0;
+    }
+    while (numBits > 0)
+    {
+      uint64_t byteIdx = m_Pos / 8 - m_BufferBase;
+      if (byteIdx >= m_Buffer.size())
+      {
+        refill();
+        byteIdx = m_Pos / 8 - m_BufferBase;
+        // truncated file
+        if (byteIdx >= m_Buffer.size())
+        {
+          mb_Overrun = true;
+          m_Pos += numBits;
+          return 0;
+        }
+      }
+      unsigned bitPos = m_Pos % 8;
+      unsigned avail = 8 - bitPos;
+      unsigned n = (numBits < avail) ? numBits : avail;
+      uint8_t bits = (m_Buffer[byteIdx] >> (avail - n)) & ((1u << n) - 1);
+      value = (value << n) | bits;
+      numBits -= n;
+      m_Pos += n;
+    }
+    return value;
+  }
+
+  void ReadBytes(uint8_t *bytes, unsigned numBytes)
+  {
+    for (unsigned i = 0; i < numBytes; i++)
+      bytes[i] = Read(8);
+  }
+
+private:
+  void refill()
+  {
+    // a memory buffer is never refilled, the overrun check above guards it
+    const uint64_t chunkSize = 1 << 16;
+    m_BufferBase = m_Pos / 8;
+    m_Buffer.resize(chunkSize);
+    mp_File->read(reinterpret_cast<char*>(m_Buffer.data()), chunkSize);
+    m_Buffer.resize(mp_File->gcount());
+  }
+
+private:
+  std::ifstream *mp_File;
+  std::vector<uint8_t> m_Buffer;
+  uint64_t m_NumBits;
+  uint64_t m_Pos;
+  uint64_t m_BufferBase;    // byte offset of m_Buffer in the stream
+  bool mb_Overrun;
+};
+
+}
+
+#endif  // __BITSTREAM_H__
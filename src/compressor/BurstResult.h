@@ -0,0 +1,109 @@
+#ifndef __BURSTRESULT_H__
+#define __BURSTRESULT_H__
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#include <fmt/core.h>
+#include "../utils.h"
+#include "RecordWriter.h"
+
+// bins of the bursts per line, the last one includes longer lines
+#define NUM_BURST_BINS 9
+
+namespace comp
+{
+
+// Fetch-granularity model of the compressed lines.
+// Memory moves whole bursts (or sectors), so a line costs the bursts its compressed size
+// and its metadata round up to, and never more than the bursts of the uncompressed line,
+// which is stored as is when compressing does not save a burst.
+// Every burst size is modeled over the same compressed sizes, in the pass of the compression.
+struct BurstResult
+{
+  struct Model
+  {
+    unsigned BurstSize;             // bytes
+    uint64_t OriginalBursts;
+    uint64_t CompressedBursts;
+    uint64_t Bins[NUM_BURST_BINS];  // lines by compressed bursts
+  };
+
+  /*** constructors ***/
+  BurstResult(std::vector<unsigned> burstSizes, unsigned metadataBits)
+    : MetadataBits(metadataBits), NumLines(0)
+  {
+    for (unsigned burstSize : burstSizes)
+    {
+      if (burstSize == 0)
+      {
+        printf("Invalid burst size! A burst has at least a byte.\n");
+        exit(1);
+      }
+      Models.push_back({ burstSize, 0, 0, { 0 } });
+    }
+  }
+
+  /*** methods ***/
+  // sizes in bits
+  void Update(unsigned uncompSize, unsigned compSize)
+  {
+    NumLines++;
+    for (Model &model : Models)
+    {
+      const uint64_t burstBits = (uint64_t)model.BurstSize * 8;
+      const uint64_t originalBursts = (uncompSize + burstBits - 1) / burstBits;
+      const uint64_t compressedBursts = std::min(originalBursts,
+          ((uint64_t)compSize + MetadataBits + burstBits - 1) / burstBits);
+      model.OriginalBursts += originalBursts;
+      model.CompressedBursts += compressedBursts;
+      model.Bins[std::min<uint64_t>(compressedBursts, NUM_BURST_BINS - 1)]++;
+    }
+  }
+
+  void UpdateBatch(unsigned uncompSize, const unsigned *compSizes, unsigned numLines)
+  {
+    for (unsigned i = 0; i < numLines; i++)
+      Update(uncompSize, compSizes[i]);
+  }
+
+  // a row per burst size
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
+    {
+      std::string header = "workload,burst_size,metadata_bits,lines,original_bursts,compressed_bursts,"
+          "effective_ratio,bandwidth_savings,";
+      for (int i = 0; i < NUM_BURST_BINS; i++)
+        header += fmt::format("bursts{},", i);
+      writer.Header(header);
+    }
+
+    for (Model &model : Models)
+    {
+      writer.Field("workload", workloadName);
+      writer.Field("burst_size", model.BurstSize);
+      writer.Field("metadata_bits", MetadataBits);
+      writer.Field("lines", NumLines);
+      writer.Field("original_bursts", model.OriginalBursts);
+      writer.Field("compressed_bursts", model.CompressedBursts);
+      writer.Field("effective_ratio", (double)model.OriginalBursts / (double)model.CompressedBursts);
+      writer.Field("bandwidth_savings", 1 - (double)model.CompressedBursts / (double)model.OriginalBursts);
+      writer.Array("bursts", model.Bins, NUM_BURST_BINS);
+      writer.EndRow();
+    }
+  }
+
+  /*** member variables ***/
+  const unsigned MetadataBits;      // per line
+  uint64_t NumLines;
+  std::vector<Model> Models;
+};
+
+}
+
+#endif  // __BURSTRESULT_H__
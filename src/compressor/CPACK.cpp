@@ -1,10 +1,89 @@
 #include "CPACK.h"
 #include <endian.h>
+#include <cstring>
 
 namespace comp
 {
 
 unsigned CPACK::CompressLine(std::vector<uint8_t> &dataLine)
+{
+  return compressLine(dataLine, nullptr);
+}
+
+unsigned CPACK::EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer)
+{
+  return compressLine(dataLine, &writer);
+}
+
+bool CPACK::DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine)
+{
+  const unsigned lineSize = m_Stat->LineSize;
+  dataLine.resize(lineSize);
+
+  for (unsigned i = 0; i < lineSize / WORDSIZE; i++)
+  {
+    uint8_t *word = &dataLine[WORDSIZE * i];
+
+    if (reader.Read(1) == 0)
+    {
+      // pattern zzzz (00)
+      if (reader.Read(1) == 0)
+      {
+        word[0] = word[1] = word[2] = word[3] = 0;
+      }
+      // pattern xxxx (01)BBBB
+      else
+      {
+        reader.ReadBytes(word, WORDSIZE);
+
+        uint32_t newEntry;
+        memcpy(&newEntry, word, WORDSIZE);
+        m_DecodeDictionary[m_DecodeHead] = newEntry;
+        m_DecodeHead = (m_DecodeHead + 1) & (m_NumEntries - 1);
+      }
+      continue;
+    }
+
+    // pattern mmmm (10)bbbb
+    if (reader.Read(1) == 0)
+    {
+      const uint32_t entry = getDecodeEntry(reader.Read(m_IndexBits));
+      memcpy(word, &entry, WORDSIZE);
+      continue;
+    }
+
+    switch (reader.Read(2))
+    {
+      // pattern mmxx (1100)bbbbBB
+      case 0b00:
+      {
+        const uint32_t entry = getDecodeEntry(reader.Read(m_IndexBits));
+        memcpy(word, &entry, 2);
+        reader.ReadBytes(word + 2, 2);
+        break;
+      }
+      // pattern zzzx (1101)B
+      case 0b01:
+        word[0] = word[1] = word[2] = 0;
+        word[3] = reader.Read(8);
+        break;
+      // pattern mmmx (1110)bbbbB
+      case 0b10:
+      {
+        const uint32_t entry = getDecodeEntry(reader.Read(m_IndexBits));
+        memcpy(word, &entry, 3);
+        word[3] = reader.Read(8);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+
+  return !reader.IsOverrun();
+}
+
+unsigned CPACK::compressLine(std::vector<uint8_t> &dataLine, BitWriter *writer)
 {
   unsigned uncompSize = dataLine.size() * BYTE;
   unsigned currCSize = 0;
@@ -13,52 +92,58 @@ unsigned CPACK::CompressLine(std::vector<uint8_t> &dataLine)
 
   for (int i = 0; i < dataLine.size() / WORDSIZE; i++)
   {
-    uint8_t word[WORDSIZE] = {
-      dataLine[WORDSIZE * i], dataLine[WORDSIZE * i + 1], dataLine[WORDSIZE * i + 2], dataLine[WORDSIZE * i + 3]
-    };
+    // bytes of the word in memory order, word[0] is the LSB of value
+    const uint8_t *word = &dataLine[WORDSIZE * i];
+    uint32_t value;
+    memcpy(&value, word, WORDSIZE);
 
     // check zero patterns
-    if (word[0] == 0 && word[1] == 0 && word[2] == 0)
+    if ((value & 0x00FFFFFF) == 0)
     {
       // pattern zzzz (00)
       if (word[3] == 0)
       {
         currCSize += m_PatternLength[0];
         m_stat->UpdatePattern((int)CPACKPattern::ZZZZ);
+        if (writer != nullptr)
+          writer->Write(0b00, 2);
       }
-      // pattern zzzx (1100)B
+      // pattern zzzx (1101)B
       else
       {
         currCSize += m_PatternLength[4];
         m_stat->UpdatePattern((int)CPACKPattern::ZZZX);
+        if (writer != nullptr)
+          writer->Write((0b1101 << 8) | word[3], 4 + 8);
       }
       continue;
     }
 
-    // check dictionary patterns
+    // check dictionary patterns, from the oldest entry
     bool found = false;
-    for (int j = 0; j < NUM_ENTRY; j++)
+    for (unsigned j = 0; j < m_NumEntries; j++)
     {
-      uint8_t *currEntry = m_Dictionary[j];
-      uint8_t dictWord[WORDSIZE] = {
-        currEntry[0], currEntry[1], currEntry[2], currEntry[3]
-      };
+      const uint32_t diff = value ^ getEntry(j);
 
-      if (word[0] == dictWord[0] && word[1] == dictWord[1])
+      if ((diff & 0x0000FFFF) == 0)
       {
-        if (word[2] == dictWord[2])
+        if ((diff & 0x00FFFFFF) == 0)
         {
           // pattern mmmm (10)bbbb
-          if (word[3] == dictWord[3])
+          if (diff == 0)
           {
             currCSize += m_PatternLength[2];
             m_stat->UpdatePattern((int)CPACKPattern::MMMM);
+            if (writer != nullptr)
+              writer->Write((0b10 << m_IndexBits) | j, 2 + m_IndexBits);
           }
           // pattern mmmx (1110)bbbbB
           else
           {
             currCSize += m_PatternLength[5];
             m_stat->UpdatePattern((int)CPACKPattern::MMMX);
+            if (writer != nullptr)
+              writer->Write((0b1110 << (m_IndexBits + 8)) | (j << 8) | word[3], 4 + m_IndexBits + 8);
           }
         }
         // pattern mmxx (1100)bbbbBB
@@ -66,6 +151,8 @@ unsigned CPACK::CompressLine(std::vector<uint8_t> &dataLine)
         {
           currCSize += m_PatternLength[3];
           m_stat->UpdatePattern((int)CPACKPattern::MMXX);
+          if (writer != nullptr)
+            writer->Write((0b1100 << (m_IndexBits + 16)) | (j << 16) | (word[2] << 8) | word[3], 4 + m_IndexBits + 16);
         }
         found = true;
         break;
@@ -81,16 +168,15 @@ unsigned CPACK::CompressLine(std::vector<uint8_t> &dataLine)
     else
     {
       currCSize += m_PatternLength[1];
+      if (writer != nullptr)
+      {
+        writer->Write(0b01, 2);
+        writer->WriteBytes(word, WORDSIZE);
+      }
       
-      // add new pattern to dictionary
-      uint8_t *newEntry = new uint8_t[WORDSIZE];
-      for (int k = 0; k < WORDSIZE; k++)
-        newEntry[k] = word[k];
-      m_Dictionary.push_back(newEntry);
-      
-      uint8_t *popEntry = m_Dictionary.front();
-      m_Dictionary.pop_front();
-      delete[] popEntry;
+      // add new pattern to dictionary, in place of the oldest one
+      m_Dictionary[m_Head] = value;
+      m_Head = (m_Head + 1) & (m_NumEntries - 1);
 
       m_stat->UpdatePattern((int)CPACKPattern::XXXX);
     }
@@ -100,4 +186,15 @@ unsigned CPACK::CompressLine(std::vector<uint8_t> &dataLine)
   return currCSize;
 }
 
+void CPACK::parseConfig(const Json::Value &root)
+{
+  // entries of the dictionary
+  m_NumEntries = root.get("dict_entries", m_NumEntries).asUInt();
+  if (m_NumEntries < 2 || m_NumEntries > 256 || (m_NumEntries & (m_NumEntries - 1)) != 0)
+  {
+    printf("Invalid config! dict_entries %u is not a power of 2 in 2..256.\n", m_NumEntries);
+    exit(1);
+  }
+}
+
 }
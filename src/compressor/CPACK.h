@@ -1,14 +1,14 @@
 #ifndef __CPACK_H__
 #define __CPACK_H__
 
-#include <deque>
+#include <vector>
 
 #include "Compressor.h"
 #include "CompResult.h"
 
 #define WORDSIZE 4
 #define DICTSIZE 64
-#define NUM_ENTRY DICTSIZE/WORDSIZE
+#define NUM_ENTRY (DICTSIZE/WORDSIZE)
 
 #define NUM_CPACK_PATTERN 6
 
@@ -42,52 +42,40 @@ struct CPACKResult : public CompResult
     Counts[selected]++;
   }
 
+  virtual CompResult* Clone() { return new CPACKResult(*this); }
+
+  virtual void Merge(CompResult *other)
+  {
+    CompResult::Merge(other);
+
+    CPACKResult *result = static_cast<CPACKResult*>(other);
+    TotalWords += result->TotalWords;
+    for (int i = 0; i < NUM_CPACK_PATTERN; i++)
+      Counts[i] += result->Counts[i];
+  }
+
   virtual void Print(std::string workloadName = "", std::string filePath = "")
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")  // stdout
-    {
-      buff = std::cout.rdbuf();
-    }
-    else  // file
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
     {
-      // write column index description
-      if (!isFileExists(filePath))
-      {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << "Workload,Original Size,Compressed Size,Compression Ratio,";
-
-        file << "Total Words,";
-        for (int i = 0; i < NUM_CPACK_PATTERN; i++)
-          file << fmt::format("Pattern{},", i);
-        file << std::endl;
-        file.close();
-      }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
+      std::string header = "Workload,Original Size,Compressed Size,Compression Ratio,Total Words,";
+      for (int i = 0; i < NUM_CPACK_PATTERN; i++)
+        header += fmt::format("Pattern{},", i);
+      writer.Header(header);
     }
-    std::ostream stream(buff);
 
     // print result
     // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{0},{1},{2},{3},", workloadName, OriginalSize, CompressedSize, CompRatio);
+    writer.Field("workload", workloadName);
+    writer.Field("original_size", OriginalSize);
+    writer.Field("compressed_size", CompressedSize);
+    writer.Field("compression_ratio", CompRatio);
     // word counts
-    stream << fmt::format("{0},", TotalWords);
+    writer.Field("total_words", TotalWords);
     // selection counts
-    for (int i = 0; i < NUM_CPACK_PATTERN; i++)
-      stream << fmt::format("{},", Counts[i]);
-    stream << std::endl;
-
-    if (file.is_open())
-      file.close();
+    writer.Array("pattern", Counts.data(), NUM_CPACK_PATTERN);
+    writer.EndRow();
   }
 
   /*** member variables ***/
@@ -98,33 +86,60 @@ struct CPACKResult : public CompResult
 class CPACK : public Compressor
 {
 public:
-  CPACK(unsigned lineSize)
+  // the config may set the entries of the dictionary, e.g. { "dict_entries": 32 }
+  CPACK(unsigned lineSize, const Json::Value &config = Json::Value())
+    : m_NumEntries(NUM_ENTRY), m_Head(0), m_DecodeHead(0)
   {
     m_Stat = new CPACKResult(lineSize);
     m_Stat->CompressorName = "C-Pack";
 
-    // init dictionary
-    for (int i = 0; i < NUM_ENTRY; i++)
-    {
-      uint8_t *init = new uint8_t[WORDSIZE];
-      for (int j = 0; j < WORDSIZE; j++)
-        init[j] = 0;
-      m_Dictionary.push_back(init);
-    }
+    if (!config.isNull())
+      parseConfig(config);
+
+    // init dictionary, the decoder keeps its own copy, which follows the encoder line by line
+    m_IndexBits = __builtin_ctz(m_NumEntries);
+    m_Dictionary.assign(m_NumEntries, 0);
+    m_DecodeDictionary.assign(m_NumEntries, 0);
+
+    // the patterns with an index take m_IndexBits (4) for it
+    m_PatternLength[0] = 2;
+    m_PatternLength[1] = 2 + 4*BYTE;
+    m_PatternLength[2] = 2 + m_IndexBits;
+    m_PatternLength[3] = 4 + m_IndexBits + 2*BYTE;
+    m_PatternLength[4] = 4 + BYTE;
+    m_PatternLength[5] = 4 + m_IndexBits + BYTE;
   }
 
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine); 
 
+  virtual unsigned EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer);
+  virtual bool DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine);
+  virtual bool IsDecodable() { return m_Stat->LineSize % WORDSIZE == 0; }
+
+private:
+  void parseConfig(const Json::Value &root);
+  unsigned compressLine(std::vector<uint8_t> &dataLine, BitWriter *writer);
+
+  // j-th entry from the oldest one
+  uint32_t getEntry(unsigned j)       { return m_Dictionary[(m_Head + j) & (m_NumEntries - 1)]; }
+  uint32_t getDecodeEntry(unsigned j) { return m_DecodeDictionary[(m_DecodeHead + j) & (m_NumEntries - 1)]; }
+
 private:
-  std::deque<uint8_t*> m_Dictionary;
+  // FIFO dictionaries of words, as rings over the oldest entry at the head
+  unsigned m_NumEntries;
+  unsigned m_IndexBits;
+  std::vector<uint32_t> m_Dictionary;
+  std::vector<uint32_t> m_DecodeDictionary;
+  unsigned m_Head;
+  unsigned m_DecodeHead;
 
   // 0. zzzz (00)         : 2
   // 1. xxxx (01)BBBB     : 34
   // 2. mmmm (10)bbbb     : 6
   // 3. mmxx (1100)bbbbBB : 24
-  // 4. zzzx (1100)B      : 12
+  // 4. zzzx (1101)B      : 12
   // 5. mmmx (1110)bbbbB  : 16
-  const unsigned m_PatternLength[NUM_CPACK_PATTERN] = { 2, 34, 6, 24, 12, 16 };
+  unsigned m_PatternLength[NUM_CPACK_PATTERN];
 };
 
 }
@@ -0,0 +1,490 @@
+#ifndef __CACHERESULT_H__
+#define __CACHERESULT_H__
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include <fmt/core.h>
+#include <strutil.h>
+#include "../utils.h"
+#include "../loader/Loader.h"
+#include "RecordWriter.h"
+
+// unit of allocation of the data array, in bytes
+#define CACHE_SEGMENT_SIZE 8
+// tags per way of a segmented cache, the lines it can hold beyond its uncompressed capacity
+#define CACHE_TAG_FACTOR 2
+// lines of a superblock, sharing a tag
+#define CACHE_SUPERBLOCK_LINES 4
+
+namespace comp
+{
+
+enum CacheType
+{
+  CACHE_UNCOMPRESSED = 0,
+  CACHE_SEGMENTED,
+  CACHE_SUPERBLOCK,
+};
+static const char *CACHE_TYPE_NAMES[] = { "uncompressed", "segmented", "superblock" };
+
+// Set-associative cache of compressed lines, with LRU replacement.
+// Every line of the trace accesses the cache with its address and its compressed size,
+// a hit with another size is the line rewritten with new data.
+// The geometry (sets of ways of blocks) is fixed by the size of the first line.
+class CacheModel
+{
+public:
+  /*** constructors ***/
+  CacheModel(CacheType type, uint64_t capacity, unsigned numWays)
+    : Type(type), Capacity(capacity), NumWays(numWays), BlockSize(0), NumSets(0),
+      NumAccesses(0), NumHits(0), NumEvictions(0), NumCompactions(0), NumMovedSegments(0),
+      SumValidLines(0), m_NumValidLines(0), m_Clock(0) {}
+  virtual ~CacheModel() {}
+
+  /*** methods ***/
+  // sizes in bits
+  void Access(addr_t addr, unsigned uncompSize, unsigned compSize)
+  {
+    if (NumSets == 0)
+      setGeometry(uncompSize / BYTE_BITS);
+
+    const unsigned rawSegments = toSegments(uncompSize);
+    const unsigned segments = (Type == CACHE_UNCOMPRESSED) ? rawSegments : std::min(toSegments(compSize), rawSegments);
+    const uint64_t lineAddr = addr / BlockSize;
+    m_Clock++;
+    NumAccesses++;
+    NumHits += access(lineAddr, segments);
+    SumValidLines += m_NumValidLines;
+  }
+
+  // valid lines on average over the accesses, relative to the lines of an uncompressed cache
+  double GetEffectiveCapacity()
+  {
+    if (NumAccesses == 0)
+      return 0;
+    return (double)SumValidLines / (double)NumAccesses / (double)(NumSets * NumWays);
+  }
+
+protected:
+  // returns whether the line hits
+  virtual bool access(uint64_t lineAddr, unsigned segments) = 0;
+  virtual void allocate() = 0;
+
+  unsigned toSegments(unsigned size) { return (size + CACHE_SEGMENT_SIZE * BYTE_BITS - 1) / (CACHE_SEGMENT_SIZE * BYTE_BITS); }
+
+private:
+  void setGeometry(unsigned blockSize)
+  {
+    BlockSize = std::max(blockSize, 1u);
+    NumSets = Capacity / ((uint64_t)NumWays * BlockSize);
+    if (NumSets == 0 || (NumSets & (NumSets - 1)) != 0)
+    {
+      printf("Invalid cache! %lu bytes of %u ways of %u-byte lines are not a power-of-2 number of sets.\n",
+          Capacity, NumWays, BlockSize);
+      exit(1);
+    }
+    m_SegmentsPerBlock = BlockSize / CACHE_SEGMENT_SIZE;
+    if (m_SegmentsPerBlock == 0)
+    {
+      printf("Invalid cache! A %u-byte line is smaller than a segment.\n", BlockSize);
+      exit(1);
+    }
+    allocate();
+  }
+
+public:
+  static constexpr unsigned BYTE_BITS = 8;
+
+  const CacheType Type;
+  const uint64_t Capacity;      // bytes of the data array
+  const unsigned NumWays;       // blocks of the data array per set
+  unsigned BlockSize;           // bytes
+  uint64_t NumSets;
+
+  uint64_t NumAccesses;
+  uint64_t NumHits;
+  uint64_t NumEvictions;
+  uint64_t NumCompactions;      // allocations stalled to move lines into a contiguous space
+  uint64_t NumMovedSegments;
+  uint64_t SumValidLines;
+
+protected:
+  uint64_t m_NumValidLines;
+  uint64_t m_Clock;
+  unsigned m_SegmentsPerBlock;
+};
+
+// Lines of a set take variable numbers of contiguous segments of the data array of the set,
+// with more tags than ways (a variable-size cache).
+// An uncompressed cache is the same with a tag per way and every line taking a whole block.
+// A line finding enough free segments in the set but no contiguous run of them
+// stalls for the compaction of the set.
+class SegmentedCache : public CacheModel
+{
+  struct Entry
+  {
+    uint64_t LineAddr;
+    uint64_t LastAccess;    // 0 if invalid
+    uint16_t Offset;        // segments
+    uint16_t Segments;
+  };
+
+public:
+  /*** constructors ***/
+  SegmentedCache(CacheType type, uint64_t capacity, unsigned numWays)
+    : CacheModel(type, capacity, numWays),
+      m_NumTags(numWays * ((type == CACHE_UNCOMPRESSED) ? 1 : CACHE_TAG_FACTOR)) {}
+
+protected:
+  virtual void allocate()
+  {
+    m_NumSegments = NumWays * m_SegmentsPerBlock;
+    m_WordsPerSet = (m_NumSegments + 63) / 64;
+    m_Entries.assign(NumSets * m_NumTags, { 0, 0, 0, 0 });
+    m_FreeSegments.assign(NumSets, m_NumSegments);
+    m_Used.assign(NumSets * m_WordsPerSet, 0);
+  }
+
+  virtual bool access(uint64_t lineAddr, unsigned segments)
+  {
+    const uint64_t setIndex = lineAddr & (NumSets - 1);
+    Entry *set = &m_Entries[setIndex * m_NumTags];
+    uint64_t *used = &m_Used[setIndex * m_WordsPerSet];
+    unsigned &freeSegments = m_FreeSegments[setIndex];
+
+    Entry *entry = nullptr;
+    Entry *tag = nullptr;
+    for (unsigned t = 0; t < m_NumTags; t++)
+    {
+      if (set[t].LastAccess != 0 && set[t].LineAddr == lineAddr)
+        entry = &set[t];
+      else if (set[t].LastAccess == 0 && tag == nullptr)
+        tag = &set[t];
+    }
+
+    const bool isHit = (entry != nullptr);
+    if (isHit)
+    {
+      entry->LastAccess = m_Clock;
+      if (segments <= entry->Segments || getRun(used, entry->Offset + entry->Segments) >= segments - entry->Segments)
+      {
+        // shrinks, or grows into the free segments that follow it
+        release(used, freeSegments, *entry);
+        entry->Segments = segments;
+        take(used, freeSegments, *entry);
+        return true;
+      }
+      // grows out of its place, reallocated
+      release(used, freeSegments, *entry);
+      entry->LastAccess = 0;
+      m_NumValidLines--;
+      tag = entry;
+    }
+
+    // a tag, and enough segments
+    while (tag == nullptr || freeSegments < segments)
+    {
+      Entry *victim = evict(set, used, freeSegments);
+      if (tag == nullptr)
+        tag = victim;
+    }
+
+    tag->LineAddr = lineAddr;
+    tag->LastAccess = m_Clock;
+    tag->Segments = segments;
+    if (!findSpace(used, segments, tag->Offset))
+    {
+      compact(set, used, tag);
+      NumCompactions++;
+      findSpace(used, segments, tag->Offset);
+    }
+    take(used, freeSegments, *tag);
+    m_NumValidLines++;
+    return isHit;
+  }
+
+private:
+  Entry *evict(Entry *set, uint64_t *used, unsigned &freeSegments)
+  {
+    Entry *victim = nullptr;
+    for (unsigned t = 0; t < m_NumTags; t++)
+      if (set[t].LastAccess != 0 && (victim == nullptr || set[t].LastAccess < victim->LastAccess))
+        victim = &set[t];
+    release(used, freeSegments, *victim);
+    victim->LastAccess = 0;
+    m_NumValidLines--;
+    NumEvictions++;
+    return victim;
+  }
+
+  // segments of the data array of a set are marked in a bitmap
+  void take(uint64_t *used, unsigned &freeSegments, const Entry &entry)
+  {
+    for (unsigned s = entry.Offset; s < entry.Offset + entry.Segments; s++)
+      used[s / 64] |= (1ULL << (s % 64));
+    freeSegments -= entry.Segments;
+  }
+  void release(uint64_t *used, unsigned &freeSegments, const Entry &entry)
+  {
+    for (unsigned s = entry.Offset; s < entry.Offset + entry.Segments; s++)
+      used[s / 64] &= ~(1ULL << (s % 64));
+    freeSegments += entry.Segments;
+  }
+
+  // free segments from begin to the next used one, or to the end of the set
+  unsigned getRun(const uint64_t *used, unsigned begin)
+  {
+    unsigned s = begin;
+    while (s < m_NumSegments && !((used[s / 64] >> (s % 64)) & 1))
+      s++;
+    return s - begin;
+  }
+
+  // first fit of a run of free segments
+  bool findSpace(const uint64_t *used, unsigned segments, uint16_t &offset)
+  {
+    offset = 0;
+    if (segments == 0)
+      return true;
+    for (unsigned s = 0, run = 0; s < m_NumSegments; s++)
+    {
+      run = ((used[s / 64] >> (s % 64)) & 1) ? 0 : run + 1;
+      if (run == segments)
+      {
+        offset = s + 1 - segments;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // move the lines of the set to its beginning, in their order, but the one being allocated
+  void compact(Entry *set, uint64_t *used, Entry *allocated)
+  {
+    m_Lines.clear();
+    for (unsigned t = 0; t < m_NumTags; t++)
+      if (set[t].LastAccess != 0 && &set[t] != allocated)
+        m_Lines.push_back(&set[t]);
+    std::sort(m_Lines.begin(), m_Lines.end(), [](const Entry *lhs, const Entry *rhs) { return lhs->Offset < rhs->Offset; });
+
+    std::fill(used, used + m_WordsPerSet, 0);
+    unsigned begin = 0, freeSegments = m_NumSegments;
+    for (Entry *line : m_Lines)
+    {
+      if (line->Offset != begin)
+        NumMovedSegments += line->Segments;
+      line->Offset = begin;
+      begin += line->Segments;
+      take(used, freeSegments, *line);
+    }
+  }
+
+private:
+  const unsigned m_NumTags;
+  unsigned m_NumSegments;     // per set
+  unsigned m_WordsPerSet;
+  std::vector<Entry> m_Entries;
+  std::vector<unsigned> m_FreeSegments;
+  std::vector<uint64_t> m_Used;
+  std::vector<Entry*> m_Lines;
+};
+
+// A tag per way, each for a superblock of CACHE_SUPERBLOCK_LINES neighboring lines.
+// The compressed lines of a superblock are packed together into as few blocks of the set as they fit in,
+// so that a set holds up to CACHE_SUPERBLOCK_LINES times its ways when the neighbors compress well.
+// Superblocks are replaced as a whole. A line growing out of the blocks of its superblock
+// stalls for the repacking of the superblock.
+class SuperblockCache : public CacheModel
+{
+  struct Entry
+  {
+    uint64_t SuperblockAddr;
+    uint64_t LastAccess;    // 0 if invalid
+    uint16_t Segments[CACHE_SUPERBLOCK_LINES];
+    uint8_t Valid;          // bit mask of the lines
+    uint8_t Blocks;
+  };
+
+public:
+  /*** constructors ***/
+  SuperblockCache(uint64_t capacity, unsigned numWays)
+    : CacheModel(CACHE_SUPERBLOCK, capacity, numWays) {}
+
+protected:
+  virtual void allocate()
+  {
+    m_Entries.assign(NumSets * NumWays, Entry{ 0, 0, { 0 }, 0, 0 });
+    m_FreeBlocks.assign(NumSets, NumWays);
+  }
+
+  virtual bool access(uint64_t lineAddr, unsigned segments)
+  {
+    // neighboring superblocks map to neighboring sets
+    const uint64_t superblockAddr = lineAddr / CACHE_SUPERBLOCK_LINES;
+    const unsigned index = lineAddr % CACHE_SUPERBLOCK_LINES;
+    Entry *set = &m_Entries[(superblockAddr & (NumSets - 1)) * NumWays];
+    unsigned &freeBlocks = m_FreeBlocks[superblockAddr & (NumSets - 1)];
+
+    Entry *entry = nullptr;
+    for (unsigned w = 0; w < NumWays; w++)
+      if (set[w].LastAccess != 0 && set[w].SuperblockAddr == superblockAddr)
+        entry = &set[w];
+
+    if (entry == nullptr)
+    {
+      // a tag of the set
+      for (unsigned w = 0; w < NumWays && entry == nullptr; w++)
+        if (set[w].LastAccess == 0)
+          entry = &set[w];
+      if (entry == nullptr)
+        entry = evict(set, freeBlocks, nullptr);
+      *entry = { superblockAddr, m_Clock, { 0 }, 0, 0 };
+    }
+    entry->LastAccess = m_Clock;
+
+    const bool isHit = (entry->Valid >> index) & 1;
+    if (!isHit)
+      m_NumValidLines++;
+    const unsigned oldBlocks = entry->Blocks;
+    entry->Segments[index] = segments;
+    entry->Valid |= (1 << index);
+    entry->Blocks = getBlocks(*entry);
+    if (isHit && entry->Blocks > oldBlocks)
+      NumCompactions++;
+
+    // blocks for the superblock, from the least recently used others
+    freeBlocks += oldBlocks;
+    while (freeBlocks < entry->Blocks)
+      evict(set, freeBlocks, entry);
+    freeBlocks -= entry->Blocks;
+    return isHit;
+  }
+
+private:
+  // blocks of the lines of a superblock packed first fit, the largest first
+  unsigned getBlocks(const Entry &entry)
+  {
+    // insertion sort, there are CACHE_SUPERBLOCK_LINES sizes at most
+    unsigned sizes[CACHE_SUPERBLOCK_LINES];
+    unsigned numLines = 0;
+    for (unsigned i = 0; i < CACHE_SUPERBLOCK_LINES; i++)
+    {
+      if (!((entry.Valid >> i) & 1))
+        continue;
+      unsigned j = numLines++;
+      for (; j > 0 && sizes[j - 1] < entry.Segments[i]; j--)
+        sizes[j] = sizes[j - 1];
+      sizes[j] = entry.Segments[i];
+    }
+
+    unsigned used[CACHE_SUPERBLOCK_LINES];
+    unsigned numBlocks = 0;
+    for (unsigned i = 0; i < numLines; i++)
+    {
+      unsigned b = 0;
+      while (b < numBlocks && used[b] + sizes[i] > m_SegmentsPerBlock)
+        b++;
+      if (b == numBlocks)
+        used[numBlocks++] = 0;
+      used[b] += sizes[i];
+    }
+    return numBlocks;
+  }
+
+  Entry *evict(Entry *set, unsigned &freeBlocks, Entry *keep)
+  {
+    Entry *victim = nullptr;
+    for (unsigned w = 0; w < NumWays; w++)
+      if (set[w].LastAccess != 0 && &set[w] != keep && (victim == nullptr || set[w].LastAccess < victim->LastAccess))
+        victim = &set[w];
+    freeBlocks += victim->Blocks;
+    m_NumValidLines -= __builtin_popcount(victim->Valid);
+    NumEvictions += __builtin_popcount(victim->Valid);
+    victim->LastAccess = 0;
+    return victim;
+  }
+
+private:
+  std::vector<Entry> m_Entries;
+  std::vector<unsigned> m_FreeBlocks;
+};
+
+// Compressed caches simulated over the lines of the trace, a row of each.
+// The compressed size of a line is the one reported by the compressor in the same pass.
+struct CacheResult
+{
+  /*** constructors ***/
+  // spec is comma-separated <type>:<capacity in bytes>:<ways>, e.g. segmented:1048576:16
+  CacheResult(std::string spec)
+  {
+    for (std::string &cacheSpec : strutil::split(spec, ","))
+    {
+      std::vector<std::string> fields = strutil::split(cacheSpec, ":");
+      auto type = std::find(std::begin(CACHE_TYPE_NAMES), std::end(CACHE_TYPE_NAMES), fields[0]);
+      if (fields.size() != 3 || type == std::end(CACHE_TYPE_NAMES) || std::stoull(fields[2]) == 0)
+      {
+        printf("Invalid cache! \"%s\" is not <uncompressed/segmented/superblock>:<capacity>:<ways>.\n", cacheSpec.c_str());
+        exit(1);
+      }
+      const uint64_t capacity = std::stoull(fields[1]);
+      const unsigned numWays = std::stoul(fields[2]);
+      if (type - std::begin(CACHE_TYPE_NAMES) == CACHE_SUPERBLOCK && numWays < CACHE_SUPERBLOCK_LINES)
+      {
+        printf("Invalid cache! A superblock cache has at least %d ways.\n", CACHE_SUPERBLOCK_LINES);
+        exit(1);
+      }
+      if (type - std::begin(CACHE_TYPE_NAMES) == CACHE_SUPERBLOCK)
+        Caches.push_back(new SuperblockCache(capacity, numWays));
+      else
+        Caches.push_back(new SegmentedCache((CacheType)(type - std::begin(CACHE_TYPE_NAMES)), capacity, numWays));
+    }
+  }
+  ~CacheResult()
+  {
+    for (CacheModel *cache : Caches)
+      delete cache;
+  }
+
+  /*** methods ***/
+  void Update(addr_t addr, unsigned uncompSize, unsigned compSize)
+  {
+    for (CacheModel *cache : Caches)
+      cache->Access(addr, uncompSize, compSize);
+  }
+
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    writer.Header("workload,cache_type,capacity,ways,sets,accesses,hits,hit_rate,evictions,"
+        "compaction_stalls,moved_segments,effective_capacity,");
+
+    for (CacheModel *cache : Caches)
+    {
+      writer.Field("workload", workloadName);
+      writer.Field("cache_type", CACHE_TYPE_NAMES[cache->Type]);
+      writer.Field("capacity", cache->Capacity);
+      writer.Field("ways", cache->NumWays);
+      writer.Field("sets", cache->NumSets);
+      writer.Field("accesses", cache->NumAccesses);
+      writer.Field("hits", cache->NumHits);
+      writer.Field("hit_rate", (double)cache->NumHits / (double)cache->NumAccesses);
+      writer.Field("evictions", cache->NumEvictions);
+      writer.Field("compaction_stalls", cache->NumCompactions);
+      writer.Field("moved_segments", cache->NumMovedSegments);
+      writer.Field("effective_capacity", cache->GetEffectiveCapacity());
+      writer.EndRow();
+    }
+  }
+
+  /*** member variables ***/
+  std::vector<CacheModel*> Caches;
+};
+
+}
+
+#endif  // __CACHERESULT_H__
@@ -4,10 +4,15 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 #include <fmt/core.h>
 
 #include "../utils.h"
+#include "RecordWriter.h"
+#include "SizeSketch.h"
 #include "../loader/Loader.h"
 
 #define BYTE (8)
@@ -17,63 +22,140 @@
 #define BYTE8MAX (0xffffffffffffffff)
 
 #define COMPSIZELIMIT ((ACCESS_GRAN * BYTE) + 32)
+#define MAX_LINESIZE 256
 
 namespace comp
 {
 
+// snapshot of the lines of a window: a kernel, or a fixed span of cycles or lines
+struct WindowResult
+{
+  uint64_t Window;        // kernel ID, or index of the span
+  uint64_t FirstCycle;
+  uint64_t LastCycle;
+  uint64_t NumLines;
+  uint64_t OriginalSize;
+  uint64_t CompressedSize;
+};
+
 struct CompResult
 {
   CompResult(unsigned lineSize)
     : LineSize(lineSize),
       OriginalSize(0), CompressedSize(0), CompRatio(0) {};
+  virtual ~CompResult() = default;
 
   virtual void Update(unsigned uncompSize, unsigned compSize, int selected = 0)
   {
     OriginalSize += uncompSize;
     CompressedSize += compSize;
     CompRatio = (double)OriginalSize / (double)CompressedSize;
+    Sizes.Add(compSize);
+  }
+
+  // accumulate the sizes of a whole batch of lines at once,
+  // the size of each line goes to UpdateSizes
+  void UpdateBatch(uint64_t uncompSize, uint64_t compSize)
+  {
+    OriginalSize += uncompSize;
+    CompressedSize += compSize;
+    CompRatio = (double)OriginalSize / (double)CompressedSize;
+  }
+
+  void UpdateSizes(const unsigned *compSizes, unsigned numLines)
+  {
+    Sizes.AddBatch(compSizes, numLines);
+  }
+
+  // a copy of the result, of the same type
+  virtual CompResult* Clone() { return new CompResult(*this); }
+
+  // accumulate another result of the same type, windows are not merged
+  virtual void Merge(CompResult *other)
+  {
+    UpdateBatch(other->OriginalSize, other->CompressedSize);
+    Sizes.Merge(other->Sizes);
   }
 
   virtual void Print(std::string workloadName = "", std::string filePath = "")
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")
-    {
-      buff = std::cout.rdbuf();
-    }
-    else
+    RecordWriter writer(filePath);
+    writer.Header("workload,original_size,compressed_size,compression_ratio,");
+
+    // print result
+    // workloadname, originalsize, compressedsize, compratio
+    writer.Field("workload", workloadName);
+    writer.Field("original_size", OriginalSize);
+    writer.Field("compressed_size", CompressedSize);
+    writer.Field("compression_ratio", CompRatio);
+    writer.EndRow();
+  }
+
+  virtual void PrintDetail(std::string workloadName = "", std::string filePath = "") {}
+
+  // accumulate a line into its window,
+  // windows are kept in the order of their first line
+  void UpdateWindow(uint64_t window, uint64_t cycle, unsigned uncompSize, unsigned compSize)
+  {
+    if (Windows.empty() || Windows[m_LastWindow].Window != window)
     {
-      // write column index description
-      if (!isFileExists(filePath))
+      auto iter = m_WindowIndex.find(window);
+      if (iter == m_WindowIndex.end())
       {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << "workload,original_size,compressed_size,compression_ratio,";
-        file << std::endl;
-        file.close();
+        m_WindowIndex[window] = Windows.size();
+        Windows.push_back({ window, cycle, cycle, 0, 0, 0 });
+        m_LastWindow = Windows.size() - 1;
+      }
+      else
+      {
+        m_LastWindow = iter->second;
       }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
     }
-    std::ostream stream(buff);
 
-    // print result
-    // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{0},{1},{2},{3},", workloadName, OriginalSize, CompressedSize, CompRatio);
-    stream << std::endl;
+    WindowResult &result = Windows[m_LastWindow];
+    result.FirstCycle = std::min(result.FirstCycle, cycle);
+    result.LastCycle = std::max(result.LastCycle, cycle);
+    result.NumLines++;
+    result.OriginalSize += uncompSize;
+    result.CompressedSize += compSize;
+  }
+
+  // print a row per window, windowType names what the windows are
+  void PrintWindows(std::string workloadName = "", std::string windowType = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    writer.Header("workload,window_type,window,first_cycle,last_cycle,lines,original_size,compressed_size,compression_ratio,");
 
-    if (file.is_open())
-      file.close();
+    for (WindowResult &result : Windows)
+    {
+      writer.Field("workload", workloadName);
+      writer.Field("window_type", windowType);
+      writer.Field("window", result.Window);
+      writer.Field("first_cycle", result.FirstCycle);
+      writer.Field("last_cycle", result.LastCycle);
+      writer.Field("lines", result.NumLines);
+      writer.Field("original_size", result.OriginalSize);
+      writer.Field("compressed_size", result.CompressedSize);
+      writer.Field("compression_ratio", (double)result.OriginalSize / (double)result.CompressedSize);
+      writer.EndRow();
+    }
   }
 
-  virtual void PrintDetail(std::string workloadName = "", std::string filePath = "") {}
+  // print the distribution of the compressed sizes [bits], from the sketch
+  void PrintSizes(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    writer.Header("workload,lines,p50_size,p90_size,p99_size,fit_1_sector,fit_2_sectors,fit_3_sectors,fit_4_sectors,");
+
+    writer.Field("workload", workloadName);
+    writer.Field("lines", Sizes.Count);
+    writer.Field("p50_size", Sizes.GetQuantile(0.5));
+    writer.Field("p90_size", Sizes.GetQuantile(0.9));
+    writer.Field("p99_size", Sizes.GetQuantile(0.99));
+    for (unsigned s = 1; s <= NUM_SECTOR_BINS; s++)
+      writer.Field(fmt::format("fit_{}_sector{}", s, (s == 1) ? "" : "s"), Sizes.GetSectorFraction(s));
+    writer.EndRow();
+  }
 
   /*** member varibles ***/
   std::string CompressorName;
@@ -83,6 +165,48 @@ struct CompResult
   uint64_t CompressedSize;
   double CompRatio;
 
+  std::vector<WindowResult> Windows;
+  SizeSketch Sizes;
+
+private:
+  std::unordered_map<uint64_t, size_t> m_WindowIndex;
+  size_t m_LastWindow = 0;
+};
+
+// result of writing compressed lines and reading them back
+struct CodecResult
+{
+  CodecResult()
+    : NumLines(0), NumSkippedLines(0), ReportedBits(0), EncodedBits(0),
+      NumSizeMismatches(0), NumRoundTripErrors(0), EncodeSeconds(0), DecodeSeconds(0) {};
+
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    writer.Header("workload,lines,skipped_lines,reported_bits,encoded_bits,size_mismatches,roundtrip_errors,"
+        "encode_ns_per_line,decode_ns_per_line,");
+
+    writer.Field("workload", workloadName);
+    writer.Field("lines", NumLines);
+    writer.Field("skipped_lines", NumSkippedLines);
+    writer.Field("reported_bits", ReportedBits);
+    writer.Field("encoded_bits", EncodedBits);
+    writer.Field("size_mismatches", NumSizeMismatches);
+    writer.Field("roundtrip_errors", NumRoundTripErrors);
+    writer.Field("encode_ns_per_line", EncodeSeconds * 1e9 / (double)NumLines);
+    writer.Field("decode_ns_per_line", DecodeSeconds * 1e9 / (double)NumLines);
+    writer.EndRow();
+  }
+
+  /*** member varibles ***/
+  uint64_t NumLines;
+  uint64_t NumSkippedLines;     // lines of other sizes than the compressor's
+  uint64_t ReportedBits;        // sum of the sizes reported by the compressor
+  uint64_t EncodedBits;         // size of the written stream
+  uint64_t NumSizeMismatches;   // lines whose encoded size differs from the reported one
+  uint64_t NumRoundTripErrors;  // lines not decoded back to the original
+  double EncodeSeconds;
+  double DecodeSeconds;
 };
 
 }
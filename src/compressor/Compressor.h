@@ -6,18 +6,46 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cassert>
 
 #include <fmt/core.h>
 #include "../loader/Loader.h"
 #include "../loader/LoaderGPGPU.h"
 #include "CompResult.h"
+#include "BitStream.h"
+
+// read, write and NA
+#define NUM_RW (trace::NA + 1)
+// counts of a line kept by a LineRecord
+#define NUM_RECORD_COUNTS 8
 
 namespace comp
 {
 
+// the update of the result by a line, recorded to be replayed for the same line (see MemoCache)
+struct LineRecord
+{
+  unsigned CompSize;                    // bits
+  int Selected;                         // as stored by CompressLines
+  uint32_t Counts[NUM_RECORD_COUNTS];   // patterns of the line, by compressor
+  double Residues[2];                   // VPC: MAE and MSE of the line
+};
+
 class Compressor
 {
 public:
+  /*** constructors ***/
+  Compressor()
+    : m_Stat(nullptr), m_TotalStat(nullptr), m_RWStats{ nullptr } {}
+  virtual ~Compressor()
+  {
+    // m_Stat may point to a read/write class, the clones made by SelectResult
+    delete ((m_TotalStat == nullptr) ? m_Stat : m_TotalStat);
+    for (int rw = 0; rw < NUM_RW; rw++)
+      delete m_RWStats[rw];
+  }
+
   /*** getters ***/
   std::string GetCompressorName()
   {
@@ -26,10 +54,102 @@ public:
 
   /*** methods ***/
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine) = 0;
-  virtual CompResult* GetResult() { return m_Stat; }
+
+  // Compress numLines lines of lineSize bytes, placed back to back in dataLines,
+  // and store the compressed size of each line into compSizes.
+  // If selected is given, the module (or encoding) chosen for each line is stored into it,
+  // -1 for a line left uncompressed by VPC or for compressors without a per-line selection.
+  // Compressors may override this with a tighter loop and a single stat update per batch.
+  virtual void CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+      int *selected = nullptr)
+  {
+    std::vector<uint8_t> dataLine(lineSize);
+    for (unsigned i = 0; i < numLines; i++)
+    {
+      dataLine.assign(dataLines + i * lineSize, dataLines + (i + 1) * lineSize);
+      compSizes[i] = CompressLine(dataLine);
+    }
+    if (selected != nullptr)
+      std::fill(selected, selected + numLines, -1);
+  }
+
+  // Compress a line as CompressLine does, and write the compressed line into writer.
+  // Returns the compressed size reported by CompressLine.
+  virtual unsigned EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer)
+  {
+    std::cout << fmt::format("{} does not support encoding.", GetCompressorName()) << std::endl;
+    exit(1);
+  }
+
+  // Read a compressed line from reader into dataLine, sized to the line size.
+  // Returns false if the stream is corrupted.
+  virtual bool DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine)
+  {
+    std::cout << fmt::format("{} does not support decoding.", GetCompressorName()) << std::endl;
+    exit(1);
+  }
+
+  // Whether the result of a line depends on the line only, not on the lines before it,
+  // so that a line is compressed once and its record replayed for the same line.
+  // Compressors keeping a dictionary or statistics across lines (CPACK, SC2, PATTERN) are not.
+  virtual bool IsMemoizable() { return false; }
+
+  // Compress a line as CompressLine does, and record its update of the result into record.
+  virtual void RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record)
+  {
+    std::cout << fmt::format("{} does not support memoization.", GetCompressorName()) << std::endl;
+    exit(1);
+  }
+
+  // Update the result with a line of lineSize bytes, as compressing the line of record again would.
+  virtual void ReplayLine(unsigned lineSize, const LineRecord &record)
+  {
+    std::cout << fmt::format("{} does not support memoization.", GetCompressorName()) << std::endl;
+    exit(1);
+  }
+
+  // whether the compressor, as configured, produces a decodable stream
+  virtual bool IsDecodable() { return false; }
+
+  // the result of all lines, also while the results are split
+  virtual CompResult* GetResult() { return (m_TotalStat == nullptr) ? m_Stat : m_TotalStat; }
+
+  // the result of the lines of a read/write class, nullptr if not split or no line of the class
+  CompResult* GetResult(trace::rw_t rw) { return m_RWStats[rw]; }
+
+  // Keep the statistics of reads, writes and the others apart.
+  // The lines go to the class selected by SelectResult until MergeResults,
+  // and each class starts from a copy of the (still empty) result.
+  void SplitResult()
+  {
+    assert(m_TotalStat == nullptr);
+    m_TotalStat = m_Stat;
+  }
+
+  void SelectResult(trace::rw_t rw)
+  {
+    if (m_TotalStat == nullptr)
+      return;
+    if (m_RWStats[rw] == nullptr)
+      m_RWStats[rw] = m_TotalStat->Clone();
+    m_Stat = m_RWStats[rw];
+  }
+
+  // accumulate the classes into the result of all lines
+  void MergeResults()
+  {
+    if (m_TotalStat == nullptr)
+      return;
+    m_Stat = m_TotalStat;
+    for (int rw = 0; rw < NUM_RW; rw++)
+      if (m_RWStats[rw] != nullptr)
+        m_Stat->Merge(m_RWStats[rw]);
+  }
 
 protected:
   CompResult *m_Stat; 
+  CompResult *m_TotalStat;          // result of all lines when split
+  CompResult *m_RWStats[NUM_RW];    // results of each read/write class
 };
 
 }
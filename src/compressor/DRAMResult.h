@@ -0,0 +1,233 @@
+#ifndef __DRAMRESULT_H__
+#define __DRAMRESULT_H__
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <algorithm>
+
+#include <fmt/core.h>
+#include <json/json.h>
+#include "../utils.h"
+#include "RecordWriter.h"
+
+// requests buffered to replay the trace in cycle order, the trace is only roughly ordered
+#define DRAM_REORDER_WINDOW 4096
+// uncompressed and compressed lines
+#define NUM_DRAM_MODELS 2
+
+namespace comp
+{
+
+// a line of the trace at its DRAM coordinates, as given by GPGPU-Sim
+struct DRAMRequest
+{
+  uint64_t Cycle;
+  uint32_t Chip;
+  uint32_t Bank;
+  uint32_t Row;
+  uint64_t Seq;                         // order in the trace, breaking ties of cycles
+  unsigned Bursts[NUM_DRAM_MODELS];     // of the uncompressed and the compressed line
+};
+
+// DRAM timing, in cycles of the trace
+struct DRAMConfig
+{
+  unsigned BurstSize = 32;      // bytes
+  unsigned BurstCycles = 2;     // cycles of the data bus per burst
+  unsigned CAS = 12;
+  unsigned RCD = 12;
+  unsigned RP = 12;
+
+  void Parse(const Json::Value &root)
+  {
+    BurstSize = root.get("burst_size", BurstSize).asUInt();
+    BurstCycles = root.get("burst_cycles", BurstCycles).asUInt();
+    CAS = root.get("tCAS", CAS).asUInt();
+    RCD = root.get("tRCD", RCD).asUInt();
+    RP = root.get("tRP", RP).asUInt();
+    if (BurstSize == 0 || BurstCycles == 0)
+    {
+      printf("Invalid config! burst_size and burst_cycles are not positive.\n");
+      exit(1);
+    }
+  }
+};
+
+// Bandwidth model of the DRAM replaying the lines in cycle order, once uncompressed and once compressed.
+// Requests are events in a priority queue by cycle, bounded by DRAM_REORDER_WINDOW,
+// so that the trace streams through in a single pass whatever its length.
+// Each bank keeps its row open (open-page) and serves its requests in order,
+// pipelining the bursts of row hits, and each chip has a data bus shared by its banks:
+//  row hit      : data after tCAS
+//  row miss     : data after tRCD + tCAS, the bank was precharged
+//  row conflict : data after tRP + tRCD + tCAS, another row was open
+// A line moves the bursts its size rounds up to, at least one.
+class DRAMResult
+{
+  struct BankState
+  {
+    uint64_t ReadyCycle = 0;
+    uint32_t OpenRow = 0;
+    bool IsOpen = false;
+  };
+  struct ModelStat
+  {
+    uint64_t NumRequests = 0;
+    uint64_t NumBursts = 0;
+    uint64_t NumRowHits = 0;
+    uint64_t NumRowMisses = 0;
+    uint64_t NumRowConflicts = 0;
+    uint64_t BusyCycles = 0;
+    uint64_t SumLatency = 0;
+    uint64_t FirstCycle = UINT64_MAX;
+    uint64_t LastCycle = 0;
+  };
+  struct Later
+  {
+    bool operator()(const DRAMRequest &lhs, const DRAMRequest &rhs) const
+    {
+      return (lhs.Cycle != rhs.Cycle) ? (lhs.Cycle > rhs.Cycle) : (lhs.Seq > rhs.Seq);
+    }
+  };
+
+public:
+  /*** constructors ***/
+  DRAMResult(const DRAMConfig &config)
+    : Config(config), m_NumRequests(0), m_MaxLineSize(0) {}
+
+  /*** methods ***/
+  // sizes in bits
+  void Update(DRAMRequest request, unsigned uncompSize, unsigned compSize)
+  {
+    const unsigned burstBits = Config.BurstSize * 8;
+    const unsigned rawBursts = std::max((uncompSize + burstBits - 1) / burstBits, 1u);
+    m_MaxLineSize = std::max(m_MaxLineSize, uncompSize);
+    request.Seq = m_NumRequests++;
+    request.Bursts[0] = rawBursts;
+    request.Bursts[1] = std::min(std::max((compSize + burstBits - 1) / burstBits, 1u), rawBursts);
+
+    m_Events.push(request);
+    if (m_Events.size() > DRAM_REORDER_WINDOW)
+    {
+      serve(m_Events.top());
+      m_Events.pop();
+    }
+  }
+
+  // serve the requests left
+  void Finish()
+  {
+    while (!m_Events.empty())
+    {
+      serve(m_Events.top());
+      m_Events.pop();
+    }
+  }
+
+  // a row of the uncompressed lines, and a row of the compressed lines
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    static const char *MODEL_NAMES[NUM_DRAM_MODELS] = { "uncompressed", "compressed" };
+    Finish();
+
+    // a line takes a burst at least, so lines no larger than a burst save nothing
+    if (m_NumRequests != 0 && m_MaxLineSize <= Config.BurstSize * 8)
+      std::cout << fmt::format("DRAM model: the lines of {}B fit in a burst of {}B, compression saves no bursts "
+          "(burst_size of --dram-config).", m_MaxLineSize / 8, Config.BurstSize) << std::endl;
+
+    RecordWriter writer(filePath);
+    writer.Header("workload,model,requests,bursts,row_hits,row_misses,row_conflicts,"
+        "bus_busy_cycles,span_cycles,bus_occupancy,mean_latency,bandwidth_saved,speedup,");
+
+    for (int m = 0; m < NUM_DRAM_MODELS; m++)
+    {
+      const ModelStat &stat = m_Stats[m];
+      const uint64_t span = getSpan(m);
+      writer.Field("workload", workloadName);
+      writer.Field("model", MODEL_NAMES[m]);
+      writer.Field("requests", stat.NumRequests);
+      writer.Field("bursts", stat.NumBursts);
+      writer.Field("row_hits", stat.NumRowHits);
+      writer.Field("row_misses", stat.NumRowMisses);
+      writer.Field("row_conflicts", stat.NumRowConflicts);
+      writer.Field("bus_busy_cycles", stat.BusyCycles);
+      writer.Field("span_cycles", span);
+      writer.Field("bus_occupancy", (double)stat.BusyCycles / (double)span / (double)m_BusFreeCycles[m].size());
+      writer.Field("mean_latency", (double)stat.SumLatency / (double)stat.NumRequests);
+      writer.Field("bandwidth_saved", 1 - (double)stat.NumBursts / (double)m_Stats[0].NumBursts);
+      writer.Field("speedup", (double)getSpan(0) / (double)span);
+      writer.EndRow();
+    }
+  }
+
+private:
+  void serve(const DRAMRequest &request)
+  {
+    const uint64_t bankKey = ((uint64_t)request.Chip << 32) | request.Bank;
+    for (int m = 0; m < NUM_DRAM_MODELS; m++)
+    {
+      ModelStat &stat = m_Stats[m];
+      BankState &bank = m_Banks[m][bankKey];
+      uint64_t &busFreeCycle = m_BusFreeCycles[m][request.Chip];
+
+      uint64_t activation;
+      if (bank.IsOpen && bank.OpenRow == request.Row)
+      {
+        activation = 0;
+        stat.NumRowHits++;
+      }
+      else if (bank.IsOpen)
+      {
+        activation = Config.RP + Config.RCD;
+        stat.NumRowConflicts++;
+      }
+      else
+      {
+        activation = Config.RCD;
+        stat.NumRowMisses++;
+      }
+      bank.IsOpen = true;
+      bank.OpenRow = request.Row;
+
+      // column commands of the bank are pipelined at the rate of the bursts
+      const uint64_t busCycles = (uint64_t)request.Bursts[m] * Config.BurstCycles;
+      const uint64_t columnCycle = std::max(request.Cycle, bank.ReadyCycle) + activation;
+      bank.ReadyCycle = columnCycle + busCycles;
+      const uint64_t dataCycle = std::max(columnCycle + Config.CAS, busFreeCycle);
+      busFreeCycle = dataCycle + busCycles;
+
+      stat.NumRequests++;
+      stat.NumBursts += request.Bursts[m];
+      stat.BusyCycles += busCycles;
+      stat.SumLatency += busFreeCycle - request.Cycle;
+      stat.FirstCycle = std::min(stat.FirstCycle, request.Cycle);
+      stat.LastCycle = std::max(stat.LastCycle, busFreeCycle);
+    }
+  }
+
+  uint64_t getSpan(int m)
+  {
+    return (m_Stats[m].NumRequests == 0) ? 0 : m_Stats[m].LastCycle - m_Stats[m].FirstCycle;
+  }
+
+public:
+  /*** member variables ***/
+  const DRAMConfig Config;
+
+private:
+  std::priority_queue<DRAMRequest, std::vector<DRAMRequest>, Later> m_Events;
+  uint64_t m_NumRequests;
+  unsigned m_MaxLineSize;       // bits
+  ModelStat m_Stats[NUM_DRAM_MODELS];
+  std::unordered_map<uint64_t, BankState> m_Banks[NUM_DRAM_MODELS];
+  std::unordered_map<uint32_t, uint64_t> m_BusFreeCycles[NUM_DRAM_MODELS];
+};
+
+}
+
+#endif  // __DRAMRESULT_H__
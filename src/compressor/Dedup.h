@@ -0,0 +1,201 @@
+#ifndef __DEDUP_H__
+#define __DEDUP_H__
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+// lines within which a line, a word or a chunk seen again is a hit
+#define DEDUP_WINDOW (1 << 24)
+// entries of each table, bounding the memory to 16B per entry
+#define DEDUP_LINE_ENTRIES (1 << 22)
+#define DEDUP_WORD_ENTRIES (1 << 22)
+#define DEDUP_CHUNK_ENTRIES (1 << 22)
+// entries of a set, a set fills a cache line
+#define DEDUP_WAYS 4
+// reuse distances binned by log2, the last bin is DEDUP_WINDOW
+#define NUM_REUSE_BINS 25
+// lines longer than this are not deduplicated by word or chunk
+#define DEDUP_MAX_CHUNKS 64
+
+namespace comp
+{
+
+// Set-associative table of the last access of each key, with LRU replacement.
+// Keys evicted by a full set are forgotten, so a reuse is missed
+// when too many other keys are seen in between.
+class DedupTable
+{
+public:
+  struct Entry
+  {
+    uint64_t Key;
+    uint64_t LastSeen;      // index + 1 of the last access, 0 if empty
+  };
+  struct alignas(64) Set
+  {
+    Entry Ways[DEDUP_WAYS];
+  };
+
+  /*** constructors ***/
+  DedupTable(uint64_t numEntries)
+    : m_Sets(numEntries / DEDUP_WAYS), m_Mask(numEntries / DEDUP_WAYS - 1)
+  {
+    assert((numEntries & (numEntries - 1)) == 0 && numEntries >= DEDUP_WAYS);
+  }
+
+  /*** methods ***/
+  uint64_t GetSet(uint64_t key) { return hash(key) & m_Mask; }
+  void Prefetch(uint64_t set) { __builtin_prefetch(&m_Sets[set]); }
+
+  // distance from the last access of key to index, 0 if there is none
+  uint64_t Find(uint64_t set, uint64_t key, uint64_t index)
+  {
+    const Entry *ways = m_Sets[set].Ways;
+    for (int w = 0; w < DEDUP_WAYS; w++)
+      if (ways[w].LastSeen != 0 && ways[w].Key == key)
+        return index + 1 - ways[w].LastSeen;
+    return 0;
+  }
+
+  // record an access of key at index
+  void Touch(uint64_t set, uint64_t key, uint64_t index)
+  {
+    Entry *ways = m_Sets[set].Ways;
+    Entry *victim = &ways[0];
+    for (int w = 0; w < DEDUP_WAYS; w++)
+    {
+      if (ways[w].LastSeen != 0 && ways[w].Key == key)
+      {
+        ways[w].LastSeen = index + 1;
+        return;
+      }
+      if (ways[w].LastSeen < victim->LastSeen)
+        victim = &ways[w];
+    }
+    *victim = { key, index + 1 };
+  }
+
+  static uint64_t hash(uint64_t x)
+  {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  // fingerprint of a line, the tail shorter than a chunk included
+  static uint64_t Fingerprint(const uint8_t *line, unsigned lineSize)
+  {
+    uint64_t key = hash(lineSize);
+    for (unsigned i = 0; i < lineSize / 8; i++)
+    {
+      uint64_t chunk;
+      std::memcpy(&chunk, line + i * 8, 8);
+      key = hash(key ^ chunk);
+    }
+    for (unsigned i = lineSize / 8 * 8; i < lineSize; i++)
+      key = hash(key ^ line[i]);
+    return key;
+  }
+
+private:
+  std::vector<Set> m_Sets;
+  uint64_t m_Mask;
+};
+
+// hits of a line against the previous lines of the window
+struct DedupHits
+{
+  uint64_t LineDistance;    // distance to the same line, 0 if not in the window
+  unsigned WordHits;        // 4-byte words seen in a previous line
+  unsigned ChunkHits;       // 8-byte chunks seen in a previous line
+  uint64_t ChunkDistances[DEDUP_MAX_CHUNKS];  // distance of each chunk, 0 if missed
+  unsigned NumChunks;
+};
+
+// Temporal redundancy of a stream of lines in a single pass:
+// exact-line dedup by a 64-bit fingerprint of the line,
+// and word (4B) and chunk (8B) dedup by value, all against the last DEDUP_WINDOW lines.
+// A value is a hit if a previous line of the window has it, not the same line.
+class DedupEngine
+{
+public:
+  /*** constructors ***/
+  DedupEngine()
+    : m_LineTable(DEDUP_LINE_ENTRIES), m_WordTable(DEDUP_WORD_ENTRIES), m_ChunkTable(DEDUP_CHUNK_ENTRIES),
+      m_NumLines(0) {}
+
+  /*** methods ***/
+  void Access(const uint8_t *line, unsigned lineSize, DedupHits &hits)
+  {
+    const unsigned numChunks = std::min(lineSize / 8, (unsigned)DEDUP_MAX_CHUNKS);
+    const unsigned numWords = numChunks * 2;
+    uint64_t chunks[DEDUP_MAX_CHUNKS];
+    uint64_t chunkSets[DEDUP_MAX_CHUNKS];
+    uint64_t wordSets[DEDUP_MAX_CHUNKS * 2];
+    std::memcpy(chunks, line, numChunks * 8);
+
+    const uint64_t fingerprint = DedupTable::Fingerprint(line, lineSize);
+
+    // sets are prefetched first, so that the misses overlap
+    const uint64_t lineSet = m_LineTable.GetSet(fingerprint);
+    m_LineTable.Prefetch(lineSet);
+    for (unsigned i = 0; i < numChunks; i++)
+    {
+      chunkSets[i] = m_ChunkTable.GetSet(chunks[i]);
+      m_ChunkTable.Prefetch(chunkSets[i]);
+      wordSets[2 * i] = m_WordTable.GetSet(getWord(chunks, 2 * i));
+      wordSets[2 * i + 1] = m_WordTable.GetSet(getWord(chunks, 2 * i + 1));
+      m_WordTable.Prefetch(wordSets[2 * i]);
+      m_WordTable.Prefetch(wordSets[2 * i + 1]);
+    }
+
+    // all the words and chunks are found before any is recorded,
+    // so that a value repeated in the line is a hit as often as it appears
+    const uint64_t index = m_NumLines++;
+    hits.LineDistance = inWindow(m_LineTable.Find(lineSet, fingerprint, index));
+    m_LineTable.Touch(lineSet, fingerprint, index);
+    hits.WordHits = 0;
+    hits.ChunkHits = 0;
+    hits.NumChunks = numChunks;
+    for (unsigned i = 0; i < numChunks; i++)
+    {
+      hits.ChunkDistances[i] = inWindow(m_ChunkTable.Find(chunkSets[i], chunks[i], index));
+      hits.ChunkHits += (hits.ChunkDistances[i] != 0);
+    }
+    for (unsigned i = 0; i < numWords; i++)
+      hits.WordHits += (inWindow(m_WordTable.Find(wordSets[i], getWord(chunks, i), index)) != 0);
+    for (unsigned i = 0; i < numChunks; i++)
+      m_ChunkTable.Touch(chunkSets[i], chunks[i], index);
+    for (unsigned i = 0; i < numWords; i++)
+      m_WordTable.Touch(wordSets[i], getWord(chunks, i), index);
+  }
+
+  static unsigned GetReuseBin(uint64_t distance)
+  {
+    return 63 - __builtin_clzll(distance);
+  }
+
+private:
+  static uint64_t getWord(const uint64_t *chunks, unsigned i)
+  {
+    return (i % 2 == 0) ? (chunks[i / 2] & 0xFFFFFFFF) : (chunks[i / 2] >> 32);
+  }
+
+  static uint64_t inWindow(uint64_t distance)
+  {
+    return (distance <= DEDUP_WINDOW) ? distance : 0;
+  }
+
+private:
+  DedupTable m_LineTable;
+  DedupTable m_WordTable;
+  DedupTable m_ChunkTable;
+  uint64_t m_NumLines;
+};
+
+}
+
+#endif  // __DEDUP_H__
@@ -0,0 +1,232 @@
+#ifndef __ENTROPY_H__
+#define __ENTROPY_H__
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include <fmt/core.h>
+#include "../utils.h"
+#include "CompResult.h"
+
+#define NUM_BYTE_SYMBOLS 256
+#define NUM_HALF_SYMBOLS 65536
+// count-min sketch of 32-bit words, 16MB in blocks of a cache line
+#define CMS_DEPTH 4
+#define CMS_BLOCK 16
+#define CMS_NUM_BLOCKS (1 << 18)
+// words of a line counted by the sketch
+#define ENTROPY_MAX_WORDS 64
+
+namespace comp
+{
+
+// Add the histogram of bytes into four interleaved sub-histograms,
+// so that a run of the same byte does not serialize on a single counter.
+// The histogram is the sum of the four.
+static inline void CountBytes(const uint8_t *data, size_t size, uint64_t (*counts)[NUM_BYTE_SYMBOLS])
+{
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4)
+  {
+    counts[0][data[i]]++;
+    counts[1][data[i + 1]]++;
+    counts[2][data[i + 2]]++;
+    counts[3][data[i + 3]]++;
+  }
+  for (; i < size; i++)
+    counts[0][data[i]]++;
+}
+
+// entropy in bits per symbol, sum(-p * log2(p))
+static inline double ComputeEntropy(const uint64_t *counts, size_t numSymbols)
+{
+  uint64_t sum = 0;
+  for (size_t s = 0; s < numSymbols; s++)
+    sum += counts[s];
+
+  double entropy = 0;
+  for (size_t s = 0; s < numSymbols; s++)
+  {
+    if (counts[s] == 0)
+      continue;
+    double probability = (double)counts[s] / (double)sum;
+    entropy += -probability * log2(probability);
+  }
+  return entropy;
+}
+
+// Count-min sketch with conservative update,
+// counts are over-estimated only by the collisions in all the rows.
+// The counters of a key are in a single block of a cache line (a blocked sketch),
+// so that an increment misses the cache once.
+class CountMinSketch
+{
+public:
+  struct alignas(64) Block
+  {
+    uint32_t Counters[CMS_BLOCK];
+  };
+
+  /*** constructors ***/
+  CountMinSketch()
+    : m_Blocks(CMS_NUM_BLOCKS, Block{ { 0 } }) {}
+
+  /*** methods ***/
+  // counter of key in each row, the block is prefetched before the increment
+  void Locate(uint64_t key, uint32_t **counters)
+  {
+    const uint64_t h = hash(key);
+    Block &block = m_Blocks[h & (CMS_NUM_BLOCKS - 1)];
+    __builtin_prefetch(&block);
+    // a row is a quarter of the block, indexed by 2 bits of the hash each
+    for (int d = 0; d < CMS_DEPTH; d++)
+      counters[d] = &block.Counters[d * (CMS_BLOCK / CMS_DEPTH) + ((h >> (32 + 2 * d)) & (CMS_BLOCK / CMS_DEPTH - 1))];
+  }
+
+  // count key once more, returns the estimated count of key
+  static uint32_t Increment(uint32_t **counters)
+  {
+    uint32_t count = UINT32_MAX;
+    for (int d = 0; d < CMS_DEPTH; d++)
+      count = std::min(count, *counters[d]);
+    count++;
+    for (int d = 0; d < CMS_DEPTH; d++)
+      *counters[d] = std::max(*counters[d], count);
+    return count;
+  }
+
+private:
+  static uint64_t hash(uint64_t x)
+  {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+private:
+  std::vector<Block> m_Blocks;
+};
+
+// Entropy bounds of the lines, a side pass next to any compressor:
+//  order-0 and order-1 (given the previous byte of the line) byte entropy,
+//  entropy of aligned 16-bit symbols, exact with dense counters,
+//  entropy of aligned 32-bit words, estimated with a count-min sketch.
+// Each is also given as the compression ratio of an ideal coder of that model.
+struct EntropyResult
+{
+  /*** constructors ***/
+  EntropyResult()
+    : NumLines(0), NumBytes(0), NumWords(0),
+      PairCounts(NUM_HALF_SYMBOLS, 0), HalfCounts(NUM_HALF_SYMBOLS, 0),
+      m_CLogCTable(1 << 16, 0), m_ByteCounts{ { 0 } }, m_SumCLogC(0)
+  {
+    for (uint32_t c = 1; c < m_CLogCTable.size(); c++)
+      m_CLogCTable[c] = c * log2((double)c);
+  }
+
+  /*** methods ***/
+  void Update(const uint8_t *line, unsigned lineSize)
+  {
+    NumLines++;
+    NumBytes += lineSize;
+    CountBytes(line, lineSize, m_ByteCounts);
+    for (unsigned i = 1; i < lineSize; i++)
+      PairCounts[(line[i - 1] << 8) | line[i]]++;
+    for (unsigned i = 0; i + 2 <= lineSize; i += 2)
+      HalfCounts[line[i] | (line[i + 1] << 8)]++;
+
+    // sum of c * log2(c) over the words, updated as each count grows from c - 1 to c,
+    // the counters of all the words of the line are located (and prefetched) first
+    const unsigned numWords = std::min(lineSize / 4, (unsigned)ENTROPY_MAX_WORDS);
+    uint32_t *counters[ENTROPY_MAX_WORDS][CMS_DEPTH];
+    for (unsigned i = 0; i < numWords; i++)
+    {
+      uint32_t word;
+      std::memcpy(&word, line + i * 4, 4);
+      m_Sketch.Locate(word, counters[i]);
+    }
+    for (unsigned i = 0; i < numWords; i++)
+    {
+      const uint32_t count = CountMinSketch::Increment(counters[i]);
+      m_SumCLogC += cLogC(count) - cLogC(count - 1);
+    }
+    NumWords += numWords;
+  }
+
+  // bits per byte of each model
+  double GetOrder0()
+  {
+    uint64_t byteCounts[NUM_BYTE_SYMBOLS];
+    for (int s = 0; s < NUM_BYTE_SYMBOLS; s++)
+      byteCounts[s] = m_ByteCounts[0][s] + m_ByteCounts[1][s] + m_ByteCounts[2][s] + m_ByteCounts[3][s];
+    return ComputeEntropy(byteCounts, NUM_BYTE_SYMBOLS);
+  }
+  double GetOrder1()
+  {
+    // H(X_i | X_i-1) = H(X_i-1, X_i) - H(X_i-1)
+    std::vector<uint64_t> prevCounts(NUM_BYTE_SYMBOLS, 0);
+    for (int s = 0; s < NUM_HALF_SYMBOLS; s++)
+      prevCounts[s >> 8] += PairCounts[s];
+    return ComputeEntropy(PairCounts.data(), NUM_HALF_SYMBOLS) - ComputeEntropy(prevCounts.data(), NUM_BYTE_SYMBOLS);
+  }
+  double GetHalf() { return ComputeEntropy(HalfCounts.data(), NUM_HALF_SYMBOLS) / 2; }
+  double GetWord()
+  {
+    if (NumWords == 0)
+      return 0;
+    // H = log2(N) - sum(c * log2(c)) / N, with the counts of the sketch
+    return std::max(0.0, log2((double)NumWords) - m_SumCLogC / (double)NumWords) / 4;
+  }
+
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    static const char *MODEL_NAMES[4] = { "order0", "order1", "symbol16", "word32" };
+
+    RecordWriter writer(filePath);
+    writer.Header("workload,lines,bytes,"
+        "order0 [b/B],order1 [b/B],symbol16 [b/B],word32 [b/B],"
+        "order0_ratio,order1_ratio,symbol16_ratio,word32_ratio,");
+
+    const double entropies[4] = { GetOrder0(), GetOrder1(), GetHalf(), GetWord() };
+    writer.Field("workload", workloadName);
+    writer.Field("lines", NumLines);
+    writer.Field("bytes", NumBytes);
+    for (int i = 0; i < 4; i++)
+      writer.Field(MODEL_NAMES[i], entropies[i]);
+    for (int i = 0; i < 4; i++)
+      writer.Field(fmt::format("{}_ratio", MODEL_NAMES[i]), BYTE / entropies[i]);
+    writer.EndRow();
+  }
+
+  /*** member variables ***/
+  uint64_t NumLines;
+  uint64_t NumBytes;
+  uint64_t NumWords;
+  std::vector<uint64_t> PairCounts;   // previous byte << 8 | byte
+  std::vector<uint64_t> HalfCounts;
+
+private:
+  // c * log2(c), from a table for small counts
+  double cLogC(uint32_t count)
+  {
+    if (count < m_CLogCTable.size())
+      return m_CLogCTable[count];
+    return count * log2((double)count);
+  }
+
+private:
+  std::vector<double> m_CLogCTable;
+  uint64_t m_ByteCounts[4][NUM_BYTE_SYMBOLS];
+  CountMinSketch m_Sketch;
+  double m_SumCLogC;
+};
+
+}
+
+#endif  // __ENTROPY_H__
@@ -1,15 +1,152 @@
+#include <cassert>
+#include <algorithm>
 #include "FPC.h"
 #include "Compressor.h"
 
 namespace comp
 {
 
+// names of the patterns of each prefix in the config
+static const char *FPC_PATTERN_NAMES[NUM_FPC_PATTERN] = {
+  "zero_run", "sign4", "sign8", "sign16", "zero_padded16", "halfword_sign8", "repeated_bytes", "uncompressed"
+};
+
 unsigned FPC::CompressLine(std::vector<uint8_t> &dataLine)
 {
-//  const unsigned lineSize = dataLine.size();
+  const unsigned lineSize = dataLine.size();
+
+  uint64_t counts[NUM_FPC_PATTERN] = { 0 };
+  unsigned compressedSize = compressLine(dataLine.data(), lineSize, counts);
+
+  const unsigned numWords = lineSize / 4;
+  static_cast<FPCResult*>(m_Stat)->UpdateBatch(4*BYTE*numWords, compressedSize, numWords, counts);
+  m_Stat->UpdateSizes(&compressedSize, 1);
+  return compressedSize;
+}
+
+void FPC::CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+    int *selected)
+{
+  uint64_t counts[NUM_FPC_PATTERN] = { 0 };
+  uint64_t compressedSize = 0;
+
+  for (unsigned i = 0; i < numLines; i++)
+  {
+    compSizes[i] = compressLine(dataLines + i * lineSize, lineSize, counts);
+    compressedSize += compSizes[i];
+  }
+
+  // patterns are selected per word
+  if (selected != nullptr)
+    std::fill(selected, selected + numLines, -1);
+
+  const uint64_t numWords = (uint64_t)(lineSize / 4) * numLines;
+  static_cast<FPCResult*>(m_Stat)->UpdateBatch(4*BYTE*numWords, compressedSize, numWords, counts);
+  m_Stat->UpdateSizes(compSizes, numLines);
+}
 
-  std::vector<uint32_t> dataConcat = concatenate(dataLine);
-  const unsigned concatSize = dataConcat.size();
+void FPC::RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record)
+{
+  uint64_t counts[NUM_FPC_PATTERN] = { 0 };
+  record.CompSize = compressLine(dataLine, lineSize, counts);
+  // patterns are selected per word
+  record.Selected = -1;
+  for (int i = 0; i < NUM_FPC_PATTERN; i++)
+    record.Counts[i] = counts[i];
+  ReplayLine(lineSize, record);
+}
+
+void FPC::ReplayLine(unsigned lineSize, const LineRecord &record)
+{
+  uint64_t counts[NUM_FPC_PATTERN];
+  std::copy(record.Counts, record.Counts + NUM_FPC_PATTERN, counts);
+
+  const unsigned numWords = lineSize / 4;
+  static_cast<FPCResult*>(m_Stat)->UpdateBatch(4*BYTE*numWords, record.CompSize, numWords, counts);
+  m_Stat->UpdateSizes(&record.CompSize, 1);
+}
+
+unsigned FPC::EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer)
+{
+  const unsigned lineSize = dataLine.size();
+
+  uint64_t counts[NUM_FPC_PATTERN] = { 0 };
+  unsigned compressedSize = compressLine(dataLine.data(), lineSize, counts, &writer);
+
+  const unsigned numWords = lineSize / 4;
+  static_cast<FPCResult*>(m_Stat)->UpdateBatch(4*BYTE*numWords, compressedSize, numWords, counts);
+  m_Stat->UpdateSizes(&compressedSize, 1);
+  return compressedSize;
+}
+
+bool FPC::DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine)
+{
+  const unsigned lineSize = m_Stat->LineSize;
+  const unsigned numWords = lineSize / 4;
+  dataLine.resize(lineSize);
+
+  // sign extension of the numBits LSBs
+  auto signExtend = [](uint32_t value, unsigned numBits) -> uint32_t {
+    return (uint32_t)((int32_t)(value << (32 - numBits)) >> (32 - numBits));
+  };
+
+  unsigned i = 0;
+  while(i < numWords)
+  {
+    uint32_t val = 0;
+    switch((FPCState)reader.Read(PREFIX_SIZE))
+    {
+    case FPCState::Prefix0:
+    {
+      unsigned runLength = reader.Read(m_ZeroRunBits) + 1;
+      if(i + runLength > numWords)
+        return false;
+      for(unsigned j = 0; j < 4 * runLength; j++)
+        dataLine[4*i + j] = 0;
+      i += runLength;
+      continue;
+    }
+    case FPCState::Prefix1:
+      val = signExtend(reader.Read(4), 4);
+      break;
+    case FPCState::Prefix2:
+      val = signExtend(reader.Read(8), 8);
+      break;
+    case FPCState::Prefix3:
+      val = signExtend(reader.Read(16), 16);
+      break;
+    case FPCState::Prefix4:
+      val = reader.Read(16) << 16;
+      break;
+    case FPCState::Prefix5:
+    {
+      uint32_t halfwords = reader.Read(16);
+      val = (signExtend(halfwords >> BYTE, 8) << 16) | (signExtend(halfwords & 0xFF, 8) & 0xFFFF);
+      break;
+    }
+    case FPCState::Prefix6:
+      val = reader.Read(8) * 0x01010101;
+      break;
+    default:
+      val = reader.Read(4*BYTE);
+      break;
+    }
+
+    // little endian
+    for(int j = 0; j < 4; j++)
+      dataLine[4*i + j] = (val >> (BYTE*j)) & 0xFF;
+    i++;
+  }
+
+  return !reader.IsOverrun();
+}
+
+unsigned FPC::compressLine(const uint8_t *dataLine, const unsigned lineSize, uint64_t *counts, BitWriter *writer)
+{
+  if (m_Concat.size() < lineSize / 4)
+    m_Concat.resize(lineSize / 4);
+  uint32_t *dataConcat = m_Concat.data();
+  const unsigned concatSize = concatenate(dataLine, lineSize, dataConcat);
 
   unsigned currCSize = 0;
   unsigned i = 0;
@@ -17,95 +154,143 @@ unsigned FPC::CompressLine(std::vector<uint8_t> &dataLine)
   {
     uint32_t val = dataConcat[i];
 
-    // prefix 000 : zero value runs
-    if(val == 0x00000000)
+    // prefix 000 : zero value runs, up to m_MaxZeroRun (8) words
+    if(m_Enabled[0] && val == 0x00000000)
     {
-      currCSize += 3 + PREFIX_SIZE;
+      currCSize += m_ZeroRunBits + PREFIX_SIZE;
+      unsigned runLength = 1;
       i++;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 3 + PREFIX_SIZE, (int)FPCState::Prefix0);
-      while(dataConcat[i] == 0x00000000)
+      counts[(int)FPCState::Prefix0]++;
+      while(i < concatSize && dataConcat[i] == 0x00000000 && runLength < m_MaxZeroRun)
       {
+        runLength++;
         i++;
-        static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 0, (int)FPCState::Prefix0);
+        counts[(int)FPCState::Prefix0]++;
       }
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix0 << m_ZeroRunBits) | (runLength - 1), m_ZeroRunBits + PREFIX_SIZE);
       continue;
     }
     // prefix 001 : 4-bit sign extended
-    else if(((val & 0xFFFFFFF8) == 0x00000000)
-        ||  ((val & 0xFFFFFFF8) == 0xFFFFFFF8))
+    else if(m_Enabled[1]
+        && (((val & 0xFFFFFFF8) == 0x00000000)
+        ||  ((val & 0xFFFFFFF8) == 0xFFFFFFF8)))
     {
       currCSize += 4 + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 4 + PREFIX_SIZE, (int)FPCState::Prefix1);
+      counts[(int)FPCState::Prefix1]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix1 << 4) | (val & 0xF), 4 + PREFIX_SIZE);
     }
     // prefix 010 : 8-bit sign extended
-    else if(((val & 0xFFFFFF80) == 0x00000000)
-        ||  ((val & 0xFFFFFF80) == 0xFFFFFF80))
+    else if(m_Enabled[2]
+        && (((val & 0xFFFFFF80) == 0x00000000)
+        ||  ((val & 0xFFFFFF80) == 0xFFFFFF80)))
     {
       currCSize += 8 + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 8 + PREFIX_SIZE, (int)FPCState::Prefix2);
+      counts[(int)FPCState::Prefix2]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix2 << 8) | (val & 0xFF), 8 + PREFIX_SIZE);
     }
     // prefix 011 : 16-bit sign extended
-    else if(((val & 0xFFFF8000) == 0x00000000)
-        ||  ((val & 0xFFFF8000) == 0xFFFF8000))
+    else if(m_Enabled[3]
+        && (((val & 0xFFFF8000) == 0x00000000)
+        ||  ((val & 0xFFFF8000) == 0xFFFF8000)))
     {
       currCSize += 16 + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 16 + PREFIX_SIZE, (int)FPCState::Prefix3);
+      counts[(int)FPCState::Prefix3]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix3 << 16) | (val & 0xFFFF), 16 + PREFIX_SIZE);
     }
     // prefix 100 : 16-bit padded with a zero
-    else if((val & 0x0000FFFF) == 0x00000000)
+    else if(m_Enabled[4] && (val & 0x0000FFFF) == 0x00000000)
     {
       currCSize += 16 + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 16 + PREFIX_SIZE, (int)FPCState::Prefix4);
+      counts[(int)FPCState::Prefix4]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix4 << 16) | (val >> 16), 16 + PREFIX_SIZE);
     }
     // prefix 101 : two halfwords, each a byte sign-extended
-    else if(((val & 0xFF80FF80) == 0x00000000)
+    else if(m_Enabled[5]
+        && (((val & 0xFF80FF80) == 0x00000000)
         ||  ((val & 0xFF80FF80) == 0xFF800000)
         ||  ((val & 0xFF80FF80) == 0x0000FF80)
-        ||  ((val & 0xFF80FF80) == 0xFF80FF80))
+        ||  ((val & 0xFF80FF80) == 0xFF80FF80)))
     {
       currCSize += 16 + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 16 + PREFIX_SIZE, (int)FPCState::Prefix5);
+      counts[(int)FPCState::Prefix5]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix5 << 16) | ((val >> BYTE) & 0xFF00) | (val & 0xFF), 16 + PREFIX_SIZE);
     }
     // prefix 110 : word consisting fo repeated bytes
-    else if(((val & 0xFF) == ((val >> BYTE) & 0xFF))
+    else if(m_Enabled[6]
+        &&  ((val & 0xFF) == ((val >> BYTE) & 0xFF))
         &&  ((val & 0xFF) == ((val >> 2*BYTE) & 0xFF))
         &&  ((val & 0xFF) == ((val >> 3*BYTE) & 0xFF)))
     {
       currCSize += 8 + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 8 + PREFIX_SIZE, (int)FPCState::Prefix6);
+      counts[(int)FPCState::Prefix6]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix6 << 8) | (val & 0xFF), 8 + PREFIX_SIZE);
     }
     else
     {
       currCSize += 4*BYTE + PREFIX_SIZE;
-      static_cast<FPCResult*>(m_Stat)->Update(4*BYTE, 4*BYTE + PREFIX_SIZE, (int)FPCState::Prefix7);
+      counts[(int)FPCState::Prefix7]++;
+      if(writer != nullptr)
+        writer->Write(((uint64_t)FPCState::Prefix7 << 32) | val, 4*BYTE + PREFIX_SIZE);
     }
     i++;
   }
 
-  unsigned compressedSize = currCSize;
-  return compressedSize;
+  return currCSize;
 }
 
-std::vector<uint32_t> FPC::concatenate(std::vector<uint8_t> &dataLine)
+void FPC::parseConfig(const Json::Value &root)
+{
+  // bits of the length of a zero run
+  m_ZeroRunBits = root.get("zero_run_bits", m_ZeroRunBits).asUInt();
+  if (m_ZeroRunBits == 0 || m_ZeroRunBits > 8)
+  {
+    printf("Invalid config! zero_run_bits %u is not in 1..8.\n", m_ZeroRunBits);
+    exit(1);
+  }
+  m_MaxZeroRun = 1 << m_ZeroRunBits;
+
+  // patterns, all of them if not given, uncompressed words can not be disabled
+  const Json::Value &patterns = root["patterns"];
+  if (!patterns.isNull())
+  {
+    std::fill(m_Enabled, m_Enabled + NUM_FPC_PATTERN, false);
+    m_Enabled[(int)FPCState::Prefix7] = true;
+    for (const Json::Value &pattern : patterns)
+    {
+      const char **name = std::find(FPC_PATTERN_NAMES, FPC_PATTERN_NAMES + NUM_FPC_PATTERN - 1, pattern.asString());
+      if (name == FPC_PATTERN_NAMES + NUM_FPC_PATTERN - 1)
+      {
+        printf("Invalid config! \"%s\" is not an FPC pattern.\n", pattern.asString().c_str());
+        exit(1);
+      }
+      m_Enabled[name - FPC_PATTERN_NAMES] = true;
+    }
+  }
+}
+
+unsigned FPC::concatenate(const uint8_t *dataLine, const unsigned lineSize, uint32_t *dataConcat)
 {
   const unsigned granularity = 4;
-  std::vector<uint32_t> dataConcat;
-  uint32_t temp;
+  const unsigned dataConcatSize = lineSize / granularity;
 
-  unsigned dataConcatSize = dataLine.size() / granularity;
   for(unsigned i = 0; i < dataConcatSize; i++)
   {
-    temp = 0;
+    uint32_t temp = 0;
     // little endian
     for(int j = granularity-1; j >= 0; j--)
       temp = (temp << BYTE) | dataLine[i*granularity + j];
 
-    dataConcat.push_back(temp);
+    dataConcat[i] = temp;
   }
 
-  return dataConcat;
+  return dataConcatSize;
 }
 
 }
-
-
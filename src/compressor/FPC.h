@@ -6,6 +6,7 @@
 
 #define PREFIX_SIZE 3
 #define NUM_FPC_PATTERN 8
+#define ZERO_RUN_BITS 3
 
 namespace comp
 {
@@ -36,51 +37,49 @@ struct FPCResult : public CompResult
     Counts[selected]++;
   }
 
+  void UpdateBatch(uint64_t uncompSize, uint64_t compSize, uint64_t numWords, const uint64_t *counts)
+  {
+    CompResult::UpdateBatch(uncompSize, compSize);
+
+    TotalWords += numWords;
+    for (int i = 0; i < NUM_FPC_PATTERN; i++)
+      Counts[i] += counts[i];
+  }
+
+  virtual CompResult* Clone() { return new FPCResult(*this); }
+
+  virtual void Merge(CompResult *other)
+  {
+    CompResult::Merge(other);
+
+    FPCResult *result = static_cast<FPCResult*>(other);
+    TotalWords += result->TotalWords;
+    for (int i = 0; i < NUM_FPC_PATTERN; i++)
+      Counts[i] += result->Counts[i];
+  }
+
   virtual void Print(std::string workloadName = "", std::string filePath = "")
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")  // stdout
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
     {
-      buff = std::cout.rdbuf();
+      std::string header = "Workload,Original Size,Compressed Size,Compression Ratio,Total Words,";
+      for (int i = 0; i < NUM_FPC_PATTERN; i++)
+        header += fmt::format("Prefix{},", i);
+      writer.Header(header);
     }
-    else  // file
-    {
-      // write column index description
-      if (!isFileExists(filePath))
-      {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << "Workload,Original Size,Compressed Size,Compression Ratio,";
-        file << "Total Words,";
-        for (int i = 0; i < NUM_FPC_PATTERN; i++)
-          file << fmt::format("Prefix{},", i);
-        file << std::endl;
-        file.close();
-      }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
-    }
-    std::ostream stream(buff);
 
     // print result
     // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{0},{1},{2},{3},", workloadName, OriginalSize, CompressedSize, CompRatio);
+    writer.Field("workload", workloadName);
+    writer.Field("original_size", OriginalSize);
+    writer.Field("compressed_size", CompressedSize);
+    writer.Field("compression_ratio", CompRatio);
     // word counts
-    stream << fmt::format("{0},", TotalWords);
+    writer.Field("total_words", TotalWords);
     // selection counts
-    for (int i = 0; i < 8; i++)
-      stream << fmt::format("{},", Counts[i]);
-    stream << std::endl;
-
-    if (file.is_open())
-      file.close();
+    writer.Array("prefix", Counts.data(), NUM_FPC_PATTERN);
+    writer.EndRow();
   }
 
   /*** member variables ***/
@@ -91,16 +90,41 @@ struct FPCResult : public CompResult
 class FPC : public Compressor
 {
 public:
-  FPC(unsigned lineSize)
+  // the config may set the bits of a zero run, and enable a subset of the patterns,
+  // e.g. { "zero_run_bits": 4, "patterns": ["zero_run", "sign8", "repeated_bytes"] }
+  FPC(unsigned lineSize, const Json::Value &config = Json::Value())
+    : m_ZeroRunBits(ZERO_RUN_BITS), m_MaxZeroRun(1 << ZERO_RUN_BITS)
   {
     m_Stat = new FPCResult(lineSize);
     m_Stat->CompressorName = "Frequent Pattern Compression";
+
+    std::fill(m_Enabled, m_Enabled + NUM_FPC_PATTERN, true);
+    if (!config.isNull())
+      parseConfig(config);
   }
 
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine);
+  virtual void CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+      int *selected = nullptr);
+
+  virtual unsigned EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer);
+  virtual bool DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine);
+  virtual bool IsDecodable() { return (m_Stat->LineSize % 4 == 0) && (m_Stat->LineSize <= MAX_LINESIZE); }
+
+  virtual bool IsMemoizable() { return true; }
+  virtual void RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record);
+  virtual void ReplayLine(unsigned lineSize, const LineRecord &record);
+
+private:
+  void parseConfig(const Json::Value &root);
+  unsigned compressLine(const uint8_t *dataLine, const unsigned lineSize, uint64_t *counts, BitWriter *writer = nullptr);
+  unsigned concatenate(const uint8_t *dataLine, const unsigned lineSize, uint32_t *dataConcat);
 
 private:
-  std::vector<uint32_t> concatenate(std::vector<uint8_t> &dataLine);
+  unsigned m_ZeroRunBits;
+  unsigned m_MaxZeroRun;
+  bool m_Enabled[NUM_FPC_PATTERN];
+  std::vector<uint32_t> m_Concat;   // words of the line, grown to the widest line
 
 };
 
@@ -0,0 +1,208 @@
+#ifndef __LINESINK_H__
+#define __LINESINK_H__
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+#include <fmt/core.h>
+#include "../utils.h"
+
+// lines per block, a block is written at once
+#define LINESINK_BLOCK_LINES (1 << 16)
+
+namespace comp
+{
+
+// Per-line output of the compressed size and the selected module (cluster) of each line.
+// The file is append-only, a header followed by blocks of up to LINESINK_BLOCK_LINES lines:
+//  header : magic "MPCL", uint32 version
+//  block  : uint32 number of lines, uint32 bytes of the size column, uint32 bytes of the id column,
+//           size column (LEB128 varints), id column (LEB128 varints of id + 1, 0 if none)
+// The columns are stored apart, so that a reader interested only in sizes skips the ids.
+class LineSink
+{
+public:
+  /*** constructors ***/
+  LineSink(std::string filePath)
+    : m_SizesLen(0), m_IDsLen(0), m_NumLines(0)
+  {
+    const bool isNew = !isFileExists(filePath);
+    if (!isNew)
+    {
+      // appended files must have been written by a sink
+      std::ifstream file(filePath, std::ios_base::in | std::ios_base::binary);
+      char magic[4] = { 0 };
+      uint32_t version = 0;
+      file.read(magic, 4);
+      file.read(reinterpret_cast<char*>(&version), sizeof(version));
+      if (std::memcmp(magic, MAGIC, 4) != 0 || version != VERSION)
+      {
+        std::cout << fmt::format("Not a per-line output file: \"{}\"", filePath) << std::endl;
+        exit(1);
+      }
+    }
+
+    m_File.open(filePath, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+    if (!m_File.is_open())
+    {
+      std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
+      exit(1);
+    }
+    if (isNew)
+    {
+      m_File.write(MAGIC, 4);
+      m_File.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    }
+
+    // a varint of 32 bits takes up to 5 bytes
+    m_Sizes.resize(LINESINK_BLOCK_LINES * 5);
+    m_IDs.resize(LINESINK_BLOCK_LINES * 5);
+  }
+  ~LineSink()
+  {
+    Flush();
+    m_File.close();
+  }
+
+  /*** methods ***/
+  void Append(unsigned compSize, int selected)
+  {
+    m_SizesLen += putVarint(m_Sizes.data() + m_SizesLen, compSize);
+    m_IDsLen += putVarint(m_IDs.data() + m_IDsLen, selected + 1);
+    if (++m_NumLines == LINESINK_BLOCK_LINES)
+      Flush();
+  }
+
+  // selected may be nullptr if the compressor does not select modules
+  void AppendBatch(const unsigned *compSizes, const int *selected, unsigned numLines)
+  {
+    for (unsigned i = 0; i < numLines; i++)
+      Append(compSizes[i], (selected == nullptr) ? -1 : selected[i]);
+  }
+
+  void Flush()
+  {
+    if (m_NumLines == 0)
+      return;
+
+    const uint32_t header[3] = { m_NumLines, m_SizesLen, m_IDsLen };
+    m_File.write(reinterpret_cast<const char*>(header), sizeof(header));
+    m_File.write(reinterpret_cast<const char*>(m_Sizes.data()), m_SizesLen);
+    m_File.write(reinterpret_cast<const char*>(m_IDs.data()), m_IDsLen);
+
+    m_SizesLen = 0;
+    m_IDsLen = 0;
+    m_NumLines = 0;
+  }
+
+private:
+  // returns the number of bytes written
+  static unsigned putVarint(uint8_t *buf, uint32_t value)
+  {
+    unsigned len = 0;
+    while (value >= 0x80)
+    {
+      buf[len++] = value | 0x80;
+      value >>= 7;
+    }
+    buf[len++] = value;
+    return len;
+  }
+
+public:
+  static constexpr char MAGIC[4] = { 'M', 'P', 'C', 'L' };
+  static constexpr uint32_t VERSION = 1;
+
+private:
+  std::ofstream m_File;
+  std::vector<uint8_t> m_Sizes;
+  std::vector<uint8_t> m_IDs;
+  uint32_t m_SizesLen;
+  uint32_t m_IDsLen;
+  uint32_t m_NumLines;
+};
+
+// Reader of the files written by LineSink, block by block.
+class LineSource
+{
+public:
+  /*** constructors ***/
+  LineSource(std::string filePath)
+    : m_NumLines(0), m_Line(0), m_SizePos(0), m_IDPos(0)
+  {
+    m_File.open(filePath, std::ios_base::in | std::ios_base::binary);
+    char magic[4] = { 0 };
+    uint32_t version = 0;
+    m_File.read(magic, 4);
+    m_File.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!m_File.is_open() || std::memcmp(magic, LineSink::MAGIC, 4) != 0 || version != LineSink::VERSION)
+    {
+      std::cout << fmt::format("Not a per-line output file: \"{}\"", filePath) << std::endl;
+      exit(1);
+    }
+  }
+
+  /*** methods ***/
+  // returns false at the end of the file
+  bool Next(unsigned &compSize, int &selected)
+  {
+    if (m_Line == m_NumLines && !readBlock())
+      return false;
+
+    compSize = getVarint(m_Sizes, m_SizePos);
+    selected = (int)getVarint(m_IDs, m_IDPos) - 1;
+    m_Line++;
+    return true;
+  }
+
+private:
+  bool readBlock()
+  {
+    uint32_t header[3];
+    if (!m_File.read(reinterpret_cast<char*>(header), sizeof(header)))
+      return false;
+
+    m_NumLines = header[0];
+    m_Sizes.resize(header[1]);
+    m_IDs.resize(header[2]);
+    m_File.read(reinterpret_cast<char*>(m_Sizes.data()), m_Sizes.size());
+    m_File.read(reinterpret_cast<char*>(m_IDs.data()), m_IDs.size());
+    if (!m_File)
+      return false;
+
+    m_Line = 0;
+    m_SizePos = 0;
+    m_IDPos = 0;
+    return m_NumLines != 0;
+  }
+
+  static uint32_t getVarint(const std::vector<uint8_t> &buf, size_t &pos)
+  {
+    uint32_t value = 0;
+    for (int shift = 0; pos < buf.size(); shift += 7)
+    {
+      uint8_t byte = buf[pos++];
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        break;
+    }
+    return value;
+  }
+
+private:
+  std::ifstream m_File;
+  std::vector<uint8_t> m_Sizes;
+  std::vector<uint8_t> m_IDs;
+  uint32_t m_NumLines;
+  uint32_t m_Line;
+  size_t m_SizePos;
+  size_t m_IDPos;
+};
+
+}
+
+#endif  // __LINESINK_H__
@@ -0,0 +1,149 @@
+#ifndef __MEMOCACHE_H__
+#define __MEMOCACHE_H__
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <fmt/core.h>
+#include "Compressor.h"
+#include "Dedup.h"
+#include "RecordWriter.h"
+
+// entries of a set
+#define MEMO_WAYS 4
+// lines longer than this are compressed without the cache
+#define MEMO_MAX_LINESIZE 64
+
+namespace comp
+{
+
+// Memoization of the compression of lines by their content.
+// A line is looked up by a 64-bit fingerprint of its bytes, confirmed by the bytes themselves,
+// in a set-associative table of a fixed number of entries with LRU replacement.
+// A hit replays the recorded update of the result instead of compressing the line again,
+// a miss compresses the line and records it, so the results are the same as without the cache.
+// Only memoizable compressors, whose result of a line depends on the line only, are cached.
+class MemoCache
+{
+  struct Entry
+  {
+    uint64_t Key;
+    uint64_t LastUsed;      // index + 1 of the last access, 0 if empty
+    unsigned LineSize;
+    LineRecord Record;
+  };
+
+public:
+  /*** constructors ***/
+  MemoCache(uint64_t numEntries)
+    : NumLookups(0), NumHits(0), NumBypassed(0)
+  {
+    // sets are a power of two
+    uint64_t numSets = 1;
+    while (numSets * 2 * MEMO_WAYS <= numEntries)
+      numSets *= 2;
+    m_Entries.resize(numSets * MEMO_WAYS);
+    m_Lines.resize(numSets * MEMO_WAYS * MEMO_MAX_LINESIZE);
+    m_Mask = numSets - 1;
+  }
+
+  /*** getters ***/
+  uint64_t GetNumEntries() { return m_Entries.size(); }
+  double GetHitRate() { return (NumLookups == 0) ? 0 : (double)NumHits / (double)NumLookups; }
+
+  /*** methods ***/
+  // compress the lines as compressor->CompressLines does, with the compressor memoizable
+  void CompressLines(Compressor *compressor, uint8_t *dataLines, unsigned numLines, unsigned lineSize,
+      unsigned *compSizes, int *selected = nullptr)
+  {
+    if (lineSize > MEMO_MAX_LINESIZE)
+    {
+      NumBypassed += numLines;
+      compressor->CompressLines(dataLines, numLines, lineSize, compSizes, selected);
+      return;
+    }
+
+    // sets are prefetched first, so that the misses overlap
+    m_Keys.resize(numLines);
+    for (unsigned i = 0; i < numLines; i++)
+    {
+      m_Keys[i] = DedupTable::Fingerprint(dataLines + i * lineSize, lineSize);
+      __builtin_prefetch(&m_Entries[(m_Keys[i] & m_Mask) * MEMO_WAYS]);
+    }
+
+    for (unsigned i = 0; i < numLines; i++)
+    {
+      const uint8_t *dataLine = dataLines + i * lineSize;
+      const uint64_t set = m_Keys[i] & m_Mask;
+      NumLookups++;
+
+      Entry *victim = nullptr;
+      Entry *hit = nullptr;
+      for (int w = 0; w < MEMO_WAYS; w++)
+      {
+        const uint64_t index = set * MEMO_WAYS + w;
+        Entry &entry = m_Entries[index];
+        if (entry.LastUsed != 0 && entry.Key == m_Keys[i] && entry.LineSize == lineSize
+            && std::memcmp(&m_Lines[index * MEMO_MAX_LINESIZE], dataLine, lineSize) == 0)
+        {
+          hit = &entry;
+          break;
+        }
+        if (victim == nullptr || entry.LastUsed < victim->LastUsed)
+          victim = &entry;
+      }
+
+      if (hit != nullptr)
+      {
+        NumHits++;
+        compressor->ReplayLine(lineSize, hit->Record);
+      }
+      else
+      {
+        hit = victim;
+        compressor->RecordLine(dataLine, lineSize, hit->Record);
+        hit->Key = m_Keys[i];
+        hit->LineSize = lineSize;
+        std::memcpy(&m_Lines[(hit - m_Entries.data()) * MEMO_MAX_LINESIZE], dataLine, lineSize);
+      }
+      hit->LastUsed = NumLookups;
+
+      compSizes[i] = hit->Record.CompSize;
+      if (selected != nullptr)
+        selected[i] = hit->Record.Selected;
+    }
+  }
+
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    writer.Header("workload,entries,lookups,hits,hit_rate,bypassed,");
+
+    writer.Field("workload", workloadName);
+    writer.Field("entries", GetNumEntries());
+    writer.Field("lookups", NumLookups);
+    writer.Field("hits", NumHits);
+    writer.Field("hit_rate", GetHitRate());
+    writer.Field("bypassed", NumBypassed);
+    writer.EndRow();
+  }
+
+  /*** member variables ***/
+  uint64_t NumLookups;
+  uint64_t NumHits;
+  uint64_t NumBypassed;       // lines longer than MEMO_MAX_LINESIZE
+
+private:
+  std::vector<Entry> m_Entries;
+  std::vector<uint8_t> m_Lines;     // bytes of each entry, MEMO_MAX_LINESIZE apart
+  std::vector<uint64_t> m_Keys;     // of the lines of a batch
+  uint64_t m_Mask;
+};
+
+}
+
+#endif  // __MEMOCACHE_H__
@@ -18,8 +18,9 @@ unsigned Pattern::CompressLine(std::vector<uint8_t> &dataLine)
     static_cast<PatternResult*>(m_Stat)->UpdateStat((int)PatternState::Zeros, lineSize);
   if (isRepeated(dataLine, 4))
     static_cast<PatternResult*>(m_Stat)->UpdateStat((int)PatternState::Repeat, lineSize);
-  if (isExistedBefore(dataLine))
-    static_cast<PatternResult*>(m_Stat)->UpdateStat((int)PatternState::TemporalLocality, lineSize);
+  DedupHits hits;
+  m_Dedup.Access(dataLine.data(), dataLine.size(), hits);
+  static_cast<PatternResult*>(m_Stat)->UpdateDedup(hits, dataLine.size());
   
   // base8-delta1
   // bestcase[32B / 64B] : (8+3)Bytes+4bits / (8+7)Bytes+8bits
@@ -106,15 +107,6 @@ bool Pattern::isRepeated(std::vector<uint8_t> &dataLine, const unsigned granular
   return true;
 }
 
-bool Pattern::isExistedBefore(std::vector<uint8_t> &dataLine)
-{
-  if (m_DataCache.exist(dataLine))
-    return true;
-  else
-    m_DataCache.put(dataLine, 0);
-  return false;
-}
-
 unsigned Pattern::checkPattern(std::vector<uint8_t> &dataLine,
     const unsigned baseSize, const unsigned deltaSize)
 {
@@ -8,7 +8,8 @@
 
 #include "Compressor.h"
 #include "CompResult.h"
-#include "LRU.h"
+#include "Dedup.h"
+#include "Entropy.h"
 
 namespace comp
 {
@@ -31,8 +32,10 @@ struct PatternResult : public CompResult
 {
   /*** constructors ***/
   PatternResult(unsigned lineSize)
-    : CompResult(lineSize), Total(0), Z(0), R(0), T(0), U(0),
-      ImplicitCounts(6, 0), ExplicitCounts(6, 0) {};
+    : CompResult(lineSize), Total(0), Z(0), R(0), T(0), U(0), WordDedup(0), ChunkDedup(0),
+      ImplicitCounts(6, 0), ExplicitCounts(6, 0),
+      SymbolCounts(NUM_BYTE_SYMBOLS, 0), SymbolCountsExceptAllZerosAllWordSame(NUM_BYTE_SYMBOLS, 0),
+      LineReuseBins(NUM_REUSE_BINS, 0), ChunkReuseBins(NUM_REUSE_BINS, 0) {};
 
   bool IsAllZeros(std::vector<uint8_t> &dataLine)
   {
@@ -93,136 +96,129 @@ struct PatternResult : public CompResult
     Total += LineSize;
   }
 
-  void UpdateCountMap(std::vector<uint8_t> &dataLine)
+  // count bytes found again in the window, and the reuse distances
+  void UpdateDedup(const DedupHits &hits, unsigned lineSize)
   {
-    for (auto it = dataLine.begin(); it != dataLine.end(); it++)
+    if (hits.LineDistance != 0)
     {
-      uint8_t &symbol = *it;
-      auto countIter = SymbolCounts.find(symbol);
-
-      if (countIter != SymbolCounts.end())
-        SymbolCounts[symbol]++;
-      else
-        SymbolCounts.insert(std::make_pair(symbol, 1));
-    }
-
-    if (!(IsAllZeros(dataLine) || IsAllWordSame(dataLine)))
-    {
-      for (auto it = dataLine.begin(); it != dataLine.end(); it++)
-      {
-        uint8_t &symbol = *it;
-        auto countIter = SymbolCountsExceptAllZerosAllWordSame.find(symbol);
-
-        if (countIter != SymbolCountsExceptAllZerosAllWordSame.end())
-          SymbolCountsExceptAllZerosAllWordSame[symbol]++;
-        else
-          SymbolCountsExceptAllZerosAllWordSame.insert(std::make_pair(symbol, 1));
-      }
+      T += lineSize;
+      LineReuseBins[DedupEngine::GetReuseBin(hits.LineDistance)]++;
     }
+    WordDedup += 4 * hits.WordHits;
+    ChunkDedup += 8 * hits.ChunkHits;
+    for (unsigned i = 0; i < hits.NumChunks; i++)
+      if (hits.ChunkDistances[i] != 0)
+        ChunkReuseBins[DedupEngine::GetReuseBin(hits.ChunkDistances[i])]++;
   }
 
-  double ComputeEntropy(std::map<uint8_t, uint64_t> &symbolCounts)
+  virtual CompResult* Clone() { return new PatternResult(*this); }
+
+  virtual void Merge(CompResult *other)
   {
-    uint64_t sum = 0;
-    for (auto it = symbolCounts.begin(); it != symbolCounts.end(); it++)
+    CompResult::Merge(other);
+
+    PatternResult *result = static_cast<PatternResult*>(other);
+    Z += result->Z;
+    R += result->R;
+    T += result->T;
+    U += result->U;
+    Total += result->Total;
+    WordDedup += result->WordDedup;
+    ChunkDedup += result->ChunkDedup;
+    for (int i = 0; i < NUM_REUSE_BINS; i++)
     {
-      uint64_t &counts = it->second;
-      sum += counts;
+      LineReuseBins[i] += result->LineReuseBins[i];
+      ChunkReuseBins[i] += result->ChunkReuseBins[i];
     }
-
-    std::map<uint8_t, double> SymbolProbs;
-    for (auto it = symbolCounts.begin(); it != symbolCounts.end(); it++)
+    for (int i = 0; i < 6; i++)
     {
-      const uint8_t &symbol = it->first;
-      uint64_t &counts = it->second;
-      double probability = (double)counts / (double)sum;
-
-      SymbolProbs.insert(std::make_pair(symbol, probability));
+      ImplicitCounts[i] += result->ImplicitCounts[i];
+      ExplicitCounts[i] += result->ExplicitCounts[i];
     }
-
-    // entropy = sum(-p * log2(p))
-    double entropy = 0;
-    for (auto it = SymbolProbs.begin(); it != SymbolProbs.end(); it++)
+    for (int i = 0; i < NUM_BYTE_SYMBOLS; i++)
     {
-      const uint8_t &symbol = it->first;
-      double &probability = it->second;
-
-      entropy += -probability * log2(probability);
+      SymbolCounts[i] += result->SymbolCounts[i];
+      SymbolCountsExceptAllZerosAllWordSame[i] += result->SymbolCountsExceptAllZerosAllWordSame[i];
     }
-
-    return entropy;
   }
 
-  virtual void Print(std::string workloadName = "", std::string filePath = "")
+  void UpdateCountMap(std::vector<uint8_t> &dataLine)
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")  // stdout
+    for (uint8_t symbol : dataLine)
+      SymbolCounts[symbol]++;
+
+    if (!(IsAllZeros(dataLine) || IsAllWordSame(dataLine)))
     {
-      buff = std::cout.rdbuf();
+      for (uint8_t symbol : dataLine)
+        SymbolCountsExceptAllZerosAllWordSame[symbol]++;
     }
-    else  // file
+  }
+
+  virtual void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    static const char *BD_NAMES[6] = { "b8d1", "b8d2", "b8d4", "b4d1", "b4d2", "b2d1" };
+
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
     {
-      // write column index description
-      if (!isFileExists(filePath))
-      {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << "Workload,";
-        file << "Entropy [b/B],";
-        file << "Entropy except AllZeros AllWordSame [b/B],";
-        file << "Zeros [B],";
-        file << "Repeated Line [B],";
-        file << "Temporal Locality [B],";
-        file << "B8D1-Implicit [B],B8D1-Explicit [B],";
-        file << "B8D2-Implicit [B],B8D2-Explicit [B],";
-        file << "B8D4-Implicit [B],B8D4-Explicit [B],";
-        file << "B4D1-Implicit [B],B4D1-Explicit [B],";
-        file << "B4D2-Implicit [B],B4D2-Explicit [B],";
-        file << "B2D1-Implicit [B],B2D1-Explicit [B],";
-        file << "Undefined [B],";
-        file << "Total Size [B],";
-        file << std::endl;
-        file.close();
-      }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
+      std::string header = "Workload,"
+          "Entropy [b/B],"
+          "Entropy except AllZeros AllWordSame [b/B],"
+          "Zeros [B],"
+          "Repeated Line [B],"
+          "Temporal Locality [B],"
+          "B8D1-Implicit [B],B8D1-Explicit [B],"
+          "B8D2-Implicit [B],B8D2-Explicit [B],"
+          "B8D4-Implicit [B],B8D4-Explicit [B],"
+          "B4D1-Implicit [B],B4D1-Explicit [B],"
+          "B4D2-Implicit [B],B4D2-Explicit [B],"
+          "B2D1-Implicit [B],B2D1-Explicit [B],"
+          "Undefined [B],"
+          "Total Size [B],"
+          "Word Dedup [B],Chunk Dedup [B],";
+      for (int i = 0; i < NUM_REUSE_BINS; i++)
+        header += fmt::format("Line Reuse <2^{},", i + 1);
+      for (int i = 0; i < NUM_REUSE_BINS; i++)
+        header += fmt::format("Chunk Reuse <2^{},", i + 1);
+      writer.Header(header);
     }
-    std::ostream stream(buff);
 
-    double entropy = ComputeEntropy(SymbolCounts);
-    double entropyExceptAllZerosAllWordSame = ComputeEntropy(SymbolCountsExceptAllZerosAllWordSame);
+    double entropy = ComputeEntropy(SymbolCounts.data(), NUM_BYTE_SYMBOLS);
+    double entropyExceptAllZerosAllWordSame = ComputeEntropy(SymbolCountsExceptAllZerosAllWordSame.data(), NUM_BYTE_SYMBOLS);
     // print result
-    // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{},", workloadName);
+    writer.Field("workload", workloadName);
     // entropy
-    stream << fmt::format("{},", entropy);
-    stream << fmt::format("{},", entropyExceptAllZerosAllWordSame);
+    writer.Field("entropy", entropy);
+    writer.Field("entropy_except_allzeros_allwordsame", entropyExceptAllZerosAllWordSame);
     // selection counts
-    stream << fmt::format("{},{},{},", Z, R, T);
+    writer.Field("zeros", Z);
+    writer.Field("repeated_line", R);
+    writer.Field("temporal_locality", T);
     for (int i = 0; i < 6; i++)
-      stream << fmt::format("{},{},", ImplicitCounts[i], ExplicitCounts[i]);
-    stream << fmt::format("{},", U);
-    stream << fmt::format("{},", Total);
-    stream << std::endl;
-
-    if (file.is_open())
-      file.close();
+    {
+      writer.Field(fmt::format("{}_implicit", BD_NAMES[i]), ImplicitCounts[i]);
+      writer.Field(fmt::format("{}_explicit", BD_NAMES[i]), ExplicitCounts[i]);
+    }
+    writer.Field("undefined", U);
+    writer.Field("total_size", Total);
+    writer.Field("word_dedup", WordDedup);
+    writer.Field("chunk_dedup", ChunkDedup);
+    writer.Array("line_reuse", LineReuseBins.data(), NUM_REUSE_BINS);
+    writer.Array("chunk_reuse", ChunkReuseBins.data(), NUM_REUSE_BINS);
+    writer.EndRow();
   }
 
   /*** member variables ***/
   std::vector<uint64_t> ImplicitCounts;
   std::vector<uint64_t> ExplicitCounts;
-  std::map<uint8_t, uint64_t> SymbolCounts;
-  std::map<uint8_t, uint64_t> SymbolCountsExceptAllZerosAllWordSame;
-  uint64_t Z, R, T, U;   // Zeros, Repeated, TemporalLocality, NotDefined
+  std::vector<uint64_t> SymbolCounts;     // dense, indexed by the byte
+  std::vector<uint64_t> SymbolCountsExceptAllZerosAllWordSame;
+  uint64_t Z, R, T, U;   // Zeros, Repeated, TemporalLocality (exact line), NotDefined
   uint64_t Total;
+  uint64_t WordDedup, ChunkDedup;
+  // reuse distances in lines, bin i counts distances in [2^i, 2^(i+1))
+  std::vector<uint64_t> LineReuseBins;
+  std::vector<uint64_t> ChunkReuseBins;
 };
 
 class Pattern : public Compressor
@@ -230,7 +226,6 @@ class Pattern : public Compressor
 public:
   /*** constructor ***/
   Pattern(unsigned lineSize)
-    : m_DataCache(CACHESIZE)
   {
     m_Stat = new PatternResult(lineSize);
     m_Stat->CompressorName = "Pattern Checker";
@@ -241,13 +236,12 @@ public:
 private:
   bool isZeros(std::vector<uint8_t>& dataLine);
   bool isRepeated(std::vector<uint8_t>& dataLine, const unsigned granularity);
-  bool isExistedBefore(std::vector<uint8_t>& dataLine);
   unsigned checkPattern(std::vector<uint8_t>& dataLine, const unsigned baseSize, const unsigned deltaSize);
   void countPattern(std::vector<uint8_t>& dataLine, PatternState pattern);
   uint64_t reduceSign(uint64_t x);
 
 public:
-  LRUCache<std::vector<uint8_t>, int, std::vector<uint8_t>> m_DataCache;
+  DedupEngine m_Dedup;
 
 };
 
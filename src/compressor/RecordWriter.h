@@ -0,0 +1,335 @@
+#ifndef __RECORDWRITER_H__
+#define __RECORDWRITER_H__
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include "../utils.h"
+
+namespace comp
+{
+
+// formats of the result files, selected by the extension of the file
+enum RecordFormat
+{
+  RECORD_CSV = 0,     // .csv, a header line (or more) and a line per row
+  RECORD_JSONL,       // .jsonl, an object per row, keyed by the field names
+  RECORD_COLUMNAR,    // .mpcr, blocks of rows stored by column
+};
+
+// Writer of the rows of a result file.
+// Rows are formatted into a single buffer, and the file is opened once to append the buffer
+// (after the CSV header if the file is new) when the writer is flushed or destroyed.
+// An empty path writes CSV rows to stdout, without the header.
+//
+// The columnar format is append-only, a header followed by a block per writer:
+//  header : magic "MPCR", uint32 version
+//  block  : uint32 number of rows, uint32 number of columns,
+//           each column: uint8 type, uint32 length of the name, name,
+//           then each column: 8 bytes per row (uint64, int64 or double),
+//           or per row a uint32 length and the bytes of a string
+// All the rows of a writer must have the same fields, which is the schema of its block.
+class RecordWriter
+{
+public:
+  enum Type : uint8_t
+  {
+    TYPE_UINT = 0,
+    TYPE_INT,
+    TYPE_DOUBLE,
+    TYPE_STRING,
+  };
+
+  /*** constructors ***/
+  RecordWriter(std::string filePath)
+    : m_FilePath(filePath), m_Format(GetFormat(filePath)),
+      m_IsNew(filePath != "" && !isFileExists(filePath)), m_NumRows(0), m_NumFields(0) {}
+  ~RecordWriter() { Flush(); }
+
+  /*** getters ***/
+  static RecordFormat GetFormat(const std::string &filePath)
+  {
+    if (strutil::ends_with(filePath, ".jsonl"))
+      return RECORD_JSONL;
+    if (strutil::ends_with(filePath, ".mpcr"))
+      return RECORD_COLUMNAR;
+    return RECORD_CSV;
+  }
+  static const char *GetExtension(RecordFormat format)
+  {
+    static const char *extensions[] = { "csv", "jsonl", "mpcr" };
+    return extensions[format];
+  }
+
+  // whether the file is created by this writer, the header is written only then
+  bool IsNew() { return m_IsNew; }
+
+  /*** methods ***/
+  // a line of the CSV header, ignored by the other formats
+  void Header(std::string_view line)
+  {
+    if (m_IsNew && m_Format == RECORD_CSV)
+    {
+      m_Header.append(line.data(), line.size());
+      m_Header.push_back('\n');
+    }
+  }
+
+  void Field(std::string_view name, std::string_view value)
+  {
+    switch (m_Format)
+    {
+      case RECORD_CSV:
+        append(value);
+        m_Buffer.push_back(',');
+        break;
+      case RECORD_JSONL:
+        jsonKey(name);
+        jsonString(value);
+        break;
+      case RECORD_COLUMNAR:
+        column(name, TYPE_STRING).Strings.emplace_back(value);
+        break;
+    }
+  }
+  void Field(std::string_view name, const std::string &value) { Field(name, std::string_view(value)); }
+  void Field(std::string_view name, const char *value) { Field(name, std::string_view(value)); }
+
+  void Field(std::string_view name, double value)
+  {
+    switch (m_Format)
+    {
+      case RECORD_CSV:
+        fmt::format_to(std::back_inserter(m_Buffer), "{},", value);
+        break;
+      case RECORD_JSONL:
+        jsonKey(name);
+        // JSON has no NaN or infinities
+        if (std::isfinite(value))
+          fmt::format_to(std::back_inserter(m_Buffer), "{}", value);
+        else
+          append("null");
+        break;
+      case RECORD_COLUMNAR:
+      {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        column(name, TYPE_DOUBLE).Values.push_back(bits);
+        break;
+      }
+    }
+  }
+
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value>::type Field(std::string_view name, T value)
+  {
+    switch (m_Format)
+    {
+      case RECORD_CSV:
+        fmt::format_to(std::back_inserter(m_Buffer), "{},", value);
+        break;
+      case RECORD_JSONL:
+        jsonKey(name);
+        fmt::format_to(std::back_inserter(m_Buffer), "{}", value);
+        break;
+      case RECORD_COLUMNAR:
+        column(name, std::is_signed<T>::value ? TYPE_INT : TYPE_UINT).Values.push_back((uint64_t)value);
+        break;
+    }
+  }
+
+  // n values of a field, as n CSV cells, a JSON list, or n columns named name_<i>
+  template <typename T>
+  void Array(std::string_view name, const T *values, unsigned n)
+  {
+    if (m_Format == RECORD_JSONL)
+    {
+      jsonKey(name);
+      m_Buffer.push_back('[');
+      for (unsigned i = 0; i < n; i++)
+      {
+        if (i != 0)
+          m_Buffer.push_back(',');
+        fmt::format_to(std::back_inserter(m_Buffer), "{}", values[i]);
+      }
+      m_Buffer.push_back(']');
+    }
+    else if (m_Format == RECORD_COLUMNAR)
+    {
+      for (unsigned i = 0; i < n; i++)
+        Field(fmt::format("{}_{}", name, i), values[i]);
+    }
+    else
+    {
+      for (unsigned i = 0; i < n; i++)
+        Field(name, values[i]);
+    }
+  }
+
+  void EndRow()
+  {
+    if (m_Format == RECORD_JSONL)
+      append("}\n");
+    else if (m_Format == RECORD_CSV)
+      m_Buffer.push_back('\n');
+    else if (m_NumRows != 0 && m_NumFields != m_Columns.size())
+      inconsistent();
+    m_NumRows++;
+    m_NumFields = 0;
+  }
+
+  // write the rows so far in a single call
+  void Flush()
+  {
+    if (m_Format == RECORD_COLUMNAR)
+      writeColumns();
+    if (m_Buffer.size() == 0 && m_Header.empty())
+      return;
+
+    if (m_FilePath == "")
+    {
+      std::cout.write(m_Buffer.data(), m_Buffer.size());
+      std::cout.flush();
+    }
+    else
+    {
+      std::ofstream file(m_FilePath, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+      if (!file.is_open())
+      {
+        std::cout << fmt::format("File is not open: \"{}\"", m_FilePath) << std::endl;
+        exit(1);
+      }
+      if (m_IsNew && m_Format == RECORD_COLUMNAR)
+      {
+        file.write(MAGIC, 4);
+        file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+      }
+      file.write(m_Header.data(), m_Header.size());
+      file.write(m_Buffer.data(), m_Buffer.size());
+    }
+
+    // the header is written once
+    m_IsNew = false;
+    m_Header.clear();
+    m_Buffer.clear();
+  }
+
+private:
+  struct Column
+  {
+    std::string Name;
+    Type ColumnType;
+    std::vector<uint64_t> Values;
+    std::vector<std::string> Strings;
+  };
+
+  void append(std::string_view str)
+  {
+    m_Buffer.append(str.data(), str.data() + str.size());
+  }
+
+  void jsonKey(std::string_view name)
+  {
+    m_Buffer.push_back((m_NumFields++ == 0) ? '{' : ',');
+    jsonString(name);
+    m_Buffer.push_back(':');
+  }
+
+  void jsonString(std::string_view value)
+  {
+    m_Buffer.push_back('"');
+    for (char c : value)
+    {
+      if (c == '"' || c == '\\')
+      {
+        m_Buffer.push_back('\\');
+        m_Buffer.push_back(c);
+      }
+      else if ((unsigned char)c < 0x20)
+        fmt::format_to(std::back_inserter(m_Buffer), "\\u{:04x}", (int)c);
+      else
+        m_Buffer.push_back(c);
+    }
+    m_Buffer.push_back('"');
+  }
+
+  // the column of the next field, created by the first row
+  Column &column(std::string_view name, Type type)
+  {
+    const unsigned index = m_NumFields++;
+    if (m_NumRows == 0)
+      m_Columns.push_back({ std::string(name), type, {}, {} });
+    else if (index >= m_Columns.size() || m_Columns[index].ColumnType != type || m_Columns[index].Name != name)
+      inconsistent();
+    return m_Columns[index];
+  }
+
+  void inconsistent()
+  {
+    std::cout << fmt::format("Rows of \"{}\" do not have the same fields.", m_FilePath) << std::endl;
+    exit(1);
+  }
+
+  void writeColumns()
+  {
+    if (m_NumRows == 0)
+      return;
+
+    auto put = [&](const void *data, size_t size) {
+      append(std::string_view(static_cast<const char*>(data), size));
+    };
+    const uint32_t header[2] = { (uint32_t)m_NumRows, (uint32_t)m_Columns.size() };
+    put(header, sizeof(header));
+    for (Column &col : m_Columns)
+    {
+      const uint32_t nameLen = col.Name.size();
+      put(&col.ColumnType, 1);
+      put(&nameLen, sizeof(nameLen));
+      put(col.Name.data(), nameLen);
+    }
+    for (Column &col : m_Columns)
+    {
+      if (col.ColumnType != TYPE_STRING)
+      {
+        put(col.Values.data(), col.Values.size() * sizeof(uint64_t));
+        continue;
+      }
+      for (std::string &str : col.Strings)
+      {
+        const uint32_t len = str.size();
+        put(&len, sizeof(len));
+        put(str.data(), len);
+      }
+    }
+
+    m_Columns.clear();
+    m_NumRows = 0;
+  }
+
+public:
+  static constexpr char MAGIC[4] = { 'M', 'P', 'C', 'R' };
+  static constexpr uint32_t VERSION = 1;
+
+private:
+  const std::string m_FilePath;
+  const RecordFormat m_Format;
+  bool m_IsNew;
+  std::string m_Header;
+  fmt::memory_buffer m_Buffer;
+  std::vector<Column> m_Columns;
+  uint64_t m_NumRows;
+  unsigned m_NumFields;
+};
+
+}
+
+#endif  // __RECORDWRITER_H__
@@ -0,0 +1,220 @@
+#ifndef __REGIONRESULT_H__
+#define __REGIONRESULT_H__
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <queue>
+#include <functional>
+#include <cstdint>
+#include <algorithm>
+
+#include <fmt/core.h>
+#include "../utils.h"
+#include "RecordWriter.h"
+
+// bins of the compressed size over the original size, the last one includes expanded lines
+#define NUM_REGION_BINS 8
+
+namespace comp
+{
+
+// Compression statistics per address region (e.g. a 4KB page).
+// Regions are kept in an open-addressing hash table of compact entries,
+// so that tens of millions of regions fit in memory.
+struct RegionResult
+{
+  // 48 bytes per region
+  struct Entry
+  {
+    uint64_t Region = EMPTY;  // address / region size, EMPTY if unused
+    uint64_t OriginalSize = 0;
+    uint64_t CompressedSize = 0;
+    uint32_t NumLines = 0;
+    // relative distribution of compressibility,
+    // all bins are halved when one saturates, which keeps the shape
+    uint16_t Bins[NUM_REGION_BINS] = { 0 };
+  };
+  static constexpr uint64_t EMPTY = ~0ULL;
+
+  /*** constructors ***/
+  RegionResult(uint64_t regionSize, unsigned numTop = 16)
+    : RegionSize(regionSize), NumTop(numTop), m_NumRegions(0)
+  {
+    if (regionSize == 0 || (regionSize & (regionSize - 1)) != 0)
+    {
+      printf("Invalid region size! %lu is not a power of 2.\n", regionSize);
+      exit(1);
+    }
+    m_RegionShift = __builtin_ctzll(regionSize);
+    m_Table.resize(1 << 16);
+  }
+
+  /*** methods ***/
+  void Update(uint64_t addr, unsigned uncompSize, unsigned compSize)
+  {
+    Entry &entry = find(addr >> m_RegionShift);
+    entry.OriginalSize += uncompSize;
+    entry.CompressedSize += compSize;
+    entry.NumLines++;
+
+    unsigned bin = std::min<uint64_t>((uint64_t)compSize * NUM_REGION_BINS / uncompSize, NUM_REGION_BINS - 1);
+    if (entry.Bins[bin] == UINT16_MAX)
+    {
+      for (int i = 0; i < NUM_REGION_BINS; i++)
+        entry.Bins[i] >>= 1;
+    }
+    entry.Bins[bin]++;
+  }
+
+  // print the NumTop best- and worst-compressing regions,
+  // and a row of all the regions together
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
+    {
+      std::string header = "workload,region_size,rank_type,rank,region_base,lines,original_size,compressed_size,compression_ratio,";
+      for (int i = 0; i < NUM_REGION_BINS; i++)
+        header += fmt::format("bin{},", i);
+      writer.Header(header);
+    }
+
+    auto printRow = [&](std::string rankType, uint64_t rank, uint64_t regionBase,
+        uint64_t numLines, uint64_t originalSize, uint64_t compressedSize, const uint64_t *bins) {
+      writer.Field("workload", workloadName);
+      writer.Field("region_size", RegionSize);
+      writer.Field("rank_type", rankType);
+      writer.Field("rank", rank);
+      writer.Field("region_base", fmt::format("0x{:x}", regionBase));
+      writer.Field("lines", numLines);
+      writer.Field("original_size", originalSize);
+      writer.Field("compressed_size", compressedSize);
+      writer.Field("compression_ratio", (double)originalSize / (double)compressedSize);
+      writer.Array("bin", bins, NUM_REGION_BINS);
+      writer.EndRow();
+    };
+    auto printEntry = [&](std::string rankType, uint64_t rank, const Entry &entry) {
+      uint64_t bins[NUM_REGION_BINS];
+      std::copy(entry.Bins, entry.Bins + NUM_REGION_BINS, bins);
+      printRow(rankType, rank, entry.Region << m_RegionShift,
+          entry.NumLines, entry.OriginalSize, entry.CompressedSize, bins);
+    };
+
+    // all regions, binned by their own compressibility, the rank is the number of regions
+    uint64_t numLines = 0, originalSize = 0, compressedSize = 0;
+    uint64_t bins[NUM_REGION_BINS] = { 0 };
+    for (const Entry &entry : m_Table)
+    {
+      if (entry.Region == EMPTY)
+        continue;
+      numLines += entry.NumLines;
+      originalSize += entry.OriginalSize;
+      compressedSize += entry.CompressedSize;
+      bins[std::min<uint64_t>(entry.CompressedSize * NUM_REGION_BINS / entry.OriginalSize, NUM_REGION_BINS - 1)]++;
+    }
+    printRow("all", m_NumRegions, 0, numLines, originalSize, compressedSize, bins);
+
+    // ratio ordered, ties are broken by the number of lines
+    auto isBetter = [](const Entry *lhs, const Entry *rhs) {
+      const double lhsRatio = (double)lhs->OriginalSize / (double)lhs->CompressedSize;
+      const double rhsRatio = (double)rhs->OriginalSize / (double)rhs->CompressedSize;
+      return (lhsRatio != rhsRatio) ? (lhsRatio > rhsRatio) : (lhs->NumLines > rhs->NumLines);
+    };
+    auto isWorse = [](const Entry *lhs, const Entry *rhs) {
+      const double lhsRatio = (double)lhs->OriginalSize / (double)lhs->CompressedSize;
+      const double rhsRatio = (double)rhs->OriginalSize / (double)rhs->CompressedSize;
+      return (lhsRatio != rhsRatio) ? (lhsRatio < rhsRatio) : (lhs->NumLines > rhs->NumLines);
+    };
+    printTop("best", isBetter, printEntry);
+    printTop("worst", isWorse, printEntry);
+  }
+
+private:
+  // entry of the region, inserted if not found
+  Entry &find(uint64_t region)
+  {
+    uint64_t mask = m_Table.size() - 1;
+    uint64_t idx = hash(region) & mask;
+    while (m_Table[idx].Region != region)
+    {
+      if (m_Table[idx].Region == EMPTY)
+      {
+        // keep the load factor under 0.75
+        if ((m_NumRegions + 1) * 4 > m_Table.size() * 3)
+        {
+          grow();
+          return find(region);
+        }
+        m_Table[idx] = Entry();
+        m_Table[idx].Region = region;
+        m_NumRegions++;
+        break;
+      }
+      idx = (idx + 1) & mask;
+    }
+    return m_Table[idx];
+  }
+
+  void grow()
+  {
+    std::vector<Entry> table(m_Table.size() * 2);
+    const uint64_t mask = table.size() - 1;
+    for (const Entry &entry : m_Table)
+    {
+      if (entry.Region == EMPTY)
+        continue;
+      uint64_t idx = hash(entry.Region) & mask;
+      while (table[idx].Region != EMPTY)
+        idx = (idx + 1) & mask;
+      table[idx] = entry;
+    }
+    m_Table.swap(table);
+  }
+
+  static uint64_t hash(uint64_t x)
+  {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  // print the NumTop first regions in the order of isFirst, with a bounded heap
+  template <typename Compare, typename Printer>
+  void printTop(std::string rankType, Compare isFirst, Printer &printEntry)
+  {
+    std::priority_queue<const Entry*, std::vector<const Entry*>, Compare> heap(isFirst);
+    for (const Entry &entry : m_Table)
+    {
+      if (entry.Region == EMPTY)
+        continue;
+      heap.push(&entry);
+      if (heap.size() > NumTop)
+        heap.pop();
+    }
+
+    std::vector<const Entry*> top;
+    while (!heap.empty())
+    {
+      top.push_back(heap.top());
+      heap.pop();
+    }
+    for (unsigned rank = 0; rank < top.size(); rank++)
+      printEntry(rankType, rank, *top[top.size() - 1 - rank]);
+  }
+
+public:
+  /*** member variables ***/
+  const uint64_t RegionSize;
+  const unsigned NumTop;
+
+private:
+  std::vector<Entry> m_Table;
+  uint64_t m_NumRegions;
+  unsigned m_RegionShift;
+};
+
+}
+
+#endif  // __REGIONRESULT_H__
@@ -3,7 +3,6 @@
 #include <sstream>
 #include <utility>
 
-#define HEAP_CAPACITY SC2_ENTRIES
 #define WORD_GRAN 4
 
 namespace comp
@@ -21,12 +20,13 @@ Node *createNode(int64_t symbol, uint64_t freq, Node *left, Node *right)
   return node;
 }
 
-MinHeap::MinHeap(std::map<int64_t, uint64_t> symbolMap)
+MinHeap::MinHeap(std::map<int64_t, uint64_t> symbolMap, int capacity)
 {
   this->heapSize = symbolMap.size();
-  assert (heapSize <= HEAP_CAPACITY);
+  this->capacity = capacity;
+  assert (heapSize <= capacity);
 
-  this->heapArr = new Node * [HEAP_CAPACITY];
+  this->heapArr = new Node * [capacity];
 
   for (auto it = symbolMap.begin(); it != symbolMap.end(); it++)
   {
@@ -101,7 +101,7 @@ Node* MinHeap::ExtractMin()
 
 int MinHeap::AddNode(int64_t symbol, uint64_t freq, Node *left, Node *right)
 {
-  assert (this->heapSize <= HEAP_CAPACITY);
+  assert (this->heapSize < this->capacity);
 
   this->heapArr[this->heapSize++] = createNode(symbol, freq, left, right);
 
@@ -291,7 +291,7 @@ unsigned SC2::CompressLine(std::vector<uint8_t> &dataLine)
   {
     // erase least freq symbols from the symFreqMap
     // The vector below is ordered by freq
-    if (mp_symFreqMap->size() > HEAP_CAPACITY)
+    if (mp_symFreqMap->size() > m_numEntries)
     {
       std::vector<std::pair<int64_t, uint64_t>> symFreqVec(mp_symFreqMap->begin(), mp_symFreqMap->end());
       std::sort(symFreqVec.begin(), symFreqVec.end(), huffman::cmp);
@@ -301,12 +301,12 @@ unsigned SC2::CompressLine(std::vector<uint8_t> &dataLine)
         uint64_t &freq = it->second;
 
         mp_symFreqMap->erase(symbol);
-        if (!(mp_symFreqMap->size() > HEAP_CAPACITY))
+        if (!(mp_symFreqMap->size() > m_numEntries))
           break;
       }
     }
 
-    huffman::MinHeap minHeap(*mp_symFreqMap);
+    huffman::MinHeap minHeap(*mp_symFreqMap, m_numEntries);
     minHeap = huffman::BuildHuffmanTree(minHeap);
     huffman::GetHuffmanCode(minHeap.GetRoot()[0], m_huffmanCodes);
     m_samplingCnt++;
@@ -333,7 +333,16 @@ unsigned SC2::CompressLine(std::vector<uint8_t> &dataLine)
   return compressedSize;
 }
 
-
-
+void SC2::parseConfig(const Json::Value &root)
+{
+  // entries of the code table, and lines sampled before the table is built
+  m_numEntries = root.get("entries", m_numEntries).asUInt();
+  m_maxSamplingCnt = root.get("warmup_lines", m_maxSamplingCnt).asUInt();
+  if (m_numEntries < 2)
+  {
+    printf("Invalid config! entries %u is less than 2.\n", m_numEntries);
+    exit(1);
+  }
+}
 
 }
@@ -35,7 +35,7 @@ class MinHeap
 {
 public:
   // constructor
-  MinHeap(std::map<int64_t, uint64_t> symbolMap);
+  MinHeap(std::map<int64_t, uint64_t> symbolMap, int capacity = SC2_ENTRIES);
 
   // methods
   int GetLeftChild(int i);
@@ -58,6 +58,7 @@ private:
 
 protected:
   int heapSize;
+  int capacity;
   Node **heapArr;
 
 };
@@ -92,21 +93,30 @@ class SC2 : public Compressor
 {
 public:
   /*** constructor ***/
-  SC2(unsigned lineSize, unsigned warmupCnt = 100000)
-    : m_samplingCnt(0), m_maxSamplingCnt(warmupCnt)
+  // the config may set the size of the code table and the sampled lines,
+  // e.g. { "entries": 4096, "warmup_lines": 1000000 }
+  SC2(unsigned lineSize, unsigned warmupCnt = 100000, const Json::Value &config = Json::Value())
+    : m_samplingCnt(0), m_maxSamplingCnt(warmupCnt), m_numEntries(SC2_ENTRIES)
   {
     m_Stat = new CompResult(lineSize);
     m_Stat->CompressorName = "SC2-Huffman";
 
+    if (!config.isNull())
+      parseConfig(config);
+
     mp_symFreqMap = new std::map<int64_t, uint64_t>;
   }
 
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine);
   void SetSamplingCnt(unsigned cnt);
 
+private:
+  void parseConfig(const Json::Value &root);
+
 private:
   unsigned m_samplingCnt;
   unsigned m_maxSamplingCnt;
+  unsigned m_numEntries;
 
   std::map<int64_t, uint64_t> *mp_symFreqMap;
   std::map<int64_t, std::string> m_huffmanCodes;
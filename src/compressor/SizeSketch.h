@@ -0,0 +1,126 @@
+#ifndef __SIZESKETCH_H__
+#define __SIZESKETCH_H__
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "../loader/Loader.h"
+
+// relative accuracy of the quantiles, a quantile is within 1% of the true size
+#define SKETCH_ACCURACY 0.01
+// sizes below this are indexed by a table instead of a log
+#define SKETCH_TABLE_SIZE 4096
+// a line fits in 1 to 4 sectors of an access, or in more
+#define NUM_SECTOR_BINS 4
+
+namespace comp
+{
+
+// Quantile sketch of compressed line sizes (DDSketch).
+// A size x > 0 is counted in the bucket ceil(log_gamma(x)), gamma = (1 + a) / (1 - a),
+// so that the value of a bucket is within a relative accuracy a of all the sizes it counts.
+// The buckets cover every unsigned size in a fixed array of about 1100 counters,
+// and two sketches merge exactly by adding their counters:
+// the sketch of shards merged is the sketch of all their lines.
+// Lines fitting in each number of sectors are counted exactly next to the buckets.
+class SizeSketch
+{
+public:
+  /*** constructors ***/
+  SizeSketch()
+    : Count(0), ZeroCount(0), SectorCounts{ 0 }, m_Buckets(getIndex(UINT32_MAX) + 1, 0) {}
+
+  /*** methods ***/
+  // compSize in bits
+  void Add(unsigned compSize)
+  {
+    Count++;
+    const unsigned numSectors = std::max(compSize / SECTOR_BITS + (compSize % SECTOR_BITS != 0), 1u);
+    SectorCounts[std::min(numSectors, (unsigned)NUM_SECTOR_BINS + 1) - 1]++;
+    if (compSize == 0)
+      ZeroCount++;
+    else
+      m_Buckets[getIndex(compSize)]++;
+  }
+
+  void AddBatch(const unsigned *compSizes, unsigned numLines)
+  {
+    for (unsigned i = 0; i < numLines; i++)
+      Add(compSizes[i]);
+  }
+
+  void Merge(const SizeSketch &other)
+  {
+    Count += other.Count;
+    ZeroCount += other.ZeroCount;
+    for (int i = 0; i <= NUM_SECTOR_BINS; i++)
+      SectorCounts[i] += other.SectorCounts[i];
+    for (size_t i = 0; i < m_Buckets.size(); i++)
+      m_Buckets[i] += other.m_Buckets[i];
+  }
+
+  // size in bits at quantile q of [0, 1], 0 if no line
+  double GetQuantile(double q)
+  {
+    if (Count == 0)
+      return 0;
+    uint64_t rank = (uint64_t)(q * (double)(Count - 1));
+    if (rank < ZeroCount)
+      return 0;
+    rank -= ZeroCount;
+    for (size_t i = 0; i < m_Buckets.size(); i++)
+    {
+      if (rank < m_Buckets[i])
+        return 2 * pow(getGamma(), (double)i) / (getGamma() + 1);
+      rank -= m_Buckets[i];
+    }
+    return UINT32_MAX;
+  }
+
+  // fraction of the lines that fit in numSectors sectors
+  double GetSectorFraction(unsigned numSectors)
+  {
+    if (Count == 0)
+      return 0;
+    uint64_t fitting = 0;
+    for (unsigned i = 0; i < numSectors && i <= NUM_SECTOR_BINS; i++)
+      fitting += SectorCounts[i];
+    return (double)fitting / (double)Count;
+  }
+
+private:
+  static double getGamma() { return (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY); }
+
+  static unsigned computeIndex(unsigned compSize)
+  {
+    return (unsigned)ceil(log((double)compSize) / log(getGamma()));
+  }
+
+  static unsigned getIndex(unsigned compSize)
+  {
+    static const std::vector<uint16_t> table = []() {
+      std::vector<uint16_t> indices(SKETCH_TABLE_SIZE, 0);
+      for (unsigned s = 1; s < SKETCH_TABLE_SIZE; s++)
+        indices[s] = computeIndex(s);
+      return indices;
+    }();
+    return (compSize < SKETCH_TABLE_SIZE) ? table[compSize] : computeIndex(compSize);
+  }
+
+public:
+  static constexpr unsigned SECTOR_BITS = ACCESS_GRAN * 8;
+
+  /*** member variables ***/
+  uint64_t Count;
+  uint64_t ZeroCount;
+  uint64_t SectorCounts[NUM_SECTOR_BINS + 1];   // lines of 1 to 4 sectors, then of more
+
+private:
+  std::vector<uint64_t> m_Buckets;
+};
+
+}
+
+#endif  // __SIZESKETCH_H__
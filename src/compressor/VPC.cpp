@@ -1,4 +1,5 @@
 #include <cmath>
+#include <algorithm>
 
 #include <json/json.h>
 #include "Compressor.h"
@@ -15,6 +16,7 @@
 #include "VPCmodules/ScanModule.h"
 #include "VPCmodules/XORModule.h"
 #include "VPCmodules/CompStruct.h"
+#include "../profiler.h"
 
 namespace comp
 {
@@ -24,6 +26,97 @@ unsigned VPC::CompressLine(std::vector<uint8_t> &dataLine)
   return (this->*compressLine)(dataLine);
 }
 
+void VPC::CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+    int *selected)
+{
+  // a line buffer reused over the batch
+  std::vector<uint8_t> dataLine(lineSize);
+  for (unsigned i = 0; i < numLines; i++)
+  {
+    std::copy(dataLines + i * lineSize, dataLines + (i + 1) * lineSize, dataLine.begin());
+    compSizes[i] = (this->*compressLine)(dataLine);
+    if (selected != nullptr)
+      selected[i] = m_LastModule;
+  }
+}
+
+void VPC::RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record)
+{
+  m_RecordedLine.assign(dataLine, dataLine + lineSize);
+  mb_LastResidue = false;
+  record.CompSize = (this->*compressLine)(m_RecordedLine);
+  record.Selected = m_LastModule;
+  // whether the residue stat is updated
+  record.Counts[0] = mb_LastResidue;
+  record.Residues[0] = mb_LastResidue ? m_LastResidues[0] : 0;
+  record.Residues[1] = mb_LastResidue ? m_LastResidues[1] : 0;
+}
+
+void VPC::ReplayLine(unsigned lineSize, const LineRecord &record)
+{
+  VPCResult *stat = static_cast<VPCResult*>(m_Stat);
+  stat->Update(BYTE * lineSize, record.CompSize, record.Selected);
+  if (record.Counts[0] != 0)
+    stat->UpdateResidueStat(record.Residues[0], record.Residues[1], record.Selected);
+}
+
+unsigned VPC::EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer)
+{
+  unsigned compressedSize = (this->*compressLine)(dataLine);
+
+  writer.Write(m_ModuleCodes[m_LastModule], m_EncodingBits[m_LastModule]);
+  switch (m_ModuleKinds[m_LastModule])
+  {
+    case UNCOMPRESSED:
+      writer.WriteBytes(dataLine.data(), m_LineSize);
+      break;
+    case ALLZERO:
+      break;
+    case ALLWORDSAME:
+      writer.WriteBytes(dataLine.data(), 4);
+      break;
+    case PREDCOMP:
+      m_CommonEncoder.EncodeLine(m_LastScanned, writer);
+      break;
+  }
+
+  return compressedSize;
+}
+
+bool VPC::DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine)
+{
+  dataLine.resize(m_LineSize);
+
+  int module = decodeModuleID(reader);
+  if (m_ModuleKinds.count(module) == 0)
+    return false;
+
+  switch (m_ModuleKinds[module])
+  {
+    case UNCOMPRESSED:
+      reader.ReadBytes(dataLine.data(), m_LineSize);
+      break;
+    case ALLZERO:
+      std::fill(dataLine.begin(), dataLine.end(), 0);
+      break;
+    case ALLWORDSAME:
+      reader.ReadBytes(dataLine.data(), 4);
+      for (int i = 4; i < m_LineSize; i++)
+        dataLine[i] = dataLine[i % 4];
+      break;
+    case PREDCOMP:
+    {
+      Binary scanned;
+      if (!m_CommonEncoder.DecodeLine(reader, scanned, m_LineSize * BYTE / SCANNED_SYMBOLSIZE))
+        return false;
+      static_cast<PredCompModule*>(m_CompModules[module])->DecompressLine(scanned, dataLine);
+      break;
+    }
+  }
+
+  return !reader.IsOverrun();
+}
+
 unsigned VPC::compressLineAllWordSame(std::vector<uint8_t> &dataLine)
 {
   // Check ALLZERO
@@ -175,7 +268,8 @@ void VPC::parseConfig(std::string &configPath)
         }
         else if (predModuleName == "ConsecutiveBasePredictor")
         {
-          predModule = new ConsecutiveBasePredictor(rootIndex, lineSize);
+          bool byteplane = predModuleSpec.get("Byteplane", true).asBool();
+          predModule = new ConsecutiveBasePredictor(rootIndex, lineSize, byteplane);
         }
         else
         {
@@ -329,16 +423,94 @@ void VPC::parseConfig(std::string &configPath)
 //  static_cast<VPCResult*>(m_Stat)->SetNumModules(m_NumModules);
 }
 
+void VPC::buildModuleCodes()
+{
+  // kinds of modules
+  m_ModuleKinds[-1] = UNCOMPRESSED;
+  bool isInvertible = (m_LineSize * BYTE) % SCANNED_SYMBOLSIZE == 0;
+  for (int i = 0; i < m_NumModules; i++)
+  {
+    if (dynamic_cast<AllZeroModule*>(m_CompModules[i]) != nullptr)
+      m_ModuleKinds[i] = ALLZERO;
+    else if (dynamic_cast<AllWordSameModule*>(m_CompModules[i]) != nullptr)
+      m_ModuleKinds[i] = ALLWORDSAME;
+    else
+    {
+      m_ModuleKinds[i] = PREDCOMP;
+      isInvertible &= static_cast<PredCompModule*>(m_CompModules[i])->IsInvertible();
+    }
+  }
+
+  // canonical code, assigned in order of (code length, module)
+  std::vector<std::pair<int, int>> lengths;
+  for (auto &encodingBits : m_EncodingBits)
+    lengths.push_back(std::make_pair(encodingBits.second, encodingBits.first));
+  std::sort(lengths.begin(), lengths.end());
+
+  const int maxLength = lengths.back().first;
+  bool isPrefixFree = (lengths.front().first >= 0 && maxLength <= 32);
+  m_CodeFirst.assign(maxLength + 1, 0);
+  m_CodeCount.assign(maxLength + 1, 0);
+  m_CodeOffset.assign(maxLength + 1, 0);
+  m_CodeModules.clear();
+
+  uint64_t code = 0;
+  int prevLength = lengths.front().first;
+  for (unsigned i = 0; i < lengths.size() && isPrefixFree; i++)
+  {
+    int length = lengths[i].first;
+    int module = lengths[i].second;
+    code <<= (length - prevLength);
+    prevLength = length;
+    // code lengths violate the Kraft inequality
+    if (code >= (1ULL << length))
+    {
+      isPrefixFree = false;
+      break;
+    }
+    if (m_CodeCount[length] == 0)
+    {
+      m_CodeFirst[length] = code;
+      m_CodeOffset[length] = m_CodeModules.size();
+    }
+    m_CodeCount[length]++;
+    m_CodeModules.push_back(module);
+    m_ModuleCodes[module] = code;
+    code++;
+  }
+
+  mb_Decodable = isInvertible && isPrefixFree;
+}
+
+int VPC::decodeModuleID(BitReader &reader)
+{
+  uint32_t code = 0;
+  for (unsigned length = 0; length < m_CodeCount.size(); length++)
+  {
+    if (length > 0)
+      code = (code << 1) | reader.Read(1);
+    if (m_CodeCount[length] != 0 && code >= m_CodeFirst[length] && code - m_CodeFirst[length] < m_CodeCount[length])
+      return m_CodeModules[m_CodeOffset[length] + code - m_CodeFirst[length]];
+  }
+  // invalid code
+  return -2;
+}
+
 unsigned VPC::checkAllZeros(const int chosenCompModule, bool &isAllZeros, std::vector<uint8_t> &dataLine)
 {
   isAllZeros = false;
   const unsigned uncompressedSize = dataLine.size() * BYTE;
   AllZeroModule *allZeroModule = static_cast<AllZeroModule*>(m_CompModules[chosenCompModule]);
-  unsigned compressedSize = allZeroModule->CompressLine(dataLine);
+  unsigned compressedSize;
+  {
+    PROFILE_SCOPE(ALLZERO);
+    compressedSize = allZeroModule->CompressLine(dataLine);
+  }
 
   if (compressedSize == 0) 
   {
     isAllZeros = true;
+    m_LastModule = chosenCompModule;
     compressedSize += m_EncodingBits[chosenCompModule];
     static_cast<VPCResult*>(m_Stat)->Update(uncompressedSize, compressedSize, chosenCompModule);
   }
@@ -351,11 +523,16 @@ unsigned VPC::checkAllWordSame(const int chosenCompModule, bool &isAllWordSame,
   isAllWordSame = false;
   const unsigned uncompressedSize = dataLine.size() * BYTE;
   AllWordSameModule *allWordSameModule = static_cast<AllWordSameModule*>(m_CompModules[1]);
-  unsigned compressedSize = allWordSameModule->CompressLine(dataLine);
+  unsigned compressedSize;
+  {
+    PROFILE_SCOPE(ALLWORDSAME);
+    compressedSize = allWordSameModule->CompressLine(dataLine);
+  }
 
   if (compressedSize == 4*BYTE)
   {
     isAllWordSame = true;
+    m_LastModule = chosenCompModule;
     compressedSize += m_EncodingBits[chosenCompModule];
     static_cast<VPCResult*>(m_Stat)->Update(uncompressedSize, compressedSize, chosenCompModule);
   }
@@ -373,6 +550,7 @@ unsigned VPC::checkOtherPatterns(const int numStartingModule, std::vector<uint8_
   Binary maxScanned;
   for (int i = numStartingModule; i < m_NumModules; i++)
   {
+    PROFILE_MODULE(i);
     PredCompModule *predCompModule = static_cast<PredCompModule*>(m_CompModules[i]);
     Binary scanned = predCompModule->CompressLine(dataLine, 0);
 
@@ -394,7 +572,12 @@ unsigned VPC::checkOtherPatterns(const int numStartingModule, std::vector<uint8_
     }
   }
 
-  int compressedSize = m_CommonEncoder.ProcessLine(maxScanned);
+  unsigned compressedSize;
+  {
+    PROFILE_MODULE(chosenCompModule);
+    PROFILE_SCOPE(FPC_ENCODE);
+    compressedSize = m_CommonEncoder.ProcessLine(maxScanned);
+  }
   if (compressedSize < uncompressedLineSize)
   {
     compressedLineSize = compressedSize;
@@ -405,11 +588,16 @@ unsigned VPC::checkOtherPatterns(const int numStartingModule, std::vector<uint8_
     compressedLineSize = uncompressedLineSize;
   }
   compressedLineSize += m_EncodingBits[chosenCompModule];
+  m_LastModule = chosenCompModule;
+  m_LastScanned = std::move(maxScanned);
 
   // update compression stat
   static_cast<VPCResult*>(m_Stat)->Update(uncompressedLineSize, compressedLineSize, chosenCompModule);
   // update residue stat
-  updateResidueStat(dataLine, chosenCompModule);
+  {
+    PROFILE_SCOPE(RESIDUE_STAT);
+    updateResidueStat(dataLine, chosenCompModule);
+  }
 
   return compressedLineSize;
 }
@@ -440,6 +628,9 @@ void VPC::updateResidueStat(std::vector<uint8_t> &dataLine, const int chosenComp
   }
 
   static_cast<VPCResult*>(m_Stat)->UpdateResidueStat(mae, mse, chosenCompModule);
+  mb_LastResidue = true;
+  m_LastResidues[0] = mae;
+  m_LastResidues[1] = mse;
 }
 
 }
@@ -75,139 +75,112 @@ struct VPCResult : public CompResult
     resultMSE = sumMSE / (double)numLines;
   }
 
-  virtual void Print(std::string workloadName = "", std::string filePath = "")
+  virtual CompResult* Clone() { return new VPCResult(*this); }
+
+  virtual void Merge(CompResult *other)
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")  // stdout
-    {
-      buff = std::cout.rdbuf();
-    }
-    else  // file
+    CompResult::Merge(other);
+
+    VPCResult *result = static_cast<VPCResult*>(other);
+    for (int i = -1; i < m_NumModules; i++)
     {
-      // write column index description
-      if (!isFileExists(filePath))
+      ClusterStat &clusterStat = m_ClusterStats[i];
+      ClusterStat &otherStat = result->m_ClusterStats[i];
+      clusterStat.count += otherStat.count;
+      clusterStat.originalSize += otherStat.originalSize;
+      clusterStat.compressedSize += otherStat.compressedSize;
+      if (clusterStat.compressedSize != 0)
+        clusterStat.compRatio = (double)clusterStat.originalSize / (double)clusterStat.compressedSize;
+      for (auto &bin : otherStat.compSizeHistogram)
+        clusterStat.compSizeHistogram[bin.first] += bin.second;
+
+      m_SumMAE[i] += result->m_SumMAE[i];
+      m_SumMSE[i] += result->m_SumMSE[i];
+      m_NumLines[i] += result->m_NumLines[i];
+      if (m_NumLines[i] != 0)
       {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << fmt::format("workload,total,,,");
-        for (int i = -1; i < m_NumModules; i++)
-        {
-          file << fmt::format("{},,,", i);
-        }
-        file << std::endl;
-
-        // second line
-        file << ",";
-        file << "original_size,compressed_size,compression_ratio,";
-        file << "count,";
-        for (int i = -1; i < m_NumModules; i++)
-        {
-          file << "original_size,compressed_size,compression_ratio,";
-        }
-        file << std::endl;
-        file.close();
+        m_MAE[i] = m_SumMAE[i] / (double)m_NumLines[i];
+        m_MSE[i] = m_SumMSE[i] / (double)m_NumLines[i];
       }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
     }
-    std::ostream stream(buff);
+  }
+
+  virtual void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
+    {
+      // first line
+      std::string header = "workload,total,,,";
+      for (int i = -1; i < m_NumModules; i++)
+        header += fmt::format("{},,,", i);
+      writer.Header(header);
+
+      // second line
+      header = ",original_size,compressed_size,compression_ratio,count,";
+      for (int i = -1; i < m_NumModules; i++)
+        header += "original_size,compressed_size,compression_ratio,";
+      writer.Header(header);
+    }
 
     // print result
     // workloadname, originalsize, compressedsize, compratio
-    stream << fmt::format("{0},{1},{2},{3},", workloadName, OriginalSize, CompressedSize, CompRatio);
+    writer.Field("workload", workloadName);
+    writer.Field("original_size", OriginalSize);
+    writer.Field("compressed_size", CompressedSize);
+    writer.Field("compression_ratio", CompRatio);
     for (int i = -1; i < m_NumModules; i++)
     {
       // originalsize, compressedsize, compratio by each module
       ClusterStat &clusterStat = m_ClusterStats[i];
-      stream << fmt::format("{0},{1},{2},", clusterStat.originalSize, clusterStat.compressedSize, clusterStat.compRatio);
+      writer.Field(fmt::format("module{}_original_size", i), clusterStat.originalSize);
+      writer.Field(fmt::format("module{}_compressed_size", i), clusterStat.compressedSize);
+      writer.Field(fmt::format("module{}_compression_ratio", i), clusterStat.compRatio);
     }
-    stream << std::endl;
-
-    if (file.is_open())
-      file.close();
+    writer.EndRow();
   }
 
   virtual void PrintDetail(std::string workloadName = "", std::string filePath = "")
   {
-    // select file or stdout
-    std::streambuf *buff;
-    std::ofstream file;
-    if (filePath == "")   // stdout
-    {
-      buff = std::cout.rdbuf();
-    }
-    else
+    RecordWriter writer(filePath);
+    if (writer.IsNew())
     {
-      // write column index description
-      if (!isFileExists(filePath))
-      {
-        file.open(filePath);
-        if (!file.is_open())
-        {
-          std::cout << fmt::format("File is not open: \"{}\"", filePath) << std::endl;
-          exit(1);
-        }
-        // first line
-        file << fmt::format("workload,");
-        for (int i = -1; i < m_NumModules; i++)
-        {
-          file << fmt::format("{},,",i);
-        }
-        for (int i = 0; i < m_NumModules; i++)
-        {
-          file << fmt::format("{},", i);
-          for (int j = 0; j < COMPSIZELIMIT-1; j++)
-          {
-            file << ",";
-          }
-        }
-        file << std::endl;
-
-        // second line
-        file << ",";
-        for (int i = -1; i < m_NumModules; i++)
-        {
-          file << fmt::format("mae,mse,");
-        }
-        for (int i = 0; i < m_NumModules; i++)
-        {
-          for (int j = 0; j < COMPSIZELIMIT; j++)
-          {
-            file << fmt::format("{},", j);
-          }
-        }
-        file << std::endl;
-        file.close();
-      }
-      file.open(filePath, std::ios_base::app);
-      buff = file.rdbuf();
+      // first line
+      std::string header = "workload,";
+      for (int i = -1; i < m_NumModules; i++)
+        header += fmt::format("{},,", i);
+      for (int i = 0; i < m_NumModules; i++)
+        header += fmt::format("{},", i) + std::string(COMPSIZELIMIT - 1, ',');
+      writer.Header(header);
+
+      // second line
+      header = ",";
+      for (int i = -1; i < m_NumModules; i++)
+        header += "mae,mse,";
+      for (int i = 0; i < m_NumModules; i++)
+        for (int j = 0; j < COMPSIZELIMIT; j++)
+          header += fmt::format("{},", j);
+      writer.Header(header);
     }
-    std::ostream stream(buff);
 
     // workloadname
-    stream << fmt::format("{0},", workloadName);
+    writer.Field("workload", workloadName);
     // mae, mse
     for (int i = -1; i < m_NumModules; i++)
     {
-      stream << fmt::format("{},{},", m_MAE[i], m_MSE[i]);
+      writer.Field(fmt::format("module{}_mae", i), m_MAE[i]);
+      writer.Field(fmt::format("module{}_mse", i), m_MSE[i]);
     }
     // histogram by each module
+    std::vector<uint64_t> histogram(COMPSIZELIMIT);
     for (int i = 0; i < m_NumModules; i++)
     {
       ClusterStat &clusterStat = m_ClusterStats[i];
       for (int j = 0; j < COMPSIZELIMIT; j++)
-      {
-        stream << fmt::format("{0},", clusterStat.compSizeHistogram[j]);
-      }
+        histogram[j] = clusterStat.compSizeHistogram[j];
+      writer.Array(fmt::format("module{}_sizes", i), histogram.data(), COMPSIZELIMIT);
     }
-    stream << std::endl;
+    writer.EndRow();
   }
 
   void SetNumModules(int numModules)
@@ -244,6 +217,7 @@ public:
   VPC(std::string configPath)
   {
     parseConfig(configPath);
+    buildModuleCodes();
     m_Stat = new VPCResult(m_LineSize, m_NumModules);
     m_Stat->CompressorName = "Contrastive Clustering Compressor";
   }
@@ -255,9 +229,19 @@ public:
 
   /*** methods ***/
   virtual unsigned CompressLine(std::vector<uint8_t> &dataLine);
+  virtual void CompressLines(uint8_t *dataLines, unsigned numLines, unsigned lineSize, unsigned *compSizes,
+      int *selected = nullptr);
+  virtual unsigned EncodeLine(std::vector<uint8_t> &dataLine, BitWriter &writer);
+  virtual bool DecodeLine(BitReader &reader, std::vector<uint8_t> &dataLine);
+  virtual bool IsDecodable() { return mb_Decodable; }
+  virtual bool IsMemoizable() { return true; }
+  virtual void RecordLine(const uint8_t *dataLine, unsigned lineSize, LineRecord &record);
+  virtual void ReplayLine(unsigned lineSize, const LineRecord &record);
 
 private :
   void parseConfig(std::string &configPath);
+  void buildModuleCodes();
+  int decodeModuleID(BitReader &reader);
   unsigned compressLineOnlyAllZero(std::vector<uint8_t> &dataLine);
   unsigned compressLineAllWordSame(std::vector<uint8_t> &dataLine);
 
@@ -278,6 +262,25 @@ private:
   FPCModule m_CommonEncoder;
   int m_NumModules;
   int m_NumClusters;
+
+  // module selected for the last line, and its scanned bits if it is a PredCompModule
+  int m_LastModule;
+  Binary m_LastScanned;
+  // residue stat of the last line, if its modules were compared
+  bool mb_LastResidue;
+  double m_LastResidues[2];
+  // line buffer of RecordLine
+  std::vector<uint8_t> m_RecordedLine;
+
+  // canonical prefix codes of the modules, built from m_EncodingBits
+  enum ModuleKind { UNCOMPRESSED, ALLZERO, ALLWORDSAME, PREDCOMP };
+  std::map<int, ModuleKind> m_ModuleKinds;
+  std::map<int, uint32_t> m_ModuleCodes;
+  std::vector<uint32_t> m_CodeFirst;      // indexed by code length
+  std::vector<uint32_t> m_CodeCount;
+  std::vector<int> m_CodeOffset;
+  std::vector<int> m_CodeModules;         // modules sorted by (code length, module)
+  bool mb_Decodable;
 };
 
 }
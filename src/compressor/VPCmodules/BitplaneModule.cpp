@@ -22,6 +22,20 @@ namespace comp
     return bitplane;
   }
 
+  Symbol BitplaneModule::RestoreLine(Binary &bitplane)
+  {
+    int lineSize = bitplane.GetColSize();
+
+    Symbol residueLine;
+    residueLine.SetSize(lineSize);
+    residueLine.SetRootIndex(bitplane.GetRootIndex());
+    for (int row = 0; row < BYTE; row++)
+      for (int i = 0; i < lineSize; i++)
+        residueLine[i] |= bitplane[row][i] << ((BYTE - 1) - row);
+
+    return residueLine;
+  }
+
   std::vector<uint8_t> BitplaneModule::convertToBitVector(uint8_t symbol)
   {
     std::vector<uint8_t> bitVector;
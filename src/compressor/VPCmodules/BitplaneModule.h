@@ -11,6 +11,8 @@ friend class PredCompModule;
 
 public:
   Binary ProcessLine(Symbol &residueLine);
+  // inverse of ProcessLine
+  Symbol RestoreLine(Binary &bitplane);
 
 private:
   std::vector<uint8_t> convertToBitVector(uint8_t symbol);
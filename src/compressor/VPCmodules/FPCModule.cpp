@@ -29,6 +29,13 @@ int FPCModule::ProcessLine(Binary &scanned)
       if (zrle == 0)
         zrle = 1;
       runLength++;
+      // a run is split every m_MaxRunLength rows, as EncodeLine does
+      if (runLength == m_MaxRunLength)
+      {
+        compressedSize += m_EncodingBitsSize[ZRLE];
+        zrle = 0;
+        runLength = 0;
+      }
     }
     else
     {
@@ -84,6 +91,136 @@ int FPCModule::ProcessLine(Binary &scanned)
   return compressedSize;
 }
 
+int FPCModule::EncodeLine(Binary &scanned, BitWriter &writer)
+{
+  const uint64_t startBits = writer.GetNumBits();
+  const int numRows = scanned.GetRowSize();
+
+  int numRow = 0;
+  while (numRow < numRows)
+  {
+    std::vector<uint8_t> &row = scanned[numRow];
+
+    // zero rows, a run longer than m_MaxRunLength is split
+    if (isRowZeros(row))
+    {
+      int runLength = 1;
+      while (numRow + runLength < numRows && runLength < m_MaxRunLength && isRowZeros(scanned[numRow + runLength]))
+        runLength++;
+
+      if (runLength > 1)
+      {
+        writer.Write(0b000, 3);
+        writer.Write(runLength - 1, 4);
+      }
+      else
+        writer.Write(0b0100, 4);
+      numRow += runLength;
+      continue;
+    }
+
+    // row as an integer, the first symbol at the MSB
+    uint32_t bits = 0;
+    for (int pos = 0; pos < SCANNED_SYMBOLSIZE; pos++)
+      bits = (bits << 1) | row[pos];
+
+    if (isRowSingleOne(row))
+    {
+      int position = 0;
+      while (row[position] != 0x01)
+        position++;
+      writer.Write(0b001, 3);
+      writer.Write(position, 4);
+    }
+    else if (isRowTwoConsecOnes(row))
+    {
+      int position = 0;
+      while (row[position] != 0x01)
+        position++;
+      writer.Write(0b0101, 4);
+      writer.Write(position, 4);
+    }
+    else if (isRowFrontHalfZeros(row))
+    {
+      writer.Write(0b0110, 4);
+      writer.Write(bits & 0xFF, 8);
+    }
+    else if (isRowBackHalfZeros(row))
+    {
+      writer.Write(0b0111, 4);
+      writer.Write(bits >> 8, 8);
+    }
+    else
+    {
+      writer.Write(0b1, 1);
+      writer.Write(bits, SCANNED_SYMBOLSIZE);
+    }
+    numRow++;
+  }
+
+  return writer.GetNumBits() - startBits;
+}
+
+bool FPCModule::DecodeLine(BitReader &reader, Binary &scanned, int numRows)
+{
+  scanned.SetSize(numRows, SCANNED_SYMBOLSIZE);
+
+  int numRow = 0;
+  while (numRow < numRows)
+  {
+    uint32_t bits = 0;
+    if (reader.Read(1) == 0b1)
+    {
+      // Uncompressible
+      bits = reader.Read(SCANNED_SYMBOLSIZE);
+    }
+    else if (reader.Read(1) == 0b0)
+    {
+      if (reader.Read(1) == 0b0)
+      {
+        // ZRLE
+        int runLength = reader.Read(4) + 1;
+        if (numRow + runLength > numRows)
+          return false;
+        numRow += runLength;
+        continue;
+      }
+      // SingleOne
+      bits = 1u << ((SCANNED_SYMBOLSIZE - 1) - reader.Read(4));
+    }
+    else
+    {
+      switch (reader.Read(2))
+      {
+        case 0b00:    // Zero
+          bits = 0;
+          break;
+        case 0b01:    // TwoConsecOnes
+        {
+          int position = reader.Read(4);
+          if (position == SCANNED_SYMBOLSIZE - 1)
+            return false;
+          bits = 0b11u << ((SCANNED_SYMBOLSIZE - 2) - position);
+          break;
+        }
+        case 0b10:    // FrontHalfZeros
+          bits = reader.Read(8);
+          break;
+        case 0b11:    // BackHalfZeros
+          bits = reader.Read(8) << 8;
+          break;
+      }
+    }
+
+    std::vector<uint8_t> &row = scanned[numRow];
+    for (int pos = 0; pos < SCANNED_SYMBOLSIZE; pos++)
+      row[pos] = (bits >> ((SCANNED_SYMBOLSIZE - 1) - pos)) & 0x1;
+    numRow++;
+  }
+
+  return !reader.IsOverrun();
+}
+
 bool FPCModule::isRowZeros(std::vector<uint8_t> &row)
 {
   for (int pos = 0; pos < SCANNED_SYMBOLSIZE; pos++)
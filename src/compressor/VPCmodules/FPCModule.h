@@ -5,6 +5,7 @@
 
 #include "PredCompModule.h"
 #include "CompStruct.h"
+#include "../BitStream.h"
 
 namespace comp
 {
@@ -35,6 +36,10 @@ public:
   void RemoveModule(int number);
 
   int ProcessLine(Binary &scanned);
+  // write the rows with the prefix codes of each pattern, returns the number of bits written
+  int EncodeLine(Binary &scanned, BitWriter &writer);
+  // read numRows rows, false if the stream is corrupted
+  bool DecodeLine(BitReader &reader, Binary &scanned, int numRows);
 
 private:
   bool isRowZeros(std::vector<uint8_t> &row);
@@ -53,6 +58,11 @@ private:
   // BackHalfZeros
   // Uncompressible
   const compSizeList m_EncodingBitsSize = { 7, 4, 7, 8, 12, 12, 17 };
+  // prefix codes of the patterns, sized to m_EncodingBitsSize with their payloads:
+  //  ZRLE 000 + run length - 1 (4b), Zero 0100, SingleOne 001 + position (4b),
+  //  TwoConsecOnes 0101 + position (4b), FrontHalfZeros 0110 + back half (8b),
+  //  BackHalfZeros 0111 + front half (8b), Uncompressible 1 + row (16b)
+  const int m_MaxRunLength = 16;
 };
 
 }
@@ -5,6 +5,7 @@
 #include "XORModule.h"
 #include "ScanModule.h"
 #include "FPCModule.h"
+#include "../../profiler.h"
 
 namespace comp
 {
@@ -12,19 +13,41 @@ Binary PredCompModule::CompressLine(std::vector<uint8_t> &dataLine, int nothing)
 {
   Symbol residue;
   Binary bitplane;
-  Binary bitplaneXOR;
   Binary scanned;
 //  int compressedSize;
 
+  // prediction and residue are profiled inside ResidueModule
   residue = mp_ResidueModule->ProcessLine(dataLine);
-  bitplane = mp_BitplaneModule->ProcessLine(residue);
-  bitplaneXOR = mp_XORModule->ProcessLine(bitplane);
-  scanned = mp_ScanModule->ProcessLine(bitplaneXOR);
+  {
+    PROFILE_SCOPE(BITPLANE);
+    bitplane = mp_BitplaneModule->ProcessLine(residue);
+  }
+  {
+    PROFILE_SCOPE(XOR);
+    mp_XORModule->ProcessLine(bitplane);
+  }
+  {
+    PROFILE_SCOPE(SCAN);
+    scanned = mp_ScanModule->ProcessLine(bitplane);
+  }
 //  compressedSize = mp_FPCModule->ProcessLine(scanned);
 
   return scanned;
 }
 
+void PredCompModule::DecompressLine(Binary &scanned, std::vector<uint8_t> &dataLine)
+{
+  Binary bitplane = mp_ScanModule->RestoreLine(scanned);
+  mp_XORModule->RestoreLine(bitplane);
+  Symbol residue = mp_BitplaneModule->RestoreLine(bitplane);
+  mp_ResidueModule->RestoreLine(residue, dataLine);
+}
+
+bool PredCompModule::IsInvertible()
+{
+  return mp_ResidueModule->IsInvertible() && mp_ScanModule->IsInvertible(m_LineSize);
+}
+
 double PredCompModule::GetMAE(std::vector<uint8_t> &dataLine)
 {
   return mp_ResidueModule->GetMAE(dataLine);
@@ -26,6 +26,9 @@ public:
   //  added a reserved argument, 'nothing'
   unsigned CompressLine(std::vector<uint8_t> &dataLine) { std::cout << "Not implemented." << std::endl; exit(1); }
   Binary CompressLine(std::vector<uint8_t> &dataLine, int nothing=0);
+  // inverse of CompressLine, from the scanned bits back to the line
+  void DecompressLine(Binary &scanned, std::vector<uint8_t> &dataLine);
+  bool IsInvertible();
 
   double GetMAE(std::vector<uint8_t> &dataLine);
   double GetMSE(std::vector<uint8_t> &dataLine);
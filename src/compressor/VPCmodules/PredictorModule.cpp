@@ -1,11 +1,178 @@
 #include <cmath>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define PREDICTOR_SSSE3
+#endif
 
 #include "PredictorModule.h"
+#include "../Compressor.h"
 
 namespace comp
 {
+#ifdef PREDICTOR_SSSE3
+// the line is predicted and subtracted 16 bytes at a time: the bases are gathered by a shuffle
+// per chunk of the line, shifted by each amount of the plan and blended, then offset and subtracted
+__attribute__((target("ssse3")))
+static void computeResiduesSSSE3(const uint8_t *line, int numChunks, const uint8_t *shuffles,
+    const int *shiftAmounts, const bool *isLeftShifts, const uint8_t *const *shiftMasks, int numShifts,
+    const uint8_t *offsets, uint8_t *residues)
+{
+  __m128i chunks[PREDICTOR_SIMD_SIZE / 16];
+  for (int k = 0; k < numChunks; k++)
+    chunks[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 16 * k));
+
+  for (int c = 0; c < numChunks; c++)
+  {
+    __m128i predicted = _mm_setzero_si128();
+    for (int k = 0; k < numChunks; k++)
+    {
+      const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffles + 16 * (c * numChunks + k)));
+      predicted = _mm_or_si128(predicted, _mm_shuffle_epi8(chunks[k], shuffle));
+    }
+
+    // shifts of 16-bit lanes, cleared of the bits crossing from the neighbor byte
+    for (int s = 0; s < numShifts; s++)
+    {
+      const __m128i count = _mm_cvtsi32_si128(shiftAmounts[s]);
+      __m128i shifted;
+      if (isLeftShifts[s])
+        shifted = _mm_and_si128(_mm_sll_epi16(predicted, count), _mm_set1_epi8((char)(0xff << shiftAmounts[s])));
+      else
+        shifted = _mm_and_si128(_mm_srl_epi16(predicted, count), _mm_set1_epi8((char)(0xff >> shiftAmounts[s])));
+      const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shiftMasks[s] + 16 * c));
+      predicted = _mm_or_si128(_mm_andnot_si128(mask, predicted), _mm_and_si128(mask, shifted));
+    }
+
+    predicted = _mm_add_epi8(predicted, _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + 16 * c)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(residues + 16 * c), _mm_sub_epi8(chunks[c], predicted));
+  }
+}
+#endif
+
+/*** PredictorModule ***/
+void PredictorModule::preparePlan(int lineSize)
+{
+  if (mb_FitsLine)
+    m_LineSize = lineSize;
+  if (m_PlanSize == m_LineSize)
+    return;
+
+  m_PlanSize = m_LineSize;
+  m_PlanBases.resize(m_LineSize);
+  for (int i = 0; i < m_LineSize; i++)
+    m_PlanBases[i] = i;
+  m_PlanLeftShifts.assign(m_LineSize, 0);
+  m_PlanRightShifts.assign(m_LineSize, 0);
+  m_PlanOffsets.assign(m_LineSize, 0);
+  buildPlan();
+  buildSimdPlan();
+}
+
+void PredictorModule::buildSimdPlan()
+{
+  mb_SimdPlan = false;
+  m_SimdShuffles.clear();
+  m_SimdShifts.clear();
+#ifdef PREDICTOR_SSSE3
+  static const bool hasSSSE3 = __builtin_cpu_supports("ssse3");
+  if (!hasSSSE3 || m_PlanSize == 0 || m_PlanSize % 16 != 0 || m_PlanSize > PREDICTOR_SIMD_SIZE)
+    return;
+  for (int i = 0; i < m_PlanSize; i++)
+    if (m_PlanBases[i] < 0 || m_PlanBases[i] >= m_PlanSize)
+      return;
+
+  // zeroing bytes have the high bit set
+  const int numChunks = m_PlanSize / 16;
+  m_SimdShuffles.assign(numChunks * numChunks * 16, 0x80);
+  for (int i = 0; i < m_PlanSize; i++)
+  {
+    const int c = i / 16;
+    const int k = m_PlanBases[i] / 16;
+    m_SimdShuffles[16 * (c * numChunks + k) + i % 16] = m_PlanBases[i] % 16;
+  }
+
+  // left shifts first, a byte shifted by BYTE or more is 0
+  for (bool isLeft : { true, false })
+  {
+    const std::vector<uint8_t> &amounts = isLeft ? m_PlanLeftShifts : m_PlanRightShifts;
+    for (int amount = 1; amount <= BYTE; amount++)
+    {
+      PlanShift shift = { amount, isLeft, std::vector<uint8_t>(m_PlanSize, 0) };
+      bool isUsed = false;
+      for (int i = 0; i < m_PlanSize; i++)
+      {
+        if (std::min<int>(amounts[i], BYTE) == amount)
+        {
+          shift.Masks[i] = 0xff;
+          isUsed = true;
+        }
+      }
+      if (isUsed)
+        m_SimdShifts.push_back(std::move(shift));
+    }
+  }
+  mb_SimdPlan = true;
+#endif
+}
+
+void PredictorModule::computeResiduesSimd(const uint8_t *line, uint8_t *residues)
+{
+#ifdef PREDICTOR_SSSE3
+  int shiftAmounts[2 * BYTE];
+  bool isLeftShifts[2 * BYTE];
+  const uint8_t *shiftMasks[2 * BYTE];
+  const int numShifts = m_SimdShifts.size();
+  for (int s = 0; s < numShifts; s++)
+  {
+    shiftAmounts[s] = m_SimdShifts[s].Amount;
+    isLeftShifts[s] = m_SimdShifts[s].IsLeft;
+    shiftMasks[s] = m_SimdShifts[s].Masks.data();
+  }
+  computeResiduesSSSE3(line, m_PlanSize / 16, m_SimdShuffles.data(), shiftAmounts, isLeftShifts, shiftMasks,
+      numShifts, m_PlanOffsets.data(), residues);
+#endif
+}
+
+Symbol PredictorModule::PredictLine(std::vector<uint8_t> &cacheLine)
+{
+  const int lineSize = ComputeResidues(cacheLine, m_Predicted);
+
+  // the prediction is the line less its residues
+  Symbol predictedLine;
+  predictedLine.SetSize(lineSize);
+  predictedLine.SetRootIndex(m_RootIndex);
+  for (int i = 0; i < lineSize; i++)
+    predictedLine[i] = cacheLine[i] - m_Predicted[i];
+  return predictedLine;
+}
+
+int PredictorModule::ComputeResidues(std::vector<uint8_t> &cacheLine, std::vector<uint8_t> &residues)
+{
+  preparePlan(cacheLine.size());
+  residues.resize(m_PlanSize);
+  if (mb_SimdPlan)
+  {
+    computeResiduesSimd(cacheLine.data(), residues.data());
+    return m_PlanSize;
+  }
+
+  const uint8_t *line = cacheLine.data();
+  const int *bases = m_PlanBases.data();
+  const uint8_t *leftShifts = m_PlanLeftShifts.data();
+  const uint8_t *rightShifts = m_PlanRightShifts.data();
+  const uint8_t *offsets = m_PlanOffsets.data();
+  uint8_t *out = residues.data();
+  for (int i = 0; i < m_PlanSize; i++)
+  {
+    const uint8_t predicted = (uint8_t)((uint8_t)(line[bases[i]] << leftShifts[i]) >> rightShifts[i]) + offsets[i];
+    out[i] = line[i] - predicted;
+  }
+  return m_PlanSize;
+}
+
 /*** WeightBasePredictor ***/
 WeightBasePredictor::WeightBasePredictor(int rootIndex, int lineSize,
     std::vector<int> baseIndexTable, std::vector<float> weightTable)
@@ -34,37 +201,28 @@ WeightBasePredictor::WeightBasePredictor(int rootIndex, int lineSize,
   }
 }
 
-Symbol WeightBasePredictor::PredictLine(std::vector<uint8_t> &cacheLine)
+void WeightBasePredictor::buildPlan()
 {
-  Symbol predictedLine;
-  uint8_t root, predicted;
-
-  predictedLine.SetSize(m_LineSize);
-  predictedLine.SetRootIndex(m_RootIndex);
-
   for (int i = 0; i < m_LineSize; i++)
   {
     if (i == m_RootIndex)
-    {
-      root = cacheLine[i];
-
-      predictedLine[i] = root;
-    }
+      continue;
+    int shiftDistance = m_ShiftDistanceTable[i];
+    m_PlanBases[i] = m_Table.BaseIndexTable[i];
+    if (shiftDistance < 0)
+      m_PlanRightShifts[i] = abs(shiftDistance);
     else
-    {
-      int baseIndex = m_Table.BaseIndexTable[i];
-
-      uint8_t base = cacheLine[baseIndex];
-      int shiftDistance = m_ShiftDistanceTable[i];
-      if (shiftDistance < 0)
-        predicted = base >> abs(shiftDistance);
-      else
-        predicted = base << shiftDistance;
-
-      predictedLine[i] = predicted;
-    }
+      m_PlanLeftShifts[i] = shiftDistance;
   }
-  return predictedLine;
+}
+
+uint8_t WeightBasePredictor::PredictByte(int i, uint8_t base)
+{
+  int shiftDistance = m_ShiftDistanceTable[i];
+  if (shiftDistance < 0)
+    return base >> abs(shiftDistance);
+  else
+    return base << shiftDistance;
 }
 
 /*** DiffBasePredictor ***/
@@ -79,68 +237,30 @@ DiffBasePredictor::DiffBasePredictor(int rootIndex, int lineSize,
   m_Table.DiffTable = diffTable;
 }
 
-Symbol DiffBasePredictor::PredictLine(std::vector<uint8_t> &cacheLine)
+void DiffBasePredictor::buildPlan()
 {
-  Symbol predictedLine;
-  uint8_t root, predicted;
-
-  predictedLine.SetSize(m_LineSize);
-  predictedLine.SetRootIndex(m_RootIndex);
-
   for (int i = 0; i < m_LineSize; i++)
   {
     if (i == m_RootIndex)
-    {
-      root = cacheLine[i];
-
-      predictedLine[i] = root;
-    }
-    else
-    {
-      int diff = m_Table.DiffTable[i];
-      int baseIndex = m_Table.BaseIndexTable[i];
-
-      uint8_t base = cacheLine[baseIndex];
-      predicted = (uint8_t)diff + base;
-
-      predictedLine[i] = predicted;
-    }
+      continue;
+    m_PlanBases[i] = m_Table.BaseIndexTable[i];
+    m_PlanOffsets[i] = (uint8_t)m_Table.DiffTable[i];
   }
-  return predictedLine;
 }
 
 /*** OneBasePredictor ***/
-Symbol OneBasePredictor::PredictLine(std::vector<uint8_t> &cacheLine)
+void OneBasePredictor::buildPlan()
 {
-  m_LineSize = cacheLine.size();
-
-  Symbol predictedLine;
-  uint8_t root, predicted;
-
-  predictedLine.SetSize(m_LineSize);
-  predictedLine.SetRootIndex(m_RootIndex);
-
-  for (int i = 0; i < m_LineSize; i++)
-  {
-    root = cacheLine[m_RootIndex];
-  
-    predictedLine[i] = root;
-  }
-  return predictedLine;
+  std::fill(m_PlanBases.begin(), m_PlanBases.end(), m_RootIndex);
 }
 
 /*** ConsecutiveBasePredictor ***/
-Symbol ConsecutiveBasePredictor::PredictLine(std::vector<uint8_t> &cacheLine)
+void ConsecutiveBasePredictor::buildPlan()
 {
-  m_LineSize = cacheLine.size();
-
-  Symbol predictedLine;
-  uint8_t root, predicted;
-
-  predictedLine.SetSize(m_LineSize);
-  predictedLine.SetRootIndex(m_RootIndex);
-
-  std::vector<uint8_t> inputLine = cacheLine;
+  // the input line, in byteplane order if enabled
+  std::vector<int> inputIndex(m_LineSize);
+  for (int i = 0; i < m_LineSize; i++)
+    inputIndex[i] = i;
   if (mb_Byteplane)
   {
     int idx = 0;
@@ -148,30 +268,42 @@ Symbol ConsecutiveBasePredictor::PredictLine(std::vector<uint8_t> &cacheLine)
     {
       for (int i = plane; i < m_LineSize; i += 4)
       {
-        inputLine[idx] = cacheLine[i];
+        inputIndex[idx] = i;
         idx++;
       }
     }
   }
 
+  // byte i is predicted from byte i - 1 of the input line, the root from itself,
+  // and byte 0, with no previous byte, from the root
   for (int i = 0; i < m_LineSize; i++)
   {
-    if (i == m_RootIndex)
-    {
-      root = inputLine[i];
-
-      predictedLine[i] = root;
-    }
+    if (i == m_RootIndex || i == 0)
+      m_PlanBases[i] = inputIndex[m_RootIndex];
     else
-    {
-      predicted = inputLine[i - 1];
+      m_PlanBases[i] = inputIndex[i - 1];
+  }
+}
 
-      predictedLine[i] = predicted;
+int ConsecutiveBasePredictor::GetBaseIndex(int i)
+{
+  // byte i is predicted from the previous byte in the (byteplane-ordered) input line,
+  // and byte 0 from the root, as in buildPlan
+  const int prev = (i == 0) ? m_RootIndex : i - 1;
+  if (!mb_Byteplane)
+    return prev;
+
+  int idx = 0;
+  for (int plane = 3; plane >= 0; plane--)
+  {
+    for (int j = plane; j < m_LineSize; j += 4)
+    {
+      if (idx == prev)
+        return j;
+      idx++;
     }
   }
-  return predictedLine;
+  return -1;
 }
 
-
 }
-
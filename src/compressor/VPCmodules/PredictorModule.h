@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
+
 #include "ResidueModule.h"
 
+// lines up to this size, in whole chunks of 16 bytes, are predicted by byte shuffles (SSSE3)
+#define PREDICTOR_SIMD_SIZE 64
+
 namespace comp
 {
 
@@ -11,14 +16,60 @@ class PredictorModule
 friend class ResidueModule;
 
 public:
-  PredictorModule(int rootIndex, int lineSize)
-    : m_RootIndex(rootIndex), m_LineSize(lineSize) {}
-  
-  virtual Symbol PredictLine(std::vector<uint8_t> &cacheLine) = 0;
+  PredictorModule(int rootIndex, int lineSize, bool fitsLine = false)
+    : m_RootIndex(rootIndex), m_LineSize(lineSize), mb_FitsLine(fitsLine), m_PlanSize(0), mb_SimdPlan(false) {}
+
+  Symbol PredictLine(std::vector<uint8_t> &cacheLine);
+  // Predict the line and subtract the prediction in a single pass:
+  // residues[i] = cacheLine[i] - predicted byte i, the root included, in the order of the line.
+  // Returns the number of bytes predicted, the line size of the predictor.
+  int ComputeResidues(std::vector<uint8_t> &cacheLine, std::vector<uint8_t> &residues);
+
+  // byte i (not the root) is predicted from the byte at GetBaseIndex(i),
+  // these are used to restore a line from its residues
+  virtual int GetBaseIndex(int i) = 0;
+  virtual uint8_t PredictByte(int i, uint8_t base) = 0;
+
+protected:
+  // fill the plan of a line of m_LineSize bytes, sized and reset to plain copies of byte i
+  virtual void buildPlan() = 0;
+
+private:
+  // bytes of the plan shifted by the same amount, to be shifted at once
+  struct PlanShift
+  {
+    int Amount;                   // at most BYTE
+    bool IsLeft;
+    std::vector<uint8_t> Masks;   // 0xff for the bytes shifted, per byte of the line
+  };
+
+  void preparePlan(int lineSize);
+  void buildSimdPlan();
+  void computeResiduesSimd(const uint8_t *line, uint8_t *residues);
 
 protected:
   int m_RootIndex;
   int m_LineSize;
+  bool mb_FitsLine;       // the line size follows each line, instead of the config
+
+  // The prediction compiled by buildPlan, the same for every line:
+  // byte i is predicted from byte m_PlanBases[i], shifted left by m_PlanLeftShifts[i],
+  // then right by m_PlanRightShifts[i], plus m_PlanOffsets[i].
+  // Every byte is predicted the same way, without a branch on the kind of the predictor.
+  int m_PlanSize;
+  std::vector<int> m_PlanBases;
+  std::vector<uint8_t> m_PlanLeftShifts;
+  std::vector<uint8_t> m_PlanRightShifts;
+  std::vector<uint8_t> m_PlanOffsets;
+  std::vector<uint8_t> m_Predicted;     // buffer of PredictLine
+
+private:
+  // the plan as byte shuffles, if the line fits and the CPU has SSSE3:
+  // chunk c of the prediction gathers from chunk k of the line by the shuffle (c, k),
+  // whose bytes not based in chunk k are zeroed
+  bool mb_SimdPlan;
+  std::vector<uint8_t> m_SimdShuffles;
+  std::vector<PlanShift> m_SimdShifts;
 };
 
 /*** inherited classes ***/
@@ -38,7 +89,11 @@ public:
   WeightBasePredictor(int rootIndex, int lineSize,
       std::vector<int> baseIndexTable, std::vector<float> weightTable);
   
-  Symbol PredictLine(std::vector<uint8_t> &cacheLine);
+  int GetBaseIndex(int i) { return m_Table.BaseIndexTable[i]; }
+  uint8_t PredictByte(int i, uint8_t base);
+
+protected:
+  void buildPlan();
 
 private:
   WeightBaseTable m_Table;
@@ -61,7 +116,11 @@ public:
   DiffBasePredictor(int rootIndex, int lineSize,
       std::vector<int> baseIndexTable, std::vector<int> diffTable);
 
-  Symbol PredictLine(std::vector<uint8_t> &cacheLine);
+  int GetBaseIndex(int i) { return m_Table.BaseIndexTable[i]; }
+  uint8_t PredictByte(int i, uint8_t base) { return (uint8_t)m_Table.DiffTable[i] + base; }
+
+protected:
+  void buildPlan();
 
 private:
   DiffBaseTable m_Table;
@@ -72,9 +131,13 @@ class OneBasePredictor : public PredictorModule
 {
 public:
   OneBasePredictor(int rootIndex, int lineSize)
-    : PredictorModule(rootIndex, lineSize) {}
+    : PredictorModule(rootIndex, lineSize, true) {}
 
-  Symbol PredictLine(std::vector<uint8_t> &cacheLine);
+  int GetBaseIndex(int i) { return m_RootIndex; }
+  uint8_t PredictByte(int i, uint8_t base) { return base; }
+
+protected:
+  void buildPlan();
 };
 
 // Consecutive Base Predictor
@@ -82,9 +145,13 @@ class ConsecutiveBasePredictor : public PredictorModule
 {
 public:
   ConsecutiveBasePredictor(int rootIndex, int lineSize, bool byteplane=true)
-    : PredictorModule(rootIndex, lineSize), mb_Byteplane(byteplane) {}
+    : PredictorModule(rootIndex, lineSize, true), mb_Byteplane(byteplane) {}
 
-  Symbol PredictLine(std::vector<uint8_t> &cacheLine);
+  int GetBaseIndex(int i);
+  uint8_t PredictByte(int i, uint8_t base) { return base; }
+
+protected:
+  void buildPlan();
 
 private:
   bool mb_Byteplane;
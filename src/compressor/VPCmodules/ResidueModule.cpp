@@ -2,22 +2,28 @@
 
 #include "PredictorModule.h"
 #include "ResidueModule.h"
+#include "../../profiler.h"
 
 namespace comp
 {
 
 ResidueModule::ResidueModule(PredictorModule *predModule)
-  : m_RootIndex(predModule->m_RootIndex), mp_PredictorModule(predModule) {}
+  : m_RootIndex(predModule->m_RootIndex), mp_PredictorModule(predModule) { buildRestoreOrder(); }
 
 Symbol ResidueModule::ProcessLine(std::vector<uint8_t> &cacheLine)
 {
-  Symbol predictedLine;
   Symbol residueLine;
-  uint8_t root, residue;
+  uint8_t root;
+  int lineSize;
 
-  predictedLine = mp_PredictorModule->PredictLine(cacheLine);
+  // prediction and subtraction are fused
+  {
+    PROFILE_SCOPE(PREDICTION);
+    lineSize = mp_PredictorModule->ComputeResidues(cacheLine, m_Residues);
+  }
 
-  residueLine.SetSize(predictedLine.GetCachelineSize());
+  PROFILE_SCOPE(RESIDUE);
+  residueLine.SetSize(lineSize);
   residueLine.SetRootIndex(m_RootIndex);
 
   // make residues
@@ -25,31 +31,70 @@ Symbol ResidueModule::ProcessLine(std::vector<uint8_t> &cacheLine)
   root = cacheLine[m_RootIndex];
   residueLine[0] = root;
   int j = 1;
-  for (int i = 0; i < predictedLine.GetCachelineSize(); i++)
+  for (int i = 0; i < lineSize; i++)
   {
     if (i == m_RootIndex)
       continue;
-    else
-    {
-      residue = cacheLine[i] - predictedLine[i];
-      residueLine[j] = residue;
-      j++;
-    }
+    residueLine[j] = m_Residues[i];
+    j++;
   }
 
   return residueLine;
 }
 
+void ResidueModule::RestoreLine(Symbol &residueLine, std::vector<uint8_t> &cacheLine)
+{
+  cacheLine[m_RootIndex] = residueLine[0];
+  for (int i : m_RestoreOrder)
+    cacheLine[i] = residueLine[m_ResidueIndex[i]]
+      + mp_PredictorModule->PredictByte(i, cacheLine[m_BaseIndex[i]]);
+}
+
+void ResidueModule::buildRestoreOrder()
+{
+  const int lineSize = mp_PredictorModule->m_LineSize;
+
+  // residues of non-root bytes are placed in order after the root
+  m_ResidueIndex.assign(lineSize, 0);
+  m_BaseIndex.assign(lineSize, -1);
+  int j = 1;
+  for (int i = 0; i < lineSize; i++)
+  {
+    if (i == m_RootIndex)
+      continue;
+    m_ResidueIndex[i] = j++;
+    m_BaseIndex[i] = mp_PredictorModule->GetBaseIndex(i);
+  }
+
+  // a byte is restored once its base is restored
+  std::vector<bool> isRestored(lineSize, false);
+  isRestored[m_RootIndex] = true;
+  m_RestoreOrder.clear();
+  bool progress = true;
+  while (progress)
+  {
+    progress = false;
+    for (int i = 0; i < lineSize; i++)
+    {
+      int base = m_BaseIndex[i];
+      if (isRestored[i] || base < 0 || base >= lineSize || !isRestored[base])
+        continue;
+      isRestored[i] = true;
+      m_RestoreOrder.push_back(i);
+      progress = true;
+    }
+  }
+  mb_Invertible = ((int)m_RestoreOrder.size() == lineSize - 1);
+}
+
 double ResidueModule::GetMAE(std::vector<uint8_t> &dataLine)
 {
-  Symbol predictedLine;
-  predictedLine = mp_PredictorModule->PredictLine(dataLine);
-  const int lineSize = predictedLine.GetCachelineSize();
+  const int lineSize = mp_PredictorModule->ComputeResidues(dataLine, m_Residues);
 
   double mae = 0;
   for (int i = 0; i < lineSize; i++)
   {
-    uint8_t residue = dataLine[i] - predictedLine[i];
+    uint8_t residue = m_Residues[i];
     mae += abs((double)residue);
   }
   mae /= (double)lineSize;
@@ -58,14 +103,12 @@ double ResidueModule::GetMAE(std::vector<uint8_t> &dataLine)
 
 double ResidueModule::GetMSE(std::vector<uint8_t> &dataLine)
 {
-  Symbol predictedLine;
-  predictedLine = mp_PredictorModule->PredictLine(dataLine);
-  const int lineSize = predictedLine.GetCachelineSize();
+  const int lineSize = mp_PredictorModule->ComputeResidues(dataLine, m_Residues);
 
   double mse = 0;
   for (int i = 0; i < lineSize; i++)
   {
-    uint8_t residue = dataLine[i] - predictedLine[i];
+    uint8_t residue = m_Residues[i];
     mse += pow((double)residue, 2);
   }
   mse /= (double)lineSize;
@@ -18,12 +18,28 @@ public:
   ResidueModule(PredictorModule *predModule);
 
   Symbol ProcessLine(std::vector<uint8_t> &cacheLine);
+  // inverse of ProcessLine
+  void RestoreLine(Symbol &residueLine, std::vector<uint8_t> &cacheLine);
+  // every byte can be restored, i.e. the predictor bases form a tree from the root
+  bool IsInvertible() { return mb_Invertible; }
+
   double GetMAE(std::vector<uint8_t> &dataLine);
   double GetMSE(std::vector<uint8_t> &dataLine);
 
+private:
+  void buildRestoreOrder();
+
 private:
   int m_RootIndex;
   PredictorModule *mp_PredictorModule;
+
+  // bytes in the order of restoration, and their bases and indices in the residue line
+  std::vector<int> m_RestoreOrder;
+  std::vector<int> m_BaseIndex;
+  std::vector<int> m_ResidueIndex;
+  bool mb_Invertible;
+  // residues of the last line, in the order of the line
+  std::vector<uint8_t> m_Residues;
 };
 
 }
@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "ScanModule.h"
+#include "../Compressor.h"
 
 namespace comp
 {
@@ -10,17 +13,111 @@ Binary ScanModule::ProcessLine(Binary &bitplane)
   Binary scanned;
   scanned.SetSize(size / SCANNED_SYMBOLSIZE, SCANNED_SYMBOLSIZE);
 
-  for (int i = 0; i < m_Table.TableSize; i++)
+  if (!isPlanned(bitplane))
   {
-    int row = m_Table.Rows[i];
-    int col = m_Table.Cols[i];
+    for (int i = 0; i < m_Table.TableSize; i++)
+    {
+      int row = m_Table.Rows[i];
+      int col = m_Table.Cols[i];
 
-    scanned[i / scanned.GetColSize()][i % scanned.GetColSize()] = bitplane[row][col];
+      scanned[i / scanned.GetColSize()][i % scanned.GetColSize()] = bitplane[row][col];
+    }
+    return scanned;
+  }
+
+  const uint8_t *rows[BYTE];
+  for (int row = 0; row < BYTE; row++)
+    rows[row] = bitplane[row].data();
+
+  switch (m_Kind)
+  {
+    // a symbol is a run of a row
+    case SCAN_IDENTITY:
+      for (int i = 0; i < scanned.GetRowSize(); i++)
+      {
+        const int bit = i * SCANNED_SYMBOLSIZE;
+        const uint8_t *run = rows[bit / m_NumCols] + bit % m_NumCols;
+        std::copy(run, run + SCANNED_SYMBOLSIZE, scanned[i].begin());
+      }
+      break;
+    // a symbol is SCANNED_SYMBOLSIZE / BYTE columns
+    case SCAN_TRANSPOSE:
+      for (int i = 0; i < scanned.GetRowSize(); i++)
+      {
+        uint8_t *symbol = scanned[i].data();
+        for (int col = i * SCANNED_SYMBOLSIZE / BYTE; col < (i + 1) * SCANNED_SYMBOLSIZE / BYTE; col++)
+          for (int row = 0; row < BYTE; row++)
+            *symbol++ = rows[row][col];
+      }
+      break;
+    default:
+      for (int i = 0; i < scanned.GetRowSize(); i++)
+      {
+        uint8_t *symbol = scanned[i].data();
+        const uint8_t *planRows = &m_PlanRows[i * SCANNED_SYMBOLSIZE];
+        const uint16_t *planCols = &m_PlanCols[i * SCANNED_SYMBOLSIZE];
+        for (int j = 0; j < SCANNED_SYMBOLSIZE; j++)
+          symbol[j] = rows[planRows[j]][planCols[j]];
+      }
+      break;
   }
 
   return scanned;
 }
 
+Binary ScanModule::RestoreLine(Binary &scanned)
+{
+  int size = scanned.GetRowSize() * scanned.GetColSize();
+
+  Binary bitplane;
+  bitplane.SetSize(BYTE, size / BYTE);
+
+  if (!isPlanned(bitplane) || scanned.GetColSize() != SCANNED_SYMBOLSIZE)
+  {
+    for (int i = 0; i < m_Table.TableSize; i++)
+    {
+      int row = m_Table.Rows[i];
+      int col = m_Table.Cols[i];
+
+      bitplane[row][col] = scanned[i / scanned.GetColSize()][i % scanned.GetColSize()];
+    }
+    return bitplane;
+  }
+
+  uint8_t *rows[BYTE];
+  for (int row = 0; row < BYTE; row++)
+    rows[row] = bitplane[row].data();
+
+  // cells scanned more than once keep the last, as in the table
+  for (int i = 0; i < scanned.GetRowSize(); i++)
+  {
+    const uint8_t *symbol = scanned[i].data();
+    const uint8_t *planRows = &m_PlanRows[i * SCANNED_SYMBOLSIZE];
+    const uint16_t *planCols = &m_PlanCols[i * SCANNED_SYMBOLSIZE];
+    for (int j = 0; j < SCANNED_SYMBOLSIZE; j++)
+      rows[planRows[j]][planCols[j]] = symbol[j];
+  }
+
+  return bitplane;
+}
+
+bool ScanModule::IsInvertible(int lineSize)
+{
+  std::vector<bool> isScanned(BYTE * lineSize, false);
+  for (int i = 0; i < m_Table.TableSize; i++)
+  {
+    int row = m_Table.Rows[i];
+    int col = m_Table.Cols[i];
+    if (row < 0 || row >= BYTE || col < 0 || col >= lineSize)
+      return false;
+    isScanned[row * lineSize + col] = true;
+  }
+  for (bool scanned : isScanned)
+    if (!scanned)
+      return false;
+  return true;
+}
+
 void ScanModule::loadTable(const std::string filePath)
 {
   std::ifstream inFile;
@@ -47,6 +144,47 @@ void ScanModule::loadTable(const std::string filePath)
     inFile.read(reinterpret_cast<char *>(&intBuffer), sizeof(intBuffer));
     m_Table.Cols[i] = intBuffer;
   }
+  compilePlan();
+}
+
+void ScanModule::compilePlan()
+{
+  m_Kind = SCAN_GENERAL;
+  m_NumCols = 0;
+  m_PlanRows.clear();
+  m_PlanCols.clear();
+
+  // the table must cover a whole bitplane of BYTE rows, in whole symbols
+  const int numCols = m_Table.TableSize / BYTE;
+  if (m_Table.TableSize <= 0 || m_Table.TableSize % BYTE != 0 || m_Table.TableSize % SCANNED_SYMBOLSIZE != 0
+      || numCols > UINT16_MAX || m_Table.Rows.size() < (size_t)m_Table.TableSize
+      || m_Table.Cols.size() < (size_t)m_Table.TableSize)
+    return;
+  for (int i = 0; i < m_Table.TableSize; i++)
+    if (m_Table.Rows[i] < 0 || m_Table.Rows[i] >= BYTE || m_Table.Cols[i] < 0 || m_Table.Cols[i] >= numCols)
+      return;
+
+  m_NumCols = numCols;
+  m_PlanRows.assign(m_Table.Rows.begin(), m_Table.Rows.begin() + m_Table.TableSize);
+  m_PlanCols.assign(m_Table.Cols.begin(), m_Table.Cols.begin() + m_Table.TableSize);
+
+  bool isIdentity = true;
+  bool isTranspose = true;
+  for (int i = 0; i < m_Table.TableSize; i++)
+  {
+    isIdentity &= (m_Table.Rows[i] == i / numCols && m_Table.Cols[i] == i % numCols);
+    isTranspose &= (m_Table.Rows[i] == i % BYTE && m_Table.Cols[i] == i / BYTE);
+  }
+  // a symbol of the identity must not straddle two rows
+  if (isIdentity && numCols % SCANNED_SYMBOLSIZE == 0)
+    m_Kind = SCAN_IDENTITY;
+  else if (isTranspose && SCANNED_SYMBOLSIZE % BYTE == 0)
+    m_Kind = SCAN_TRANSPOSE;
+}
+
+bool ScanModule::isPlanned(Binary &bitplane)
+{
+  return m_NumCols != 0 && bitplane.GetRowSize() == BYTE && bitplane.GetColSize() == m_NumCols;
 }
 
 }
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <fstream>
+#include <cstdint>
 
 #include "PredCompModule.h"
 
@@ -18,6 +19,14 @@ struct ScanTable
   int TableSize;
 };
 
+// kinds of scan tables with a fast path
+enum ScanKind
+{
+  SCAN_GENERAL = 0,   // any order, gathered bit by bit
+  SCAN_IDENTITY,      // row by row, in order
+  SCAN_TRANSPOSE,     // column by column, in order
+};
+
 class ScanModule
 {
 friend class PredCompModule;
@@ -31,15 +40,35 @@ public:
 
     m_Table.Rows = rows;
     m_Table.Cols = cols;
+    compilePlan();
   }
 
+  // getters
+  ScanKind GetKind() { return m_Kind; }
+
   Binary ProcessLine(Binary &bitplane);
+  // inverse of ProcessLine, scanned back into a bitplane of BYTE rows
+  Binary RestoreLine(Binary &scanned);
+  // every bit of a bitplane of lineSize columns is scanned
+  bool IsInvertible(int lineSize);
 
 private:
   void loadTable(const std::string filePath);
+  // the plan of the table over bitplanes of BYTE rows, once the table is known
+  void compilePlan();
+  // whether the plan applies to a bitplane, of BYTE rows and the columns of the table
+  bool isPlanned(Binary &bitplane);
 
 private:
   ScanTable m_Table;
+
+  // The scan of a bitplane of BYTE x m_NumCols bits, compiled from the table:
+  // the kind of the table, and its cells as narrow arrays indexing the rows of the bitplane,
+  // so that a scan does not divide or bound-check per bit.
+  ScanKind m_Kind;
+  int m_NumCols;                    // 0 if the table is not over a whole bitplane
+  std::vector<uint8_t> m_PlanRows;
+  std::vector<uint16_t> m_PlanCols;
 };
 
 }
@@ -1,25 +1,61 @@
+#include <cstring>
+#include <cstdint>
+
 #include "XORModule.h"
 
 namespace comp
 {
-Binary XORModule::ProcessLine(Binary &bitplane)
+
+// row ^= other over the columns from 1, column 0 is never XORed.
+// A bit takes a byte of a row, so a word XORs 8 columns at once.
+static inline void xorRow(uint8_t *row, const uint8_t *other, int colSize)
 {
-  Binary bitplaneXOR = bitplane;
-  
+  int j = 1;
+  for (; j + 8 <= colSize; j += 8)
+  {
+    uint64_t word, otherWord;
+    std::memcpy(&word, row + j, 8);
+    std::memcpy(&otherWord, other + j, 8);
+    word ^= otherWord;
+    std::memcpy(row + j, &word, 8);
+  }
+  for (; j < colSize; j++)
+    row[j] ^= other[j];
+}
+
+void XORModule::ProcessLine(Binary &bitplane)
+{
+  const int rowSize = bitplane.GetRowSize();
+  const int colSize = bitplane.GetColSize();
+
+  // rows are XORed from the bottom, so that the previous row is still the original
   if (mb_ConsecutiveXOR)
   {
-    for (int i = 1; i < bitplane.GetRowSize(); i++)
-      for (int j = 1; j < bitplane.GetColSize(); j++)
-        bitplaneXOR[i][j] = bitplane[i][j] ^ bitplane[i - 1][j];
+    for (int i = rowSize - 1; i >= 1; i--)
+      xorRow(bitplane[i].data(), bitplane[i - 1].data(), colSize);
   }
   else
   {
-    for (int i = 1; i < bitplane.GetRowSize(); i++)
-      for (int j = 1; j < bitplane.GetColSize(); j++)
-        bitplaneXOR[i][j] = bitplane[i][j] ^ bitplane[0][j];
+    for (int i = 1; i < rowSize; i++)
+      xorRow(bitplane[i].data(), bitplane[0].data(), colSize);
   }
+}
 
-  return bitplaneXOR;
+void XORModule::RestoreLine(Binary &bitplane)
+{
+  const int rowSize = bitplane.GetRowSize();
+  const int colSize = bitplane.GetColSize();
+
+  // rows are restored from the top, so that the previous row is already restored (a prefix XOR)
+  if (mb_ConsecutiveXOR)
+  {
+    for (int i = 1; i < rowSize; i++)
+      xorRow(bitplane[i].data(), bitplane[i - 1].data(), colSize);
+  }
+  else
+  {
+    for (int i = 1; i < rowSize; i++)
+      xorRow(bitplane[i].data(), bitplane[0].data(), colSize);
+  }
 }
 }
-
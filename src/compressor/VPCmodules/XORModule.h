@@ -14,7 +14,10 @@ public:
   XORModule(bool consecutiveXOR)
     : mb_ConsecutiveXOR(consecutiveXOR) {}
 
-  Binary ProcessLine(Binary &bitplane);
+  // XOR the rows of bitplane in place, but column 0
+  void ProcessLine(Binary &bitplane);
+  // inverse of ProcessLine, in place
+  void RestoreLine(Binary &bitplane);
 
 private:
   bool mb_ConsecutiveXOR;
@@ -31,6 +31,8 @@ struct MemReq_t
 
 	bool isEnd;
 
+  virtual ~MemReq_t() = default;
+
   virtual void Reset()
   {
     addr = 0;
@@ -73,6 +75,8 @@ public:
   {
       m_FileStream.open(filePath.c_str(), std::ios_base::in | std::ios_base::binary);
   }
+  virtual ~Loader() {}
+
 	/*** getters ***/
 	virtual MemReq_t* GetCacheline(MemReq_t *) = 0;
   virtual unsigned GetCachelineSize() = 0;
@@ -46,6 +46,10 @@ namespace gpgpusim {
     memReqGPU->data.resize(memReqGPU->reqSize / sizeof(WORD_SIZE));
     m_FileStream.read(reinterpret_cast<char*>(memReqGPU->data.data()), memReqGPU->reqSize);
 
+    // writes and write-backs are writes, the others are reads
+    memReqGPU->rw = (memReqGPU->reqType == GLOBAL_ACC_W || memReqGPU->reqType == LOCAL_ACC_W
+        || memReqGPU->reqType == L1_WRBK_ACC || memReqGPU->reqType == L2_WRBK_ACC) ? WRITE : READ;
+
     if (m_FileStream.eof())
       memReqGPU->isEnd = true;
     else
@@ -114,28 +118,41 @@ namespace gpgpusim {
 }
 
 namespace apsim {
+  static inline uint8_t hexToByte(const char *hex)
+  {
+    auto nibble = [](char c) -> uint8_t {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+      return 0;
+    };
+    return (nibble(hex[0]) << 4) | nibble(hex[1]);
+  }
+
   /*** constructors ***/
   LoaderGPGPU::LoaderGPGPU(const char *filePath)
-    : Loader(filePath), m_RW(NA), m_LineSize(ACCESS_GRAN) { Reset(); }
+    : Loader(filePath), m_RW(NA), m_LineSize(ACCESS_GRAN), mb_AsyncParsing(false), m_StopParsing(false) { Reset(); }
   LoaderGPGPU::LoaderGPGPU(const std::string filePath)
-    : Loader(filePath), m_RW(NA), m_LineSize(ACCESS_GRAN) { Reset(); }
-  LoaderGPGPU::LoaderGPGPU(const char *filePath, const unsigned lineSize)
-    : Loader(filePath), m_RW(NA), m_LineSize(lineSize) { Reset(); }
-  LoaderGPGPU::LoaderGPGPU(const std::string filePath, const unsigned lineSize)
-    : Loader(filePath), m_RW(NA), m_LineSize(lineSize) { Reset(); }
+    : Loader(filePath), m_RW(NA), m_LineSize(ACCESS_GRAN), mb_AsyncParsing(false), m_StopParsing(false) { Reset(); }
+  LoaderGPGPU::LoaderGPGPU(const char *filePath, const unsigned lineSize, bool asyncParsing)
+    : Loader(filePath), m_RW(NA), m_LineSize(lineSize), mb_AsyncParsing(asyncParsing), m_StopParsing(false) { Reset(); }
+  LoaderGPGPU::LoaderGPGPU(const std::string filePath, const unsigned lineSize, bool asyncParsing)
+    : Loader(filePath), m_RW(NA), m_LineSize(lineSize), mb_AsyncParsing(asyncParsing), m_StopParsing(false) { Reset(); }
+
+  LoaderGPGPU::~LoaderGPGPU() { stopParsing(); }
 
   /*** getters ***/
   MemReq_t* LoaderGPGPU::GetCacheline(MemReq_t *memReq) { return (this->*mp_GetCacheline)(memReq); }
   unsigned LoaderGPGPU::GetCachelineSize() { return m_LineSize; }
   unsigned long long LoaderGPGPU::GetNumLines()
   {
-    MemReq_t *memReq = new MemReqGPU_t;
+    MemReqGPU_t memReq;
 
     unsigned long long numLines = 0;
     while (1)
     {
-      memReq = GetCacheline(memReq);
-      if (memReq->isEnd) break;
+      GetCacheline(&memReq);
+      if (memReq.isEnd) break;
       numLines++;
     }
 
@@ -151,6 +168,8 @@ namespace apsim {
     assert ((m_LineSize == ACCESS_GRAN || m_LineSize == ACCESS_GRAN * BURST_LEN)
         && "Invalid cache-line size");
 
+    stopParsing();
+
     m_FileStream.clear();
     m_FileStream.seekg(0);
 
@@ -169,6 +188,17 @@ namespace apsim {
       mp_ReadLine = &LoaderGPGPU::readLineR;
     else if (m_RW == WRITE)
       mp_ReadLine = &LoaderGPGPU::readLineW;
+
+    // clear reassembly state
+    m_BeatRowQueue.Clear();
+    m_LineQueue.Clear();
+    m_CurrBeatRow.numBeats = 0;
+    m_CurrBeat = 0;
+    for (int ch = 0; ch < NUM_CH; ch++)
+      m_NumChBeats[ch] = 0;
+    mb_IsEnd = false;
+
+    startParsing();
   }
 
   /*** private methods ***/
@@ -187,13 +217,9 @@ namespace apsim {
       datasetAttr.valid[i] = (uint8_t)std::stoi(lineAttributes[ 2 + i]);
       datasetAttr.ready[i] = (uint8_t)std::stoi(lineAttributes[10 + i]);
       datasetAttr.last[i]  = (uint8_t)std::stoi(lineAttributes[14 + i]);
-      std::string &hexStringData = lineAttributes[6 + i];
+      const char *hexStringData = lineAttributes[6 + i].c_str();
       for (int j = 0; j < ACCESS_GRAN; j++)
-      {
-        std::string hex(hexStringData.begin() + 2 * j, hexStringData.begin() + 2 * j + 2);
-        uint8_t c = std::stoi(hex, nullptr,  16);
-        datasetAttr.data[i][j] = c;
-      }
+        datasetAttr.data[i][j] = hexToByte(hexStringData + 2 * j);
     }
     return true;
   }
@@ -213,270 +239,188 @@ namespace apsim {
       datasetAttr.valid[i] = (uint8_t)std::stoi(lineAttributes[ 2 + i]);
       datasetAttr.ready[i] = (uint8_t)std::stoi(lineAttributes[10 + i]);
       datasetAttr.strb[i]  = (uint8_t)std::stoul(lineAttributes[14 + i], 0, 16);
-      std::string &hexStringData = lineAttributes[6 + i];
+      const char *hexStringData = lineAttributes[6 + i].c_str();
       for (int j = 0; j < ACCESS_GRAN; j++)
-      {
-        std::string hex(hexStringData.begin() + 2 * j, hexStringData.begin() + 2 * j + 2);
-        uint8_t c = std::stoi(hex, nullptr,  16);
-        datasetAttr.data[i][j] = c;
-      }
+        datasetAttr.data[i][j] = hexToByte(hexStringData + 2 * j);
     }
     return true;
   }
 
-  MemReq_t* LoaderGPGPU::getCacheline32(MemReq_t *memReq)
+  bool LoaderGPGPU::parseBeatRow(BeatRow_t &beatRow)
   {
     DatasetAttr datasetAttr;
 
-    // push memReq to the queue
-    if (m_MemReqQueue.empty())
+    while (ReadLine(datasetAttr))
     {
-      while (true)
+      if (!datasetAttr.clock)
+        continue;
+
+      // check which channel is handshaking
+      uint8_t channels[NUM_CH];
+      unsigned numChannels = getHandshakingChannels(datasetAttr, channels);
+      if (numChannels == 0)
+        continue;
+
+      beatRow.cycle = datasetAttr.cycle;
+      beatRow.numBeats = numChannels;
+      for (unsigned i = 0; i < numChannels; i++)
       {
-        if (ReadLine(datasetAttr))
-        {
-          if (!datasetAttr.clock)
-            continue;
-          if (!datasetAttr.valid[0] && !datasetAttr.valid[1]
-              && !datasetAttr.valid[2] && !datasetAttr.valid[3])
-            continue;
-
-          // check which channel is handshaking
-          std::vector<uint8_t> channels = getHandshakingChannels(datasetAttr);
-          if (channels.empty())
-            continue;
-
-          // enqueue
-          for (auto it = channels.begin(); it != channels.end(); it++)
-          {
-            MemReqGPU_t memReqGPU;
-            uint8_t &ch = *it;
-
-            uint64_t &cycle = datasetAttr.cycle;
-//            uint8_t &last = datasetAttr.last[ch];
-            uint8_t *data = datasetAttr.data[ch];
-
-            memReqGPU.rw = READ;
-            
-            memReqGPU.cycle = cycle;
-            memReqGPU.ch = ch;
-//            memReqGPU.last = last;
-            memReqGPU.reqSize = ACCESS_GRAN * BURST_LEN;   // TODO: AccessGran can be modified in the future
-            memReqGPU.data.resize(ACCESS_GRAN);
-            std::copy(data, data + ACCESS_GRAN, memReqGPU.data.begin());
-            memReqGPU.isEnd = false;
-
-            m_MemReqQueue.push(memReqGPU);
-          }
-          break;
-        }
-        // enqueue empty memReq (last)
-        else 
-        {
-          MemReqGPU_t memReqGPU;
-          memReqGPU.Reset();
-          memReqGPU.isEnd = true;
+        beatRow.ch[i] = channels[i];
+        std::memcpy(beatRow.data[i], datasetAttr.data[channels[i]], ACCESS_GRAN);
+      }
+      beatRow.isEnd = false;
+      return true;
+    }
 
-          m_MemReqQueue.push(memReqGPU);
-          break;
-        }
+    beatRow.numBeats = 0;
+    beatRow.isEnd = true;
+    return false;
+  }
+
+  void LoaderGPGPU::getBeatRow(BeatRow_t &beatRow)
+  {
+    if (!mb_AsyncParsing)
+    {
+      parseBeatRow(beatRow);
+      return;
+    }
+
+    while (!m_BeatRowQueue.Pop(beatRow))
+      std::this_thread::yield();
+  }
+
+  void LoaderGPGPU::parseLoop()
+  {
+    BeatRow_t beatRow;
+    bool isEnd = false;
+    while (!isEnd)
+    {
+      isEnd = !parseBeatRow(beatRow);
+      while (!m_BeatRowQueue.Push(beatRow))
+      {
+        if (m_StopParsing.load(std::memory_order_relaxed))
+          return;
+        std::this_thread::yield();
       }
     }
+  }
+
+  void LoaderGPGPU::startParsing()
+  {
+    if (!mb_AsyncParsing)
+      return;
 
-    // pop from the queue and return it
+    m_StopParsing.store(false);
+    m_ParserThread = std::thread(&LoaderGPGPU::parseLoop, this);
+  }
+
+  void LoaderGPGPU::stopParsing()
+  {
+    if (!m_ParserThread.joinable())
+      return;
+
+    m_StopParsing.store(true);
+    m_ParserThread.join();
+  }
+
+  MemReq_t* LoaderGPGPU::getCacheline32(MemReq_t *memReq)
+  {
     MemReqGPU_t *memReqGPU = static_cast<MemReqGPU_t*>(memReq);
-    MemReqGPU_t popMemReqGPU = m_MemReqQueue.front();
 
-    *memReqGPU = popMemReqGPU;
-    m_MemReqQueue.pop();
+    // every handshaking beat is a line
+    if (m_CurrBeat == m_CurrBeatRow.numBeats && !mb_IsEnd)
+    {
+      getBeatRow(m_CurrBeatRow);
+      m_CurrBeat = 0;
+      mb_IsEnd = m_CurrBeatRow.isEnd;
+    }
+
+    // the last memReq
+    if (mb_IsEnd)
+    {
+      memReqGPU->Reset();
+      memReqGPU->isEnd = true;
+      return memReq;
+    }
+
+    uint8_t *data = m_CurrBeatRow.data[m_CurrBeat];
+
+    memReqGPU->addr = 0;
+    memReqGPU->rw = m_RW;
+
+    memReqGPU->cycle = m_CurrBeatRow.cycle;
+    memReqGPU->ch = m_CurrBeatRow.ch[m_CurrBeat];
+    memReqGPU->reqSize = ACCESS_GRAN * BURST_LEN;   // TODO: AccessGran can be modified in the future
+    memReqGPU->data.assign(data, data + ACCESS_GRAN);
+    memReqGPU->isEnd = false;
+
+    m_CurrBeat++;
     return memReq;
   }
 
-//  MemReq_t* LoaderGPGPU::GetCachelineWrite32(MemReq_t *memReq)
-//  {
-//    DatasetAttr datasetAttr;
-//
-//    // push memReq to the queue
-//    if (m_MemReqQueue.empty())
-//    {
-//      while (true)
-//      {
-//        if (ReadLine(datasetAttr))
-//        {
-//          if (!datasetAttr.clock)
-//            continue;
-//          if (!datasetAttr.valid[0] && !datasetAttr.valid[1]
-//              && !datasetAttr.valid[2] && !datasetAttr.valid[3])
-//            continue;
-//
-//          // check which channel is handshaking
-//          std::vector<uint8_t> channels = getHandshakingChannels(datasetAttr);
-//          if (channels.empty())
-//            continue;
-//
-//          for (auto it = channels.begin(); it != channels.end(); it++)
-//          {
-//            MemReqGPU_t memReqGPU;
-//            uint8_t &ch = *it;
-//
-//            uint64_t &cycle = datasetAttr.cycle;
-////            uint32_t &strb = datasetAttr.strb[ch];
-//            uint8_t *data = datasetAttr.data[ch];
-//
-//            memReqGPU.rw = WRITE;
-//
-//            memReqGPU.cycle = cycle;
-//            memReqGPU.ch = ch;
-////            memReqGPU.strb = strb;
-//            memReqGPU.reqSize = ACCESS_GRAN * BURST_LEN;
-//            memReqGPU.data.resize(ACCESS_GRAN);
-//            std::copy(data, data + ACCESS_GRAN, memReqGPU.data.begin());
-//            memReqGPU.isEnd = false;
-//
-//            m_MemReqQueue.push(memReqGPU);
-//          }
-//          break;
-//        }
-//        else // last memReq
-//        {
-//          MemReqGPU_t memReqGPU;
-//          memReqGPU.Reset();
-//          memReqGPU.isEnd = true;
-//
-//          m_MemReqQueue.push(memReqGPU);
-//          break;
-//        }
-//      }
-//    }
-//
-//    // pop from the queue and return it
-//    MemReqGPU_t *memReqGPU = static_cast<MemReqGPU_t*>(memReq);
-//    MemReqGPU_t popMemReqGPU = m_MemReqQueue.front();
-//
-//    *memReqGPU = popMemReqGPU;
-//    m_MemReqQueue.pop();
-//    return memReq;
-//  }
-
   MemReq_t* LoaderGPGPU::getCacheline64(MemReq_t *memReq)
   {
-    DatasetAttr datasetAttr;
+    MemReqGPU_t *memReqGPU = static_cast<MemReqGPU_t*>(memReq);
+    Line_t line;
 
-    if (m_MemReqQueue.empty())
+    // gather beats of each channel until a whole burst is transferred
+    while (!m_LineQueue.Pop(line))
     {
-      while (true)
+      if (!mb_IsEnd)
       {
-        // read a line and enqueue
-        if (ReadLine(datasetAttr))
-        {
-          if (!datasetAttr.clock)
-            continue;
-          if (!datasetAttr.valid[0] && !datasetAttr.valid[1]
-              && !datasetAttr.valid[2] && !datasetAttr.valid[3])
-            continue;
-
-          // check which channel is handshaking
-          std::vector<uint8_t> channels = getHandshakingChannels(datasetAttr);
-          if (channels.empty())
-            continue;
-
-          // enqueue to the channel queue
-          for (auto it = channels.begin(); it != channels.end(); it++)
-          {
-            MemReqGPU_t memReqGPU;
-            uint8_t &ch = *it;
-
-            uint64_t &cycle = datasetAttr.cycle;
-            uint8_t *data = datasetAttr.data[ch];
-
-            memReqGPU.rw = READ;
-            
-            memReqGPU.cycle = cycle;
-            memReqGPU.ch = ch;
-            memReqGPU.data.resize(ACCESS_GRAN);
-            std::copy(data, data + ACCESS_GRAN, memReqGPU.data.begin());
-            memReqGPU.isEnd = false;
-
-            m_MemReqChQueue[ch].push(memReqGPU);
-          }
-
-          // check if whole burst is transferred
-          bool isEnqueued = false;
-          for (int ch = 0; ch < NUM_CH; ch++)
-          {
-            if (m_MemReqChQueue[ch].size() == BURST_LEN)
-            {
-              MemReqGPU_t returningMemReqGPU;
-              returningMemReqGPU.ch = ch;
-              returningMemReqGPU.rw = m_RW;
-              returningMemReqGPU.reqSize = ACCESS_GRAN * BURST_LEN; 
-              returningMemReqGPU.isEnd = false;
-
-              std::vector<uint8_t> &returningData = returningMemReqGPU.data;
-//              returningData.resize(ACCESS_GRAN * BURST_LEN);
-
-              // first memReq
-              MemReqGPU_t firstMemReqGPU;
-              firstMemReqGPU = m_MemReqChQueue[ch].front();
-              uint64_t &firstCycle = firstMemReqGPU.cycle;
-              std::vector<uint8_t> &firstData = firstMemReqGPU.data;
-
-              returningData.insert(returningData.end(), firstData.begin(), firstData.end());
-//              std::copy(firstData.begin(), firstData.begin() + ACCESS_GRAN, returningData.begin());
-              m_MemReqChQueue[ch].pop();
-
-              // second memReq
-              MemReqGPU_t secondMemReqGPU;
-              secondMemReqGPU = m_MemReqChQueue[ch].front();
-              uint64_t &secondCycle = secondMemReqGPU.cycle;
-              std::vector<uint8_t> &secondData = secondMemReqGPU.data;
-
-              returningData.insert(returningData.end(), secondData.begin(), secondData.end());
-//              std::copy(secondData.begin(), secondData.begin() + ACCESS_GRAN, returningData.begin());
-              returningMemReqGPU.cycle = secondCycle;
-              m_MemReqChQueue[ch].pop();
-
-              // enqueue returning memReq
-              m_MemReqQueue.push(returningMemReqGPU);
-
-              isEnqueued = true;
-            }
-          }
-
-          if (isEnqueued)
-            break;
-        }
-        // if eof, enqueue empty memReq (last)
-        else 
+        getBeatRow(m_CurrBeatRow);
+        mb_IsEnd = m_CurrBeatRow.isEnd;
+      }
+
+      // the last memReq
+      if (mb_IsEnd)
+      {
+        memReqGPU->Reset();
+        memReqGPU->isEnd = true;
+        return memReq;
+      }
+
+      // append beats to the channel buffers
+      for (int i = 0; i < m_CurrBeatRow.numBeats; i++)
+      {
+        uint8_t ch = m_CurrBeatRow.ch[i];
+        std::memcpy(m_ChData[ch] + m_NumChBeats[ch] * ACCESS_GRAN, m_CurrBeatRow.data[i], ACCESS_GRAN);
+        m_NumChBeats[ch]++;
+      }
+
+      // complete lines are queued in the order of channels
+      for (int ch = 0; ch < NUM_CH; ch++)
+      {
+        if (m_NumChBeats[ch] == BURST_LEN)
         {
-          MemReqGPU_t memReqGPU;
-          memReqGPU.Reset();
-          memReqGPU.isEnd = true;
+          line.cycle = m_CurrBeatRow.cycle;
+          line.ch = ch;
+          std::memcpy(line.data, m_ChData[ch], ACCESS_GRAN * BURST_LEN);
+          m_LineQueue.Push(line);
 
-          m_MemReqQueue.push(memReqGPU);
-          break;
+          m_NumChBeats[ch] = 0;
         }
       }
-
     }
 
-    // pop from the queue and return it
-    MemReqGPU_t *memReqGPU = static_cast<MemReqGPU_t*>(memReq);
-    MemReqGPU_t popMemReqGPU = m_MemReqQueue.front();
+    memReqGPU->addr = 0;
+    memReqGPU->rw = m_RW;
 
-    *memReqGPU = popMemReqGPU;
-    m_MemReqQueue.pop();
+    memReqGPU->cycle = line.cycle;
+    memReqGPU->ch = line.ch;
+    memReqGPU->reqSize = ACCESS_GRAN * BURST_LEN;
+    memReqGPU->data.assign(line.data, line.data + ACCESS_GRAN * BURST_LEN);
+    memReqGPU->isEnd = false;
     return memReq;
-
   }
 
-  std::vector<uint8_t> LoaderGPGPU::getHandshakingChannels(DatasetAttr &datasetAttr)
+  unsigned LoaderGPGPU::getHandshakingChannels(DatasetAttr &datasetAttr, uint8_t *channels)
   {
-    std::vector<uint8_t> channels;
+    unsigned numChannels = 0;
     for (int i = 0; i < NUM_CH; i++)
       if (datasetAttr.valid[i] == 1 && datasetAttr.ready[i] == 1)
-        channels.push_back(i);
-    return channels;
+        channels[numChannels++] = i;
+    return numChannels;
   }
   
   void LoaderGPGPU::isFileValid()
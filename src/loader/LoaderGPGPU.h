@@ -2,11 +2,14 @@
 #define __LOADERGPGPU_H__
 
 #include <map>
-#include <queue>
+#include <atomic>
+#include <thread>
+#include <cstring>
 #include <strutil.h>
 #include <fmt/core.h>
 
 #include "Loader.h"
+#include "RingBuffer.h"
 
 namespace trace {
 namespace gpgpusim {
@@ -146,6 +149,7 @@ namespace apsim {
 
 #define NUM_CH 4
 #define BURST_LEN 2
+#define BEATROW_QUEUE_SIZE 1024
 
 struct DatasetAttr
 {
@@ -195,6 +199,24 @@ struct DatasetAttr
   }
 };
 
+// handshaking beats of a single cycle, payloads are kept inline
+struct BeatRow_t
+{
+  uint64_t cycle;
+  uint8_t numBeats;
+  uint8_t ch[NUM_CH];
+  uint8_t data[NUM_CH][ACCESS_GRAN];
+  bool isEnd;
+};
+
+// a line reassembled from the beats of a channel
+struct Line_t
+{
+  uint64_t cycle;
+  uint8_t ch;
+  uint8_t data[ACCESS_GRAN * BURST_LEN];
+};
+
 struct MemReqGPU_t : public MemReq_t
 {
   uint64_t cycle;
@@ -238,8 +260,11 @@ public:
   /*** constructors ***/
   LoaderGPGPU(const char *filePath);
   LoaderGPGPU(const std::string filePath);
-  LoaderGPGPU(const char *filePath, const unsigned lineSize);
-  LoaderGPGPU(const std::string filePath, const unsigned lineSize);
+  // If asyncParsing is set, CSV rows are parsed on a separate thread
+  // and handed over to the reassembly through a lock-free queue.
+  LoaderGPGPU(const char *filePath, const unsigned lineSize, bool asyncParsing = false);
+  LoaderGPGPU(const std::string filePath, const unsigned lineSize, bool asyncParsing = false);
+  ~LoaderGPGPU();
 
   /*** getters ***/
   // Get a line in 32B granularity
@@ -266,7 +291,14 @@ private:
   MemReq_t* getCacheline32(MemReq_t *memReq);
   MemReq_t* getCacheline64(MemReq_t *memReq);
 
-  std::vector<uint8_t> getHandshakingChannels(DatasetAttr &datasetAttr);
+  // read rows until one has handshaking channels, returns false at the end of the file
+  bool parseBeatRow(BeatRow_t &beatRow);
+  void getBeatRow(BeatRow_t &beatRow);
+  void parseLoop();
+  void startParsing();
+  void stopParsing();
+
+  unsigned getHandshakingChannels(DatasetAttr &datasetAttr, uint8_t *channels);
 
   void isFileValid();
 
@@ -276,10 +308,21 @@ protected:
   bool (LoaderGPGPU::*mp_ReadLine)(DatasetAttr&);
 
   rw_t m_RW;
-  std::queue<MemReqGPU_t> m_MemReqQueue;
-  std::queue<MemReqGPU_t> m_MemReqChQueue[NUM_CH];
-
   const unsigned m_LineSize;
+
+  // rows of beats from the parser to the reassembly
+  RingBuffer<BeatRow_t, BEATROW_QUEUE_SIZE> m_BeatRowQueue;
+  const bool mb_AsyncParsing;
+  std::thread m_ParserThread;
+  std::atomic<bool> m_StopParsing;
+
+  // reassembly state
+  BeatRow_t m_CurrBeatRow;
+  unsigned m_CurrBeat;
+  uint8_t m_ChData[NUM_CH][ACCESS_GRAN * BURST_LEN];
+  unsigned m_NumChBeats[NUM_CH];
+  RingBuffer<Line_t, NUM_CH> m_LineQueue;
+  bool mb_IsEnd;
 };
 
 
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <json/json.h>
+
+#include "LoaderSynthetic.h"
+
+namespace trace
+{
+
+static const char *SYN_CLASS_NAMES[NUM_SYN_CLASSES] = {
+  "zero", "repeated", "base_delta", "fp32", "pointer", "random",
+};
+
+// counter-based generator (SplitMix64),
+// seeded with the line index so that lines do not depend on each other
+class SplitMix64
+{
+public:
+  SplitMix64(uint64_t seed, uint64_t index)
+    : m_State(mix(seed ^ mix(index + 0x9E3779B97F4A7C15ULL))) {}
+
+  uint64_t Next()
+  {
+    m_State += 0x9E3779B97F4A7C15ULL;
+    return mix(m_State);
+  }
+  // uniform in [0, 1)
+  double NextDouble() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+  static uint64_t mix(uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+private:
+  uint64_t m_State;
+};
+
+/*** constructors ***/
+LoaderSynthetic::LoaderSynthetic(const char *specPath)
+  : Loader(specPath), m_CurrentLine(0) { parseSpec(m_FilePath); Reset(); }
+LoaderSynthetic::LoaderSynthetic(const std::string specPath)
+  : Loader(specPath), m_CurrentLine(0) { parseSpec(m_FilePath); Reset(); }
+LoaderSynthetic::LoaderSynthetic(const SyntheticSpec_t &spec)
+  : Loader(""), m_Spec(spec), m_CurrentLine(0) { normalizeWeights(); Reset(); }
+
+/*** getters ***/
+MemReq_t* LoaderSynthetic::GetCacheline(MemReq_t *memReq)
+{
+  if (m_CurrentLine >= m_Spec.numLines)
+  {
+    memReq->Reset();
+    memReq->isEnd = true;
+    return memReq;
+  }
+
+  memReq->addr = m_CurrentLine * m_Spec.lineSize;
+  memReq->reqSize = m_Spec.lineSize;
+  memReq->data.resize(m_Spec.lineSize / sizeof(WORD_SIZE));
+  GenerateLine(m_CurrentLine, memReq->data.data());
+
+  // read/write is drawn from a stream independent of the line data
+  SplitMix64 rng(~m_Spec.seed, m_CurrentLine);
+  memReq->rw = (rng.NextDouble() < m_Spec.writeRatio) ? WRITE : READ;
+
+  m_CurrentLine++;
+  memReq->isEnd = false;
+  return memReq;
+}
+
+unsigned LoaderSynthetic::GetCachelineSize()
+{
+  return m_Spec.lineSize;
+}
+
+unsigned long long LoaderSynthetic::GetNumLines()
+{
+  return m_Spec.numLines;
+}
+
+/*** methods ***/
+void LoaderSynthetic::Reset()
+{
+  m_CurrentLine = 0;
+}
+
+SynClass LoaderSynthetic::GenerateLine(uint64_t index, uint8_t *line)
+{
+  SplitMix64 rng(m_Spec.seed, index);
+  const unsigned lineSize = m_Spec.lineSize;
+
+  // select class
+  double u = rng.NextDouble();
+  int synClass = 0;
+  while (synClass < NUM_SYN_CLASSES - 1 && u >= m_CumWeights[synClass])
+    synClass++;
+
+  switch (synClass)
+  {
+    case SYN_ZERO:
+      memset(line, 0, lineSize);
+      break;
+    case SYN_REPEATED:
+    {
+      const unsigned wordSize = m_Spec.repeatedWordSize;
+      uint64_t word = rng.Next();
+      for (unsigned i = 0; i < lineSize; i += wordSize)
+        memcpy(line + i, &word, wordSize);
+      break;
+    }
+    case SYN_BASEDELTA:
+    {
+      const unsigned baseSize = m_Spec.baseSize;
+      const unsigned deltaBits = m_Spec.deltaSize * 8;
+      uint64_t base = rng.Next();
+      for (unsigned i = 0; i < lineSize; i += baseSize)
+      {
+        // signed delta of deltaSize bytes
+        int64_t delta = (int64_t)(rng.Next() << (64 - deltaBits)) >> (64 - deltaBits);
+        uint64_t word = base + delta;
+        memcpy(line + i, &word, baseSize);
+      }
+      break;
+    }
+    case SYN_FP32:
+    {
+      // elements share an exponent range, like a tensor of one layer
+      const int center = m_Spec.fpExponent + (int)(rng.Next() % (2 * m_Spec.fpExponentSpread + 1)) - m_Spec.fpExponentSpread;
+      for (unsigned i = 0; i < lineSize; i += 4)
+      {
+        uint64_t r = rng.Next();
+        uint32_t element = 0;
+        if (rng.NextDouble() >= m_Spec.fpSparsity)
+        {
+          uint32_t sign = (r >> 63) & 0x1;
+          int exponent = std::min(std::max(127 + center - (int)((r >> 32) & 0x3), 1), 254);
+          uint32_t mantissa = r & 0x7FFFFF;
+          element = (sign << 31) | ((uint32_t)exponent << 23) | mantissa;
+        }
+        memcpy(line + i, &element, 4);
+      }
+      break;
+    }
+    case SYN_POINTER:
+    {
+      // pointers of a line point near each other, like fields of a node
+      const uint64_t align = m_Spec.pointerAlign;
+      uint64_t region = m_Spec.heapBase + (rng.Next() % m_Spec.heapSpan);
+      for (unsigned i = 0; i < lineSize; i += 8)
+      {
+        uint64_t pointer = (rng.Next() % 8 == 0) ? 0 : ((region + (rng.Next() % 4096)) & ~(align - 1));
+        memcpy(line + i, &pointer, 8);
+      }
+      break;
+    }
+    case SYN_RANDOM:
+    default:
+      for (unsigned i = 0; i < lineSize; i += 8)
+      {
+        uint64_t r = rng.Next();
+        memcpy(line + i, &r, 8);
+      }
+      break;
+  }
+
+  return (SynClass)synClass;
+}
+
+void LoaderSynthetic::parseSpec(const std::string &specPath)
+{
+  // open spec file
+  if (!m_FileStream.is_open())
+  {
+    printf("Invalid File! \"%s\" is not valid path.\n", specPath.c_str());
+    exit(1);
+  }
+
+  // declare json root
+  Json::Value root;
+
+  // instantiate json parser
+  Json::CharReaderBuilder builder;
+  builder["collectComments"] = false;
+  JSONCPP_STRING errs;
+  if (!parseFromStream(builder, m_FileStream, &root, &errs))
+  {
+    std::cout << errs << std::endl;
+    printf("Parsing ERROR! \"%s\" is not valid json file.\n", specPath.c_str());
+    exit(1);
+  }
+
+  // 64-bit values may be given as numbers or as (hex) strings
+  auto asUInt64 = [](const Json::Value &value, uint64_t defaultValue) -> uint64_t {
+    if (value.isNull())
+      return defaultValue;
+    if (value.isString())
+      return std::stoull(value.asString(), nullptr, 0);
+    return value.asUInt64();
+  };
+
+  // parse overview
+  m_Spec.seed = asUInt64(root["seed"], m_Spec.seed);
+  m_Spec.numLines = asUInt64(root["num_lines"], m_Spec.numLines);
+  m_Spec.lineSize = root.get("lineSize", m_Spec.lineSize).asUInt();
+  m_Spec.writeRatio = root.get("write_ratio", m_Spec.writeRatio).asDouble();
+
+  // parse mixture
+  if (!root["mixture"].isNull())
+  {
+    for (int c = 0; c < NUM_SYN_CLASSES; c++)
+      m_Spec.weights[c] = root["mixture"].get(SYN_CLASS_NAMES[c], 0).asDouble();
+  }
+
+  // parse class parameters
+  Json::Value &repeated = root["repeated"];
+  m_Spec.repeatedWordSize = repeated.get("word_size", m_Spec.repeatedWordSize).asUInt();
+
+  Json::Value &baseDelta = root["base_delta"];
+  m_Spec.baseSize = baseDelta.get("base_size", m_Spec.baseSize).asUInt();
+  m_Spec.deltaSize = baseDelta.get("delta_size", m_Spec.deltaSize).asUInt();
+
+  Json::Value &fp32 = root["fp32"];
+  m_Spec.fpExponent = fp32.get("exponent", m_Spec.fpExponent).asInt();
+  m_Spec.fpExponentSpread = fp32.get("exponent_spread", m_Spec.fpExponentSpread).asInt();
+  m_Spec.fpSparsity = fp32.get("sparsity", m_Spec.fpSparsity).asDouble();
+
+  Json::Value &pointer = root["pointer"];
+  m_Spec.heapBase = asUInt64(pointer["heap_base"], m_Spec.heapBase);
+  m_Spec.heapSpan = asUInt64(pointer["heap_span"], m_Spec.heapSpan);
+  m_Spec.pointerAlign = pointer.get("align", m_Spec.pointerAlign).asUInt();
+
+  normalizeWeights();
+}
+
+void LoaderSynthetic::normalizeWeights()
+{
+  // check spec
+  const unsigned lineSize = m_Spec.lineSize;
+  if (lineSize == 0 || lineSize % 8 != 0
+      || m_Spec.repeatedWordSize == 0 || m_Spec.repeatedWordSize > 8 || lineSize % m_Spec.repeatedWordSize != 0
+      || m_Spec.baseSize == 0 || m_Spec.baseSize > 8 || lineSize % m_Spec.baseSize != 0
+      || m_Spec.deltaSize == 0 || m_Spec.deltaSize >= m_Spec.baseSize
+      || m_Spec.fpExponentSpread < 0 || m_Spec.heapSpan == 0
+      || m_Spec.pointerAlign == 0 || (m_Spec.pointerAlign & (m_Spec.pointerAlign - 1)) != 0)
+  {
+    printf("Invalid synthetic spec! Check line, word and delta sizes.\n");
+    exit(1);
+  }
+
+  double sum = 0;
+  for (int c = 0; c < NUM_SYN_CLASSES; c++)
+  {
+    if (m_Spec.weights[c] < 0)
+    {
+      printf("Invalid synthetic spec! Weight of \"%s\" is negative.\n", SYN_CLASS_NAMES[c]);
+      exit(1);
+    }
+    sum += m_Spec.weights[c];
+  }
+  if (sum == 0)
+  {
+    printf("Invalid synthetic spec! Mixture is empty.\n");
+    exit(1);
+  }
+
+  double cum = 0;
+  for (int c = 0; c < NUM_SYN_CLASSES; c++)
+  {
+    cum += m_Spec.weights[c] / sum;
+    m_CumWeights[c] = cum;
+  }
+  m_CumWeights[NUM_SYN_CLASSES - 1] = 1.0;
+}
+
+}
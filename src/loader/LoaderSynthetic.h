@@ -0,0 +1,81 @@
+#ifndef __LOADERSYNTHETIC_H__
+#define __LOADERSYNTHETIC_H__
+
+#include "Loader.h"
+
+namespace trace
+{
+
+// line classes of the mixture
+enum SynClass
+{
+  SYN_ZERO = 0,
+  SYN_REPEATED,
+  SYN_BASEDELTA,
+  SYN_FP32,
+  SYN_POINTER,
+  SYN_RANDOM,
+  NUM_SYN_CLASSES,
+};
+
+struct SyntheticSpec_t
+{
+  uint64_t seed = 0;
+  uint64_t numLines = 1000000;
+  unsigned lineSize = 32;
+  // ratio of write requests
+  double writeRatio = 0;
+
+  // mixture weights, indexed by SynClass
+  double weights[NUM_SYN_CLASSES] = { 0, 0, 0, 0, 0, 1 };
+
+  // repeated: size of the repeated word in bytes
+  unsigned repeatedWordSize = 4;
+  // base_delta: word size and delta size in bytes
+  unsigned baseSize = 4;
+  unsigned deltaSize = 1;
+  // fp32: exponent center and spread around it, ratio of zero elements
+  int fpExponent = 0;
+  int fpExponentSpread = 4;
+  double fpSparsity = 0;
+  // pointer: 8-byte pointers into [heapBase, heapBase + heapSpan), aligned
+  uint64_t heapBase = 0x7f0000000000ULL;
+  uint64_t heapSpan = 1ULL << 30;
+  unsigned pointerAlign = 8;
+};
+
+// Loader generating lines on the fly.
+// A line is a pure function of the seed and its index, so any number of lines
+// is generated with O(1) memory and the same spec always gives the same trace.
+class LoaderSynthetic : public Loader
+{
+public:
+  /*** constructors ***/
+  LoaderSynthetic(const char *specPath);
+  LoaderSynthetic(const std::string specPath);
+  LoaderSynthetic(const SyntheticSpec_t &spec);
+
+  /*** getters ***/
+  virtual MemReq_t* GetCacheline(MemReq_t *memReq);
+  virtual unsigned GetCachelineSize();
+  virtual unsigned long long GetNumLines();
+
+  /*** methods ***/
+  virtual void Reset();
+
+  // write line #index into line, returns its class
+  SynClass GenerateLine(uint64_t index, uint8_t *line);
+
+private:
+  void parseSpec(const std::string &specPath);
+  void normalizeWeights();
+
+private:
+  SyntheticSpec_t m_Spec;
+  double m_CumWeights[NUM_SYN_CLASSES];
+  uint64_t m_CurrentLine;
+};
+
+}
+
+#endif  // __LOADERSYNTHETIC_H__
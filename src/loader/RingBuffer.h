@@ -0,0 +1,85 @@
+#ifndef __RINGBUFFER_H__
+#define __RINGBUFFER_H__
+
+#include <atomic>
+#include <cstdint>
+
+namespace trace
+{
+
+// Fixed-capacity lock-free multi-producer single-consumer queue.
+// Every slot carries a sequence number, so a producer claims a slot with a single CAS
+// and the consumer never blocks. Items are stored inline; nothing is allocated after construction.
+template <typename T, unsigned CAPACITY>
+class RingBuffer
+{
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity of RingBuffer should be a power of 2.");
+
+public:
+  /*** constructors ***/
+  RingBuffer() { Clear(); }
+
+  /*** methods ***/
+  // returns false if the queue is full
+  bool Push(const T &item)
+  {
+    uint64_t pos = m_Tail.load(std::memory_order_relaxed);
+    while (true)
+    {
+      Slot &slot = m_Slots[pos & (CAPACITY - 1)];
+      uint64_t seq = slot.seq.load(std::memory_order_acquire);
+      int64_t diff = (int64_t)seq - (int64_t)pos;
+      if (diff == 0)
+      {
+        if (m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          slot.item = item;
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+        return false;
+      else
+        pos = m_Tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  // returns false if the queue is empty
+  // only one thread may pop
+  bool Pop(T &item)
+  {
+    Slot &slot = m_Slots[m_Head & (CAPACITY - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != m_Head + 1)
+      return false;
+
+    item = slot.item;
+    slot.seq.store(m_Head + CAPACITY, std::memory_order_release);
+    m_Head++;
+    return true;
+  }
+
+  // not thread-safe, call it only while no one pushes or pops
+  void Clear()
+  {
+    for (unsigned i = 0; i < CAPACITY; i++)
+      m_Slots[i].seq.store(i, std::memory_order_relaxed);
+    m_Tail.store(0, std::memory_order_relaxed);
+    m_Head = 0;
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<uint64_t> seq;
+    T item;
+  };
+
+  alignas(64) std::atomic<uint64_t> m_Tail;   // producers' side
+  alignas(64) uint64_t m_Head;                // consumer's side
+  Slot m_Slots[CAPACITY];
+};
+
+}
+
+#endif  // __RINGBUFFER_H__
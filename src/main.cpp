@@ -3,6 +3,7 @@
 #include <iostream>
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 
 #include <fmt/core.h>
 #include <cxxopts.hpp>
@@ -15,15 +16,67 @@
 #include "compressor/SC2.h"
 #include "compressor/Pattern.h"
 #include "compressor/BPC.h"
+#include "compressor/LineSink.h"
+#include "compressor/RegionResult.h"
+#include "compressor/Entropy.h"
+#include "compressor/BurstResult.h"
+#include "compressor/CacheResult.h"
+#include "compressor/DRAMResult.h"
+#include "compressor/MemoCache.h"
 
 #include "loader/LoaderGPGPU.h"
 #include "loader/LoaderNPY.h"
+#include "loader/LoaderSynthetic.h"
+
+#include "profiler.h"
+#include "sweep.h"
+#include "batch.h"
 
 //#define REQ_SIZE (ACCESS_GRAN*2)
 #define REQ_SIZE 32
+// number of lines compressed at once
+#define BATCH_LINES 4096
+
+// windows of the statistics over time
+enum WindowType
+{
+  WINDOW_NONE = 0,
+  WINDOW_KERNEL,    // per kernel ID
+  WINDOW_CYCLE,     // per fixed span of cycles
+  WINDOW_LINE,      // per fixed number of lines
+};
+
+// optional statistics fed by each compressed line, nullptr if not collected
+struct LineSinks
+{
+  comp::LineSink *Lines = nullptr;        // selected compressor of each line
+  comp::RegionResult *Region = nullptr;
+  comp::EntropyResult *Entropy = nullptr;
+  comp::BurstResult *Burst = nullptr;
+  comp::CacheResult *Cache = nullptr;
+  comp::DRAMResult *DRAM = nullptr;
+};
+
+// request types of GPGPU-Sim traces selected by --req-types
+static const std::pair<const char*, unsigned> REQ_TYPE_NAMES[] = {
+  { "global",  (1u << trace::gpgpusim::GLOBAL_ACC_R) | (1u << trace::gpgpusim::GLOBAL_ACC_W) },
+  { "local",   (1u << trace::gpgpusim::LOCAL_ACC_R) | (1u << trace::gpgpusim::LOCAL_ACC_W) },
+  { "const",   (1u << trace::gpgpusim::CONST_ACC_R) },
+  { "texture", (1u << trace::gpgpusim::TEXTURE_ACC_R) },
+  { "inst",    (1u << trace::gpgpusim::INST_ACC_R) },
+  { "l1wb",    (1u << trace::gpgpusim::L1_WRBK_ACC) },
+  { "l2wb",    (1u << trace::gpgpusim::L2_WRBK_ACC) },
+};
+static const char *RW_NAMES[NUM_RW] = { "read", "write", "na" };
 
-comp::CompResult* compressLines(comp::Compressor *compressor, trace::Loader *loader);
+comp::Compressor* newCompressor(std::string algorithm, std::string configPath, const Json::Value &config,
+    trace::Loader *loader);
+comp::CompResult* compressLines(comp::Compressor *compressor, trace::Loader *loader, const LineSinks &sinks,
+    WindowType windowType, uint64_t windowSize, comp::MemoCache *memo, unsigned reqTypeMask, bool isRWSplit);
+comp::CompResult* encodeLines(comp::Compressor *compressor, trace::Loader *loader,
+    std::string encodePath, comp::CodecResult &codecStat, unsigned reqTypeMask);
 void viewLines(trace::Loader *loader);
+std::string checkTrace(trace::Loader *loader, WindowType windowType, bool isDRAM, bool isCache, bool isRegion);
 
 int main(int argc, char **argv)
 {
@@ -31,6 +84,27 @@ int main(int argc, char **argv)
   std::string tracePath;
   std::string configPath;
   std::string outputDirPath;
+  std::string encodePath;
+  std::string lineOutputPath;
+  std::string windowSpec;
+  std::string sweepSpec;
+  std::string batchSpec;
+  unsigned numThreads;
+  comp::RecordFormat outputFormat = comp::RECORD_CSV;
+  WindowType windowType = WINDOW_NONE;
+  uint64_t windowSize = 0;
+  uint64_t regionSize;
+  unsigned numTopRegions;
+  unsigned reqTypeMask = REQ_TYPE_NAMES[0].second;
+  bool isRWSplit;
+  bool isEntropy;
+  std::vector<unsigned> burstSizes;
+  unsigned burstMetadataBits;
+  std::string cacheSpec;
+  bool isDRAM;
+  comp::DRAMConfig dramConfig;
+  uint64_t memoEntries;
+  bool asyncParsing;
   
   // parse arguments
   {
@@ -38,9 +112,31 @@ int main(int argc, char **argv)
 
   options.add_options()
     ("a,algorithm", "Compression algorithm [VPC/FPC/BDI/BPC/CPACK/SC2/PATTERN/VIEWER]. Default=VPC", cxxopts::value<std::string>())
-    ("i,input",     "Input GPGPU-Sim trace file path. Supported extensions: .log, .npy", cxxopts::value<std::string>())
-    ("c,config",    "Config file path (.json).", cxxopts::value<std::string>())
+    ("i,input",     "Input GPGPU-Sim trace file path. Supported extensions: .log, .npy, .txt, .syn (synthetic trace spec)", cxxopts::value<std::string>())
+    ("c,config",    "Config file path (.json). Required by VPC, optional parameters of the other algorithms", cxxopts::value<std::string>())
     ("o,output",    "Output directory path", cxxopts::value<std::string>())
+    ("e,encode",    "Write compressed lines to the given file, and verify the file by decoding it", cxxopts::value<std::string>())
+    ("line-output", "Append the compressed size and the selected module of every line to the given file", cxxopts::value<std::string>())
+    ("w,window",    "Also report statistics per window [kernel/cycle:<N>/line:<N>]", cxxopts::value<std::string>())
+    ("region",      "Also report statistics per address region of the given size in bytes, e.g. 4096", cxxopts::value<uint64_t>())
+    ("region-top",  "Number of the best and the worst regions to report. Default=16", cxxopts::value<unsigned>())
+    ("entropy",     "Also report the entropy bounds of the lines")
+    ("burst",       "Also report the bursts moved per line for each of the comma-separated burst sizes in bytes, e.g. 32,64", cxxopts::value<std::string>())
+    ("burst-metadata", "Metadata bits per line of the burst model. Default=0", cxxopts::value<unsigned>())
+    ("cache",       "Also simulate compressed caches fed by the addresses and the compressed sizes of the lines: "
+                    "comma-separated <uncompressed/segmented/superblock>:<capacity in bytes>:<ways>", cxxopts::value<std::string>())
+    ("dram",        "Also replay the lines of GPGPU-Sim traces on a DRAM timing model, uncompressed and compressed. "
+                    "Bursts are 32B by default, so lines of 32B save none: set a smaller burst_size to see savings")
+    ("dram-config", "Timing of the DRAM model (.json) [burst_size/burst_cycles/tCAS/tRCD/tRP]", cxxopts::value<std::string>())
+    ("memo",        "Compress each distinct line once through a cache of the given number of lines, "
+                    "replaying the result of the lines found. Ignored by CPACK, SC2 and PATTERN", cxxopts::value<uint64_t>())
+    ("rw-split",    "Also report the statistics of reads and writes apart")
+    ("req-types",   "Request types of GPGPU-Sim traces to compress [global,local,const,texture,inst,l1wb,l2wb]. Default=global", cxxopts::value<std::string>())
+    ("parse-thread", "Parse .txt traces on a separate thread")
+    ("sweep",       "Run many configs in a single pass over the trace: comma-separated directories, globs or files of configs and grids", cxxopts::value<std::string>())
+    ("batch",       "Run each of many traces in place of -i: comma-separated globs, files, or @<file> listing them", cxxopts::value<std::string>())
+    ("threads",     "Threads of the sweep or the batch. Default=number of cores", cxxopts::value<unsigned>())
+    ("format",      "Format of the result files [csv/jsonl/columnar]. Default=csv", cxxopts::value<std::string>())
     ("h,help",      "Print usage");
   auto args = options.parse(argc, argv);
 
@@ -49,19 +145,121 @@ int main(int argc, char **argv)
     algorithm = args["algorithm"].as<std::string>();
   else
     algorithm = "VPC";
+  if (args.count("batch"))
+    batchSpec = args["batch"].as<std::string>();
+  else
+    batchSpec = "";
   if (args.count("input"))
     tracePath = args["input"].as<std::string>();
+  else if (batchSpec == "")
+    help = 1;
+  if (args.count("sweep"))
+    sweepSpec = args["sweep"].as<std::string>();
   else
+    sweepSpec = "";
+  if (args.count("config"))
+    configPath = args["config"].as<std::string>();
+  else if (algorithm == "VPC" && sweepSpec == "")
     help = 1;
-  if (algorithm == "VPC")
-    if (args.count("config"))
-      configPath = args["config"].as<std::string>();
-    else
-      help = 1;
+  else
+    configPath = "";
   if (args.count("output"))
     outputDirPath = args["output"].as<std::string>();
   else
     outputDirPath = "";
+  if (args.count("encode"))
+    encodePath = args["encode"].as<std::string>();
+  else
+    encodePath = "";
+  if (args.count("line-output"))
+    lineOutputPath = args["line-output"].as<std::string>();
+  else
+    lineOutputPath = "";
+  if (args.count("window"))
+  {
+    windowSpec = args["window"].as<std::string>();
+    std::vector<std::string> splitWindowSpec = strutil::split(windowSpec, ":");
+    if (splitWindowSpec[0] == "kernel" && splitWindowSpec.size() == 1)
+      windowType = WINDOW_KERNEL;
+    else if (splitWindowSpec[0] == "cycle" && splitWindowSpec.size() == 2)
+      windowType = WINDOW_CYCLE;
+    else if (splitWindowSpec[0] == "line" && splitWindowSpec.size() == 2)
+      windowType = WINDOW_LINE;
+    if (windowType == WINDOW_CYCLE || windowType == WINDOW_LINE)
+      windowSize = std::stoull(splitWindowSpec[1]);
+    if (windowType == WINDOW_NONE || (windowType != WINDOW_KERNEL && windowSize == 0))
+    {
+      printf("Invalid window! \"%s\" is not one of kernel, cycle:<N> and line:<N>.\n", windowSpec.c_str());
+      exit(1);
+    }
+  }
+  regionSize = args.count("region") ? args["region"].as<uint64_t>() : 0;
+  numTopRegions = args.count("region-top") ? args["region-top"].as<unsigned>() : 16;
+  isRWSplit = args.count("rw-split");
+  isEntropy = args.count("entropy");
+  if (args.count("burst"))
+  {
+    for (std::string &burstSize : strutil::split(args["burst"].as<std::string>(), ","))
+      burstSizes.push_back(std::stoul(burstSize));
+  }
+  burstMetadataBits = args.count("burst-metadata") ? args["burst-metadata"].as<unsigned>() : 0;
+  cacheSpec = args.count("cache") ? args["cache"].as<std::string>() : "";
+  isDRAM = args.count("dram") || args.count("dram-config");
+  if (args.count("dram-config"))
+    dramConfig.Parse(readJSON(args["dram-config"].as<std::string>()));
+  memoEntries = args.count("memo") ? args["memo"].as<uint64_t>() : 0;
+  if (args.count("memo") && memoEntries == 0)
+  {
+    printf("Invalid memo! The cache has at least a line.\n");
+    exit(1);
+  }
+  if (args.count("req-types"))
+  {
+    reqTypeMask = 0;
+    for (std::string &name : strutil::split(args["req-types"].as<std::string>(), ","))
+    {
+      auto it = std::find_if(std::begin(REQ_TYPE_NAMES), std::end(REQ_TYPE_NAMES),
+          [&](const std::pair<const char*, unsigned> &reqType) { return name == reqType.first; });
+      if (it == std::end(REQ_TYPE_NAMES))
+      {
+        printf("Invalid request type! \"%s\" is not one of global, local, const, texture, inst, l1wb and l2wb.\n", name.c_str());
+        exit(1);
+      }
+      reqTypeMask |= it->second;
+    }
+  }
+  asyncParsing = args.count("parse-thread");
+  if (args.count("format"))
+  {
+    std::string format = args["format"].as<std::string>();
+    if (format == "jsonl")
+      outputFormat = comp::RECORD_JSONL;
+    else if (format == "columnar")
+      outputFormat = comp::RECORD_COLUMNAR;
+    else if (format != "csv")
+    {
+      printf("Invalid format! \"%s\" is not one of csv, jsonl and columnar.\n", format.c_str());
+      exit(1);
+    }
+  }
+  numThreads = args.count("threads") ? args["threads"].as<unsigned>() : std::thread::hardware_concurrency();
+  if (sweepSpec != "" && (configPath != "" || encodePath != "" || lineOutputPath != "" || windowType != WINDOW_NONE
+        || regionSize != 0 || isEntropy || !burstSizes.empty() || cacheSpec != "" || isDRAM || memoEntries != 0 || isRWSplit))
+  {
+    printf("Invalid options! --sweep runs without -c, -e, -w, --line-output, --region, --entropy, --burst, --cache, --dram, --memo and --rw-split.\n");
+    exit(1);
+  }
+  if (batchSpec != "" && (tracePath != "" || encodePath != "" || lineOutputPath != "" || sweepSpec != ""
+        || algorithm == "VIEWER"))
+  {
+    printf("Invalid options! --batch runs without -i, -e, --line-output, --sweep and VIEWER.\n");
+    exit(1);
+  }
+  if (encodePath != "" && memoEntries != 0)
+  {
+    printf("Invalid options! -e runs without --memo.\n");
+    exit(1);
+  }
 
   // help message
   if (help)
@@ -71,18 +269,244 @@ int main(int argc, char **argv)
   }
   }
 
-  // instantiates loader
-  trace::Loader *loader;
-  if (strutil::ends_with(tracePath, ".log"))
-    loader = new trace::gpgpusim::LoaderGPGPU(tracePath);
-  else if (strutil::ends_with(tracePath, ".npy"))
-    loader = new trace::LoaderNPY(tracePath);
-  else if (strutil::ends_with(tracePath, ".txt"))
-    loader = new trace::apsim::LoaderGPGPU(tracePath, REQ_SIZE);
-  else
-    assert(false && "Unsupported extension.");
+  // a whole run of a trace, the results are printed through writer if given
+  // extension of the result files
+  const char *extension = comp::RecordWriter::GetExtension(outputFormat);
+
+  auto runTrace = [&](std::string tracePath, batch::ResultWriter *writer) {
+    // instantiates loader
+    trace::Loader *loader;
+    if (strutil::ends_with(tracePath, ".log"))
+      loader = new trace::gpgpusim::LoaderGPGPU(tracePath);
+    else if (strutil::ends_with(tracePath, ".npy"))
+      loader = new trace::LoaderNPY(tracePath);
+    else if (strutil::ends_with(tracePath, ".txt"))
+      loader = new trace::apsim::LoaderGPGPU(tracePath, REQ_SIZE, asyncParsing);
+    else if (strutil::ends_with(tracePath, ".syn"))
+      loader = new trace::LoaderSynthetic(tracePath);
+    else
+      assert(false && "Unsupported extension.");
+
+    // name of the workload
+    std::string workloadName;
+    {
+      std::string benchmarkName;
+      std::string appName;
+      std::vector<std::string> splitTracePath = strutil::split(tracePath, "/");
+
+      benchmarkName = splitTracePath[splitTracePath.size() - 2];
+      appName = splitTracePath[splitTracePath.size() - 1];
+
+      // remove extension
+      strutil::replace_all(appName, ".log", "");
+      strutil::replace_all(appName, ".npy", "");
+      strutil::replace_all(appName, ".txt", "");
+      strutil::replace_all(appName, ".syn", "");
+
+      workloadName = fmt::format("{0}_{1}", benchmarkName, appName);
+    }
+
+    if (algorithm == "VIEWER")
+    {
+      viewLines(loader);
+      delete loader;
+      return;
+    }
 
-  // instantiates compressor
+    // sweep, all the configs in a single pass over the trace
+    if (sweepSpec != "")
+    {
+      std::vector<sweep::SweepConfig> configs = sweep::ExpandSweep(sweepSpec, algorithm);
+      std::vector<comp::Compressor*> compressors;
+      for (sweep::SweepConfig &config : configs)
+        compressors.push_back(newCompressor(config.Algorithm, config.Path, config.Config, loader));
+
+      sweep::SweepRunner runner(compressors, numThreads);
+      runner.Run(loader, reqTypeMask);
+      for (unsigned c = 0; c < configs.size(); c++)
+        std::cout << fmt::format("comp.ratio ({} {}): {}", configs[c].Algorithm, configs[c].Name,
+            compressors[c]->GetResult()->CompRatio) << std::endl;
+      runner.Print(configs, workloadName, outputDirPath + fmt::format("/sweep_results.{}", extension));
+      PROFILE_PRINT(workloadName, outputDirPath + fmt::format("/sweep_profile.{}", extension));
+
+      for (comp::Compressor *compressor : compressors)
+        delete compressor;
+      delete loader;
+      return;
+    }
+
+    // the trace has to carry what the windows, the DRAM model, the caches and the regions need,
+    // a trace of a batch that does not is skipped
+    std::string invalid = (encodePath == "") ? checkTrace(loader, windowType, isDRAM, cacheSpec != "", regionSize != 0) : "";
+    if (invalid != "")
+    {
+      delete loader;
+      if (writer == nullptr)
+      {
+        printf("%s.\n", invalid.c_str());
+        exit(1);
+      }
+      writer->Submit([=]() { printf("%s, %s is skipped.\n", invalid.c_str(), workloadName.c_str()); });
+      return;
+    }
+
+    // instantiates compressor
+    comp::Compressor *compressor = newCompressor(algorithm, configPath,
+        (algorithm == "VPC" || configPath == "") ? Json::Value() : readJSON(configPath), loader);
+
+    // results file
+    std::string saveFileName;
+    if (algorithm == "VPC")
+      saveFileName = parseConfig(configPath);
+    else if (configPath != "")
+      saveFileName = algorithm + "_" + parseConfig(configPath);
+    else
+      saveFileName = algorithm;
+    std::string compOutputSavePath = outputDirPath + fmt::format("/{}_results.{}", saveFileName, extension);
+    std::string compDetailedOutputSavePath = outputDirPath + fmt::format("/{}_results_detail.{}", saveFileName, extension);
+    std::string profileOutputSavePath = outputDirPath + fmt::format("/{}_profile.{}", saveFileName, extension);
+    std::string codecOutputSavePath = outputDirPath + fmt::format("/{}_codec.{}", saveFileName, extension);
+    std::string windowOutputSavePath = outputDirPath + fmt::format("/{}_windows.{}", saveFileName, extension);
+    std::string regionOutputSavePath = outputDirPath + fmt::format("/{}_regions.{}", saveFileName, extension);
+    std::string entropyOutputSavePath = outputDirPath + fmt::format("/{}_entropy.{}", saveFileName, extension);
+    std::string burstOutputSavePath = outputDirPath + fmt::format("/{}_bursts.{}", saveFileName, extension);
+    std::string cacheOutputSavePath = outputDirPath + fmt::format("/{}_cache.{}", saveFileName, extension);
+    std::string dramOutputSavePath = outputDirPath + fmt::format("/{}_dram.{}", saveFileName, extension);
+    std::string sizesOutputSavePath = outputDirPath + fmt::format("/{}_sizes.{}", saveFileName, extension);
+    std::string memoOutputSavePath = outputDirPath + fmt::format("/{}_memo.{}", saveFileName, extension);
+
+    // compress
+    comp::CompResult *compStat;
+    comp::CodecResult codecStat;
+    LineSinks sinks;
+    if (regionSize != 0)
+      sinks.Region = new comp::RegionResult(regionSize, numTopRegions);
+    if (isEntropy)
+      sinks.Entropy = new comp::EntropyResult;
+    if (!burstSizes.empty())
+      sinks.Burst = new comp::BurstResult(burstSizes, burstMetadataBits);
+    if (cacheSpec != "")
+      sinks.Cache = new comp::CacheResult(cacheSpec);
+    if (isDRAM)
+      sinks.DRAM = new comp::DRAMResult(dramConfig);
+    // lines of stateful compressors depend on the lines before, they are not memoized
+    comp::MemoCache *memo = nullptr;
+    if (memoEntries != 0)
+    {
+      if (compressor->IsMemoizable())
+        memo = new comp::MemoCache(memoEntries);
+      else
+        std::cout << fmt::format("{} is not memoizable, --memo is ignored.", compressor->GetCompressorName()) << std::endl;
+    }
+    if (encodePath == "")
+    {
+      if (lineOutputPath != "")
+        sinks.Lines = new comp::LineSink(lineOutputPath);
+      compStat = compressLines(compressor, loader, sinks, windowType, windowSize, memo, reqTypeMask, isRWSplit);
+      delete sinks.Lines;
+    }
+    else
+      compStat = encodeLines(compressor, loader, encodePath, codecStat, reqTypeMask);
+
+    // print, on the writer of the batch if any
+    auto print = [=]() mutable {
+      // runs of a batch tell their workload apart
+      std::cout << fmt::format("{}comp.ratio: {}", (writer == nullptr) ? "" : workloadName + " ", compStat->CompRatio) << std::endl;
+
+      // results are printed through their own (virtual) printers
+      compStat->Print(workloadName, compOutputSavePath);
+      compStat->PrintDetail(workloadName, compDetailedOutputSavePath);
+      if (compStat->Sizes.Count != 0)
+        compStat->PrintSizes(workloadName, sizesOutputSavePath);
+      if (isRWSplit && encodePath == "")
+      {
+        // each class of lines is a row of the workload suffixed by the class
+        for (int rw = 0; rw < NUM_RW; rw++)
+        {
+          comp::CompResult *stat = compressor->GetResult((trace::rw_t)rw);
+          if (stat == nullptr)
+            continue;
+          std::string name = fmt::format("{}:{}", workloadName, RW_NAMES[rw]);
+          std::cout << fmt::format("comp.ratio ({}): {}", RW_NAMES[rw], stat->CompRatio) << std::endl;
+          stat->Print(name, compOutputSavePath);
+          stat->PrintDetail(name, compDetailedOutputSavePath);
+          if (stat->Sizes.Count != 0)
+            stat->PrintSizes(name, sizesOutputSavePath);
+        }
+      }
+      if (encodePath != "")
+      {
+        std::cout << fmt::format("encoded: {} lines, {} bits ({} reported), {} size mismatches, {} round-trip errors",
+            codecStat.NumLines, codecStat.EncodedBits, codecStat.ReportedBits,
+            codecStat.NumSizeMismatches, codecStat.NumRoundTripErrors) << std::endl;
+        codecStat.Print(workloadName, codecOutputSavePath);
+      }
+      if (windowType != WINDOW_NONE)
+        compStat->PrintWindows(workloadName, windowSpec, windowOutputSavePath);
+      if (sinks.Region != nullptr)
+      {
+        sinks.Region->Print(workloadName, regionOutputSavePath);
+        delete sinks.Region;
+      }
+      if (sinks.Entropy != nullptr)
+      {
+        sinks.Entropy->Print(workloadName, entropyOutputSavePath);
+        delete sinks.Entropy;
+      }
+      if (sinks.Burst != nullptr)
+      {
+        sinks.Burst->Print(workloadName, burstOutputSavePath);
+        delete sinks.Burst;
+      }
+      if (sinks.Cache != nullptr)
+      {
+        sinks.Cache->Print(workloadName, cacheOutputSavePath);
+        delete sinks.Cache;
+      }
+      if (sinks.DRAM != nullptr)
+      {
+        sinks.DRAM->Print(workloadName, dramOutputSavePath);
+        delete sinks.DRAM;
+      }
+      if (memo != nullptr)
+      {
+        std::cout << fmt::format("memo.hit_rate: {}", memo->GetHitRate()) << std::endl;
+        memo->Print(workloadName, memoOutputSavePath);
+        delete memo;
+      }
+
+      delete loader;
+      delete compressor;
+    };
+    if (writer == nullptr)
+    {
+      print();
+      PROFILE_PRINT(workloadName, profileOutputSavePath);
+    }
+    else
+      writer->Submit(print);
+  };
+
+  if (batchSpec == "")
+  {
+    runTrace(tracePath, nullptr);
+    return 0;
+  }
+
+  // batch, the largest traces first
+  std::vector<std::string> tracePaths = batch::ExpandTraces(batchSpec);
+  batch::ResultWriter writer;
+  batch::BatchRunner runner(numThreads);
+  runner.Run(tracePaths.size(), [&](unsigned i) { runTrace(tracePaths[i], &writer); });
+  writer.Close();
+  PROFILE_PRINT("batch", outputDirPath + fmt::format("/batch_profile.{}", extension));
+  return 0;
+}
+
+// the compressor of the algorithm, VPC reads configPath, the others take the parsed config (null for defaults)
+comp::Compressor* newCompressor(std::string algorithm, std::string configPath, const Json::Value &config,
+    trace::Loader *loader)
+{
   const unsigned lineSize = loader->GetCachelineSize();
   comp::Compressor *compressor;
   if (algorithm == "VPC")
@@ -91,162 +515,327 @@ int main(int argc, char **argv)
   }
   else if (algorithm == "FPC")
   {
-    compressor = new comp::FPC(lineSize);
+    compressor = new comp::FPC(lineSize, config);
   }
   else if (algorithm == "BDI")
   {
-    compressor = new comp::BDI(lineSize);
+    compressor = new comp::BDI(lineSize, config);
   }
   else if (algorithm == "BPC")
   {
-    compressor = new comp::BPC(lineSize);
+    compressor = new comp::BPC(lineSize, config);
   }
   else if (algorithm == "CPACK")
   {
-    compressor = new comp::CPACK(lineSize);
+    compressor = new comp::CPACK(lineSize, config);
   }
   else if (algorithm == "SC2")
   {
     unsigned long long numLines = loader->GetNumLines();
     unsigned long long samplingCnts = std::min<unsigned long long>(numLines/100, WARM_UP_CNT);
     samplingCnts = std::max<unsigned long long>(10000, samplingCnts);
-    compressor = new comp::SC2(lineSize, samplingCnts);
+    compressor = new comp::SC2(lineSize, samplingCnts, config);
   }
   else if (algorithm == "PATTERN")
   {
     compressor = new comp::Pattern(lineSize);
   }
-  else if (algorithm == "VIEWER")
-  {
-    viewLines(loader);
-    return 0;
-  }
   else
   {
     assert(false && "Invalid name of algorithm.");
   }
 
-  // results file
-  std::string saveFileName;
-  if (algorithm == "VPC")
-    saveFileName = parseConfig(configPath);
-  else
-    saveFileName = algorithm;
-  std::string compOutputSavePath = outputDirPath + fmt::format("/{}_results.csv", saveFileName);;
-  std::string compDetailedOutputSavePath = outputDirPath + fmt::format("/{}_results_detail.csv", saveFileName);
-
-  // compress
-  comp::CompResult *compStat = compressLines(compressor, loader);
+  return compressor;
+}
 
-  // print
-  std::string workloadName;
+comp::CompResult* compressLines(comp::Compressor *compressor, trace::Loader *loader, const LineSinks &sinks,
+    WindowType windowType, uint64_t windowSize, comp::MemoCache *memo, unsigned reqTypeMask, bool isRWSplit)
+{
+  // check which loader is passed,
+  // and init MemReq_t
+  trace::MemReq_t *memReq;
+  bool isGPGPUSim = false;
+  bool isAPSim = false;
+  if (dynamic_cast<trace::gpgpusim::LoaderGPGPU*>(loader) != nullptr)
   {
-    std::string benchmarkName;
-    std::string appName;
-    std::vector<std::string> splitTracePath = strutil::split(tracePath, "/");
+    memReq = new trace::gpgpusim::MemReqGPU_t;
+    isGPGPUSim = true;
+  }
+  else if (dynamic_cast<trace::apsim::LoaderGPGPU*>(loader) != nullptr)
+  {
+    memReq = new trace::apsim::MemReqGPU_t;
+    isAPSim = true;
+  }
+  else
+    memReq = new trace::MemReq_t;
 
-    benchmarkName = splitTracePath[splitTracePath.size() - 2];
-    appName = splitTracePath[splitTracePath.size() - 1];
 
-    // remove extension
-    strutil::replace_all(appName, ".log", "");
-    strutil::replace_all(appName, ".npy", "");
-    strutil::replace_all(appName, ".txt", "");
+  if (isRWSplit)
+    compressor->SplitResult();
 
-    workloadName = fmt::format("{0}_{1}", benchmarkName, appName);
-  }
-  std::cout << fmt::format("comp.ratio: {}", compStat->CompRatio) << std::endl;
+  // lines are gathered into a batch of equal-sized lines of the same read/write class,
+  // and the batch is compressed at once
+  unsigned batchLineSize = 0;
+  trace::rw_t batchRW = trace::NA;
+  unsigned numBatchedLines = 0;
+  std::vector<uint8_t> batch;
+  std::vector<unsigned> compSizes(BATCH_LINES);
+  std::vector<int> selected(BATCH_LINES);
+  // window, cycle and address of each line in the batch
+  uint64_t numLines = 0;
+  std::vector<uint64_t> windows(BATCH_LINES);
+  std::vector<uint64_t> cycles(BATCH_LINES);
+  std::vector<addr_t> addrs(BATCH_LINES);
+  std::vector<comp::DRAMRequest> dramRequests(BATCH_LINES);
+  auto compressBatch = [&]() {
+    compressor->SelectResult(batchRW);
+    int *batchSelected = (sinks.Lines == nullptr) ? nullptr : selected.data();
+    if (memo == nullptr)
+      compressor->CompressLines(batch.data(), numBatchedLines, batchLineSize, compSizes.data(), batchSelected);
+    else
+      memo->CompressLines(compressor, batch.data(), numBatchedLines, batchLineSize, compSizes.data(), batchSelected);
+    if (sinks.Lines != nullptr)
+      sinks.Lines->AppendBatch(compSizes.data(), selected.data(), numBatchedLines);
+    if (windowType != WINDOW_NONE)
+    {
+      comp::CompResult *compStat = compressor->GetResult();
+      for (unsigned i = 0; i < numBatchedLines; i++)
+        compStat->UpdateWindow(windows[i], cycles[i], BYTE * batchLineSize, compSizes[i]);
+    }
+    if (sinks.Region != nullptr)
+    {
+      for (unsigned i = 0; i < numBatchedLines; i++)
+        sinks.Region->Update(addrs[i], BYTE * batchLineSize, compSizes[i]);
+    }
+    if (sinks.Entropy != nullptr)
+    {
+      for (unsigned i = 0; i < numBatchedLines; i++)
+        sinks.Entropy->Update(batch.data() + i * batchLineSize, batchLineSize);
+    }
+    if (sinks.Burst != nullptr)
+      sinks.Burst->UpdateBatch(BYTE * batchLineSize, compSizes.data(), numBatchedLines);
+    if (sinks.Cache != nullptr)
+    {
+      for (unsigned i = 0; i < numBatchedLines; i++)
+        sinks.Cache->Update(addrs[i], BYTE * batchLineSize, compSizes[i]);
+    }
+    if (sinks.DRAM != nullptr)
+    {
+      for (unsigned i = 0; i < numBatchedLines; i++)
+        sinks.DRAM->Update(dramRequests[i], BYTE * batchLineSize, compSizes[i]);
+    }
+  };
 
-  if (algorithm == "VPC")
-  {
-    comp::VPCResult *stat = static_cast<comp::VPCResult*>(compStat);
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
-  }
-  else if (algorithm == "FPC")
-  {
-    comp::FPCResult *stat = static_cast<comp::FPCResult*>(compStat);
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
-  }
-  else if (algorithm == "BDI")
-  {
-    comp::BDIResult *stat = static_cast<comp::BDIResult*>(compStat);
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
-  }
-  else if (algorithm == "CPACK")
-  {
-    comp::CPACKResult *stat = static_cast<comp::CPACKResult*>(compStat);
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
-  }
-  else if (algorithm == "BPC")
-  {
-    comp::BPCResult *stat = static_cast<comp::BPCResult*>(compStat);
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
-  }
-  else if (algorithm == "PATTERN")
-  {
-    comp::PatternResult *stat = static_cast<comp::PatternResult*>(compStat);
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
-  }
-  else 
+  // compress
+  while (1)
   {
-		comp::CompResult *stat = compStat;
-    stat->Print(workloadName, compOutputSavePath);
-    stat->PrintDetail(workloadName, compDetailedOutputSavePath);
+    {
+      PROFILE_SCOPE(LOADER_DECODE);
+      memReq = loader->GetCacheline(memReq);
+    }
+    if (memReq->isEnd) break;
+    if (isGPGPUSim
+        && !(reqTypeMask & (1u << static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->reqType)))
+      continue;
+    std::vector<uint8_t> &dataLine = memReq->data;
+
+    // flush the batch when the line size, or the read/write class if split, changes
+    if (dataLine.size() != batchLineSize || (isRWSplit && memReq->rw != batchRW))
+    {
+      if (numBatchedLines != 0)
+        compressBatch();
+      numBatchedLines = 0;
+      batchLineSize = dataLine.size();
+      batchRW = memReq->rw;
+      batch.resize(BATCH_LINES * batchLineSize);
+    }
+
+    std::copy(dataLine.begin(), dataLine.end(), batch.begin() + numBatchedLines * batchLineSize);
+    if (windowType != WINDOW_NONE)
+    {
+      uint64_t cycle = 0;
+      if (isGPGPUSim)
+        cycle = static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->cycle;
+      else if (isAPSim)
+        cycle = static_cast<trace::apsim::MemReqGPU_t*>(memReq)->cycle;
+
+      cycles[numBatchedLines] = cycle;
+      if (windowType == WINDOW_KERNEL)
+        windows[numBatchedLines] = static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->kernelID;
+      else if (windowType == WINDOW_CYCLE)
+        windows[numBatchedLines] = cycle / windowSize;
+      else
+        windows[numBatchedLines] = numLines / windowSize;
+    }
+    addrs[numBatchedLines] = memReq->addr;
+    if (sinks.DRAM != nullptr)
+    {
+      trace::gpgpusim::MemReqGPU_t *memReqGPU = static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq);
+      dramRequests[numBatchedLines] = { memReqGPU->cycle, memReqGPU->chip, memReqGPU->bank, memReqGPU->row, 0, { 0, 0 } };
+    }
+    numLines++;
+    numBatchedLines++;
+    if (numBatchedLines == BATCH_LINES)
+    {
+      compressBatch();
+      numBatchedLines = 0;
+    }
   }
+  if (numBatchedLines != 0)
+    compressBatch();
+  delete memReq;
+  compressor->MergeResults();
 
-  delete loader;
-  delete compressor;
-  return 0;
+  comp::CompResult *compStat = compressor->GetResult();
+  return compStat;
 }
 
-comp::CompResult* compressLines(comp::Compressor *compressor, trace::Loader *loader)
+comp::CompResult* encodeLines(comp::Compressor *compressor, trace::Loader *loader,
+    std::string encodePath, comp::CodecResult &codecStat, unsigned reqTypeMask)
 {
+  if (!compressor->IsDecodable())
+  {
+    std::cout << fmt::format("{} can not be decoded as configured.", compressor->GetCompressorName()) << std::endl;
+    exit(1);
+  }
+
   // check which loader is passed,
   // and init MemReq_t
   trace::MemReq_t *memReq;
+  bool isGPGPUSim = false;
   if (dynamic_cast<trace::gpgpusim::LoaderGPGPU*>(loader) != nullptr)
   {
     memReq = new trace::gpgpusim::MemReqGPU_t;
-
-    // compress
+    isGPGPUSim = true;
+  }
+  else if (dynamic_cast<trace::apsim::LoaderGPGPU*>(loader) != nullptr)
+    memReq = new trace::apsim::MemReqGPU_t;
+  else
+    memReq = new trace::MemReq_t;
+  auto getNextLine = [&]() -> bool {
     while (1)
     {
       memReq = loader->GetCacheline(memReq);
-      if (memReq->isEnd) break;
-      if (!(static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->reqType == trace::gpgpusim::GLOBAL_ACC_R
-            || static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->reqType == trace::gpgpusim::GLOBAL_ACC_W))
+      if (memReq->isEnd)
+        return false;
+      if (isGPGPUSim
+          && !(reqTypeMask & (1u << static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->reqType)))
         continue;
-      std::vector<uint8_t> &dataLine = memReq->data;
-      compressor->CompressLine(dataLine);
+      return true;
     }
+  };
+
+  // header: magic, line size, number of lines, number of bits
+  const unsigned lineSize = compressor->GetResult()->LineSize;
+  const char magic[4] = { 'M', 'P', 'C', 'Z' };
+  uint64_t numLines = 0;
+  uint64_t numBits = 0;
+
+  std::ofstream file(encodePath, std::ios_base::out | std::ios_base::binary);
+  if (!file.is_open())
+  {
+    std::cout << fmt::format("File is not open: \"{}\"", encodePath) << std::endl;
+    exit(1);
   }
-  else
+  file.write(magic, 4);
+  file.write(reinterpret_cast<const char*>(&lineSize), sizeof(lineSize));
+  file.write(reinterpret_cast<const char*>(&numLines), sizeof(numLines));
+  file.write(reinterpret_cast<const char*>(&numBits), sizeof(numBits));
+
+  // encode, lines of other sizes are skipped
+  comp::BitWriter writer;
+  while (getNextLine())
   {
-    if (dynamic_cast<trace::apsim::LoaderGPGPU*>(loader) != nullptr)
-      memReq = new trace::apsim::MemReqGPU_t;
-    else if (dynamic_cast<trace::LoaderNPY*>(loader) != nullptr)
-      memReq = new trace::MemReq_t;
+    std::vector<uint8_t> &dataLine = memReq->data;
+    if (dataLine.size() != lineSize)
+    {
+      codecStat.NumSkippedLines++;
+      continue;
+    }
 
-    // compress
-    while (1)
+    uint64_t startBits = writer.GetNumBits();
+    auto start = std::chrono::steady_clock::now();
+    unsigned reportedSize = compressor->EncodeLine(dataLine, writer);
+    auto end = std::chrono::steady_clock::now();
+    codecStat.EncodeSeconds += std::chrono::duration<double>(end - start).count();
+
+    uint64_t encodedSize = writer.GetNumBits() - startBits;
+    codecStat.ReportedBits += reportedSize;
+    codecStat.NumSizeMismatches += (encodedSize != reportedSize);
+    numLines++;
+
+    if (writer.GetBuffer().size() >= (1 << 20))
+      writer.Flush(file);
+  }
+  numBits = writer.GetNumBits();
+  writer.Flush(file, true);
+  file.seekp(4 + sizeof(lineSize));
+  file.write(reinterpret_cast<const char*>(&numLines), sizeof(numLines));
+  file.write(reinterpret_cast<const char*>(&numBits), sizeof(numBits));
+  file.close();
+
+  codecStat.NumLines = numLines;
+  codecStat.EncodedBits = numBits;
+
+  // decode the file and compare it with the trace
+  {
+    std::ifstream inFile(encodePath, std::ios_base::in | std::ios_base::binary);
+    char inMagic[4];
+    unsigned inLineSize;
+    uint64_t inNumLines, inNumBits;
+    inFile.read(inMagic, 4);
+    inFile.read(reinterpret_cast<char*>(&inLineSize), sizeof(inLineSize));
+    inFile.read(reinterpret_cast<char*>(&inNumLines), sizeof(inNumLines));
+    inFile.read(reinterpret_cast<char*>(&inNumBits), sizeof(inNumBits));
+    assert(std::equal(magic, magic + 4, inMagic) && inLineSize == lineSize && inNumLines == numLines);
+
+    comp::BitReader reader(&inFile, inNumBits);
+    std::vector<uint8_t> decodedLine(lineSize);
+    loader->Reset();
+    while (getNextLine())
     {
-      memReq = loader->GetCacheline(memReq);
-      if (memReq->isEnd) break;
       std::vector<uint8_t> &dataLine = memReq->data;
-      compressor->CompressLine(dataLine);
+      if (dataLine.size() != lineSize)
+        continue;
+
+      auto start = std::chrono::steady_clock::now();
+      bool isValid = compressor->DecodeLine(reader, decodedLine);
+      auto end = std::chrono::steady_clock::now();
+      codecStat.DecodeSeconds += std::chrono::duration<double>(end - start).count();
+
+      codecStat.NumRoundTripErrors += (!isValid || decodedLine != dataLine);
     }
+    if (reader.GetPosition() != inNumBits)
+      std::cout << fmt::format("{} bits are left undecoded.", (int64_t)inNumBits - (int64_t)reader.GetPosition()) << std::endl;
   }
+  delete memReq;
 
   comp::CompResult *compStat = compressor->GetResult();
   return compStat;
 }
 
+// the reason the trace can not be compressed with the windows, the DRAM model, the caches and the regions,
+// empty if it can
+std::string checkTrace(trace::Loader *loader, WindowType windowType, bool isDRAM, bool isCache, bool isRegion)
+{
+  const bool isGPGPUSim = dynamic_cast<trace::gpgpusim::LoaderGPGPU*>(loader) != nullptr;
+  const bool isAPSim = dynamic_cast<trace::apsim::LoaderGPGPU*>(loader) != nullptr;
+  // APSim and NPY lines all come at address 0
+  const bool hasAddresses = isGPGPUSim || dynamic_cast<trace::LoaderSynthetic*>(loader) != nullptr;
+
+  // kernel IDs come with GPGPU-Sim traces only, cycles with APSim traces too
+  if ((windowType == WINDOW_KERNEL && !isGPGPUSim)
+      || (windowType == WINDOW_CYCLE && !isGPGPUSim && !isAPSim))
+    return fmt::format("Invalid window! The trace has no {}", (windowType == WINDOW_KERNEL) ? "kernel IDs" : "cycles");
+  if (isDRAM && !isGPGPUSim)
+    return "Invalid DRAM model! The trace has no DRAM coordinates";
+  if (isCache && !hasAddresses)
+    return "Invalid cache! The trace has no addresses";
+  if (isRegion && !hasAddresses)
+    return "Invalid region! The trace has no addresses";
+  return "";
+}
+
 void viewLines(trace::Loader *loader)
 {
   trace::MemReq_t *memReq;
@@ -281,7 +870,7 @@ void viewLines(trace::Loader *loader)
   {
     if (dynamic_cast<trace::apsim::LoaderGPGPU*>(loader) != nullptr)
       memReq = new trace::apsim::MemReqGPU_t;
-    else if (dynamic_cast<trace::LoaderNPY*>(loader) != nullptr)
+    else
       memReq = new trace::MemReq_t;
 
     // compress
@@ -0,0 +1,192 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include <fmt/core.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "utils.h"
+#include "compressor/RecordWriter.h"
+
+// Hot-path profiler.
+// It accumulates cycles and calls per pipeline stage and per PredCompModule.
+// Build with PROFILE=1 to enable it, otherwise the PROFILE_* macros are compiled out.
+
+namespace prof
+{
+
+enum Stage
+{
+  LOADER_DECODE = 0,
+  ALLZERO,
+  ALLWORDSAME,
+  PREDICTION,
+  RESIDUE,
+  BITPLANE,
+  XOR,
+  SCAN,
+  FPC_ENCODE,
+  RESIDUE_STAT,
+  NUM_STAGES,
+};
+
+static const char *STAGE_NAMES[NUM_STAGES] = {
+  "loader_decode", "allzero", "allwordsame",
+  "prediction", "residue", "bitplane", "xor", "scan",
+  "fpc_encode", "residue_stat",
+};
+
+// slot 0 is for the stages not bound to any module
+#define PROF_MAX_MODULES 64
+
+struct StageStat
+{
+  uint64_t cycles;
+  uint64_t calls;
+};
+
+struct StageTable
+{
+  StageStat stats[NUM_STAGES][PROF_MAX_MODULES + 1] = {};
+};
+
+class Profiler
+{
+public:
+  static Profiler &Get()
+  {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  // cycles from the time-stamp counter, or nanoseconds where it is not available
+  static inline uint64_t Now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // current PredCompModule of this thread, -1 if none
+  static int &CurrentModule()
+  {
+    static thread_local int currentModule = -1;
+    return currentModule;
+  }
+
+  inline void Add(int stage, int module, uint64_t cycles)
+  {
+    StageStat &stat = getTable().stats[stage][module + 1];
+    stat.cycles += cycles;
+    stat.calls++;
+  }
+
+  void Print(std::string workloadName = "", std::string filePath = "")
+  {
+    // merge tables of all threads
+    StageTable merged;
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      for (StageTable *table : m_Tables)
+        for (int s = 0; s < NUM_STAGES; s++)
+          for (int m = 0; m < PROF_MAX_MODULES + 1; m++)
+          {
+            merged.stats[s][m].cycles += table->stats[s][m].cycles;
+            merged.stats[s][m].calls += table->stats[s][m].calls;
+          }
+    }
+
+    comp::RecordWriter writer(filePath);
+    writer.Header("workload,stage,module,calls,cycles,cycles_per_call,");
+
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+      for (int m = 0; m < PROF_MAX_MODULES + 1; m++)
+      {
+        StageStat &stat = merged.stats[s][m];
+        if (stat.calls == 0)
+          continue;
+        writer.Field("workload", workloadName);
+        writer.Field("stage", STAGE_NAMES[s]);
+        writer.Field("module", m - 1);
+        writer.Field("calls", stat.calls);
+        writer.Field("cycles", stat.cycles);
+        writer.Field("cycles_per_call", (double)stat.cycles / (double)stat.calls);
+        writer.EndRow();
+      }
+    }
+  }
+
+private:
+  // every thread accumulates into its own table
+  StageTable &getTable()
+  {
+    static thread_local StageTable *table = nullptr;
+    if (table == nullptr)
+    {
+      table = new StageTable;
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Tables.push_back(table);
+    }
+    return *table;
+  }
+
+  std::mutex m_Mutex;
+  std::vector<StageTable*> m_Tables;
+};
+
+class ScopedTimer
+{
+public:
+  ScopedTimer(int stage)
+    : m_Stage(stage), m_Start(Profiler::Now()) {}
+  ~ScopedTimer()
+  {
+    Profiler::Get().Add(m_Stage, Profiler::CurrentModule(), Profiler::Now() - m_Start);
+  }
+
+private:
+  int m_Stage;
+  uint64_t m_Start;
+};
+
+class ModuleScope
+{
+public:
+  ModuleScope(int module)
+    : m_Prev(Profiler::CurrentModule())
+  {
+    Profiler::CurrentModule() = (module < PROF_MAX_MODULES) ? module : -1;
+  }
+  ~ModuleScope() { Profiler::CurrentModule() = m_Prev; }
+
+private:
+  int m_Prev;
+};
+
+}
+
+#ifdef PROFILE
+#define PROFILE_SCOPE(stage) prof::ScopedTimer __profTimer##stage(prof::stage)
+#define PROFILE_MODULE(module) prof::ModuleScope __profModule(module)
+#define PROFILE_PRINT(workloadName, filePath) prof::Profiler::Get().Print(workloadName, filePath)
+#else
+#define PROFILE_SCOPE(stage)
+#define PROFILE_MODULE(module)
+#define PROFILE_PRINT(workloadName, filePath)
+#endif
+
+#endif  // __PROFILER_H__
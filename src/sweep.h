@@ -0,0 +1,323 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <glob.h>
+#include <sys/stat.h>
+
+#include <fmt/core.h>
+#include <strutil.h>
+#include <json/json.h>
+
+#include "utils.h"
+#include "compressor/Compressor.h"
+#include "loader/Loader.h"
+#include "loader/LoaderGPGPU.h"
+#include "profiler.h"
+
+// lines of a chunk of the trace, shared by all the compressors of a sweep
+#define SWEEP_CHUNK_LINES (1 << 16)
+// chunks in flight, a compressor may run this many chunks ahead of the slowest one
+#define SWEEP_NUM_CHUNKS 4
+// lines compressed at once, as in a single run
+#define SWEEP_BATCH_LINES 4096
+
+// Parameter sweep: many configurations compressing the same trace in a single pass.
+// The trace is decoded once into chunks, and every compressor runs over each chunk on a pool of threads.
+
+namespace sweep
+{
+
+// a configuration of the sweep, Config is the parsed file or a point of a grid
+struct SweepConfig
+{
+  std::string Algorithm;
+  std::string Name;
+  std::string Path;         // file of the configuration, "" for grid points
+  Json::Value Config;
+};
+
+// Expand the comma-separated spec into configurations.
+// Each item is a directory (all its .json files), a glob pattern, or a .json file.
+// A file is a configuration of its "algorithm" (defaultAlgorithm if not given),
+// or a grid if it has "grid", the cartesian product of the values of each parameter, e.g.
+//   { "algorithm": "CPACK", "grid": { "dict_entries": [8, 16, 32] } }
+// Values of a grid are lists, so a list-valued parameter is given as a list of lists.
+static std::vector<SweepConfig> ExpandSweep(const std::string &spec, const std::string &defaultAlgorithm)
+{
+  std::vector<std::string> paths;
+  for (std::string &item : strutil::split(spec, ","))
+  {
+    struct stat info;
+    std::string pattern = item;
+    if (stat(item.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+      pattern = item + "/*.json";
+
+    glob_t globbed;
+    if (glob(pattern.c_str(), 0, nullptr, &globbed) != 0)
+    {
+      printf("Invalid sweep! \"%s\" matches no config.\n", item.c_str());
+      exit(1);
+    }
+    for (size_t i = 0; i < globbed.gl_pathc; i++)
+      paths.push_back(globbed.gl_pathv[i]);
+    globfree(&globbed);
+  }
+
+  std::vector<SweepConfig> configs;
+  for (std::string &path : paths)
+  {
+    Json::Value root = readJSON(path);
+    std::string algorithm = root.get("algorithm", defaultAlgorithm).asString();
+    std::string name = parseConfig(path);
+    if (!root.isMember("grid"))
+    {
+      configs.push_back({ algorithm, name, path, root });
+      continue;
+    }
+
+    if (algorithm == "VPC")
+    {
+      printf("Invalid sweep! \"%s\" is a grid of VPC, which takes config files only.\n", path.c_str());
+      exit(1);
+    }
+    const Json::Value &grid = root["grid"];
+    std::vector<std::string> keys = grid.getMemberNames();
+    for (std::string &key : keys)
+    {
+      if (!grid[key].isArray() || grid[key].empty())
+      {
+        printf("Invalid sweep! \"%s\" of \"%s\" is not a non-empty list.\n", key.c_str(), path.c_str());
+        exit(1);
+      }
+    }
+
+    // odometer over the values of each key
+    std::vector<unsigned> indices(keys.size(), 0);
+    while (true)
+    {
+      SweepConfig point = { algorithm, name + ":", "", Json::Value(Json::objectValue) };
+      for (size_t k = 0; k < keys.size(); k++)
+      {
+        const Json::Value &value = grid[keys[k]][indices[k]];
+        point.Config[keys[k]] = value;
+
+        // list values are joined by '+', so that the name has no comma
+        std::string valueName;
+        if (value.isArray())
+          for (const Json::Value &elem : value)
+            valueName += (valueName.empty() ? "" : "+") + elem.asString();
+        else
+          valueName = value.asString();
+        point.Name += fmt::format("{}{}={}", (k == 0) ? "" : ";", keys[k], valueName);
+      }
+      configs.push_back(point);
+
+      size_t k = 0;
+      for (; k < keys.size(); k++)
+      {
+        if (++indices[k] < grid[keys[k]].size())
+          break;
+        indices[k] = 0;
+      }
+      if (k == keys.size())
+        break;
+    }
+  }
+  return configs;
+}
+
+// Runs the compressors of a sweep over a trace.
+// The calling thread decodes the trace into a ring of chunks,
+// and each chunk is released when every compressor has compressed it.
+// A compressor runs on one thread at a time, in the order of the chunks,
+// so that its state evolves as in a single run and its results are the same.
+class SweepRunner
+{
+  // lines of equal size, back to back in the data of the chunk
+  struct Segment
+  {
+    size_t Offset;
+    unsigned NumLines;
+    unsigned LineSize;
+  };
+  struct Chunk
+  {
+    std::vector<uint8_t> Data;
+    std::vector<Segment> Segments;
+  };
+
+public:
+  /*** constructors ***/
+  SweepRunner(std::vector<comp::Compressor*> compressors, unsigned numThreads)
+    : m_Compressors(compressors), m_NumThreads(std::max(1u, numThreads)),
+      m_Chunks(SWEEP_NUM_CHUNKS), m_NumLoaded(0), m_IsEnd(false),
+      m_Next(compressors.size(), 0), m_IsBusy(compressors.size(), false), m_Seconds(compressors.size(), 0) {}
+
+  /*** methods ***/
+  // compress every line of the loader, of the request types in reqTypeMask for GPGPU-Sim traces
+  void Run(trace::Loader *loader, unsigned reqTypeMask)
+  {
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < m_NumThreads; t++)
+      workers.emplace_back(&SweepRunner::work, this);
+
+    trace::MemReq_t *memReq;
+    const bool isGPGPUSim = (dynamic_cast<trace::gpgpusim::LoaderGPGPU*>(loader) != nullptr);
+    if (isGPGPUSim)
+      memReq = new trace::gpgpusim::MemReqGPU_t;
+    else if (dynamic_cast<trace::apsim::LoaderGPGPU*>(loader) != nullptr)
+      memReq = new trace::apsim::MemReqGPU_t;
+    else
+      memReq = new trace::MemReq_t;
+
+    bool isEnd = false;
+    while (!isEnd)
+    {
+      // wait until every compressor is done with the previous chunk of the slot
+      Chunk &chunk = m_Chunks[m_NumLoaded % SWEEP_NUM_CHUNKS];
+      {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_CondVar.wait(lock, [&]() { return m_NumLoaded < getMinNext() + SWEEP_NUM_CHUNKS; });
+      }
+
+      chunk.Data.clear();
+      chunk.Segments.clear();
+      unsigned numLines = 0;
+      while (numLines < SWEEP_CHUNK_LINES)
+      {
+        {
+          PROFILE_SCOPE(LOADER_DECODE);
+          memReq = loader->GetCacheline(memReq);
+        }
+        if (memReq->isEnd)
+        {
+          isEnd = true;
+          break;
+        }
+        if (isGPGPUSim
+            && !(reqTypeMask & (1u << static_cast<trace::gpgpusim::MemReqGPU_t*>(memReq)->reqType)))
+          continue;
+
+        std::vector<uint8_t> &dataLine = memReq->data;
+        if (chunk.Segments.empty() || chunk.Segments.back().LineSize != dataLine.size())
+          chunk.Segments.push_back({ chunk.Data.size(), 0, (unsigned)dataLine.size() });
+        chunk.Data.insert(chunk.Data.end(), dataLine.begin(), dataLine.end());
+        chunk.Segments.back().NumLines++;
+        numLines++;
+      }
+
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (numLines != 0)
+        m_NumLoaded++;
+      m_IsEnd = isEnd;
+      m_CondVar.notify_all();
+    }
+    delete memReq;
+
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+  // seconds spent by each compressor
+  double GetSeconds(unsigned c) { return m_Seconds[c]; }
+
+  // a row of each configuration, with the sizes of its compressor
+  void Print(const std::vector<SweepConfig> &configs, std::string workloadName = "", std::string filePath = "")
+  {
+    comp::RecordWriter writer(filePath);
+    writer.Header("workload,algorithm,config,original_size,compressed_size,compression_ratio,seconds,");
+
+    for (unsigned c = 0; c < m_Compressors.size(); c++)
+    {
+      comp::CompResult *stat = m_Compressors[c]->GetResult();
+      writer.Field("workload", workloadName);
+      writer.Field("algorithm", configs[c].Algorithm);
+      writer.Field("config", configs[c].Name);
+      writer.Field("original_size", stat->OriginalSize);
+      writer.Field("compressed_size", stat->CompressedSize);
+      writer.Field("compression_ratio", stat->CompRatio);
+      writer.Field("seconds", m_Seconds[c]);
+      writer.EndRow();
+    }
+  }
+
+private:
+  // run the compressor furthest behind that has a chunk to compress, until all are done
+  void work()
+  {
+    std::vector<unsigned> compSizes(SWEEP_BATCH_LINES);
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+      int selected = -1;
+      for (unsigned c = 0; c < m_Compressors.size(); c++)
+        if (!m_IsBusy[c] && m_Next[c] < m_NumLoaded && (selected == -1 || m_Next[c] < m_Next[selected]))
+          selected = c;
+
+      if (selected == -1)
+      {
+        if (m_IsEnd && getMinNext() == m_NumLoaded)
+          break;
+        m_CondVar.wait(lock);
+        continue;
+      }
+
+      m_IsBusy[selected] = true;
+      Chunk &chunk = m_Chunks[m_Next[selected] % SWEEP_NUM_CHUNKS];
+      lock.unlock();
+
+      comp::Compressor *compressor = m_Compressors[selected];
+      auto start = std::chrono::steady_clock::now();
+      for (const Segment &segment : chunk.Segments)
+      {
+        for (unsigned i = 0; i < segment.NumLines; i += SWEEP_BATCH_LINES)
+        {
+          const unsigned numLines = std::min(segment.NumLines - i, (unsigned)SWEEP_BATCH_LINES);
+          compressor->CompressLines(chunk.Data.data() + segment.Offset + (size_t)i * segment.LineSize,
+              numLines, segment.LineSize, compSizes.data());
+        }
+      }
+      auto end = std::chrono::steady_clock::now();
+
+      lock.lock();
+      m_Seconds[selected] += std::chrono::duration<double>(end - start).count();
+      m_IsBusy[selected] = false;
+      m_Next[selected]++;
+      m_CondVar.notify_all();
+    }
+    m_CondVar.notify_all();
+  }
+
+  // chunks compressed by every compressor
+  uint64_t getMinNext()
+  {
+    return m_Next.empty() ? m_NumLoaded : *std::min_element(m_Next.begin(), m_Next.end());
+  }
+
+private:
+  std::vector<comp::Compressor*> m_Compressors;
+  const unsigned m_NumThreads;
+
+  std::vector<Chunk> m_Chunks;
+  std::mutex m_Mutex;
+  std::condition_variable m_CondVar;
+  uint64_t m_NumLoaded;                 // chunks loaded so far, guarded by m_Mutex
+  bool m_IsEnd;
+  std::vector<uint64_t> m_Next;         // next chunk of each compressor
+  std::vector<bool> m_IsBusy;
+  std::vector<double> m_Seconds;
+};
+
+}
+
+#endif  // __SWEEP_H__
@@ -20,3 +20,27 @@ std::string parseConfig(const std::string &configPath)
   return cfgFileName;
 }
 
+Json::Value readJSON(const std::string &filePath)
+{
+  // open json file
+  std::ifstream file(filePath);
+  if (!file.is_open())
+  {
+    printf("Invalid File! \"%s\" is not valid path.\n", filePath.c_str());
+    exit(1);
+  }
+
+  // parse json
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  builder["collectComments"] = false;
+  JSONCPP_STRING errs;
+  if (!parseFromStream(builder, file, &root, &errs))
+  {
+    std::cout << errs << std::endl;
+    printf("Parsing ERROR! \"%s\" is not valid json file.\n", filePath.c_str());
+    exit(1);
+  }
+
+  return root;
+}
@@ -1,13 +1,16 @@
 #ifndef __UTILS_H__
 #define __UTILS_H__
 
+#include <iostream>
 #include <fstream>
 #include <string>
 
 #include <strutil.h>
 #include <fmt/core.h>
+#include <json/json.h>
 
 bool isFileExists(const std::string &filePath);
 std::string parseConfig(const std::string &configPath);
+Json::Value readJSON(const std::string &filePath);
 
 #endif  // __UTILS_H__